@@ -375,4 +375,61 @@ static inline short MAX16(const short *y, int len, int *pos)
 }
 
 #endif	/* MMX */
+
+#ifdef DAHDI_CHUNKSIZE
+/*
+ * Conference accumulators are 32 bits wide, so adding and removing talkers
+ * never saturates. The result is only clamped to 16 bits when a member reads
+ * the mix back out (MIXL / MIXLS).
+ */
+static inline short SAT16(int sample)
+{
+	if (sample > 32767)
+		return 32767;
+	if (sample < -32768)
+		return -32768;
+	return sample;
+}
+
+/* Add src into the accumulator */
+static inline void ACSL(int *acc, const short *src)
+{
+	int x;
+	for (x = 0; x < DAHDI_CHUNKSIZE; x++)
+		acc[x] += src[x];
+}
+
+/* Subtract src from the accumulator */
+static inline void SCSL(int *acc, const short *src)
+{
+	int x;
+	for (x = 0; x < DAHDI_CHUNKSIZE; x++)
+		acc[x] -= src[x];
+}
+
+/* Add one accumulator into another */
+static inline void ACLL(int *acc, const int *src)
+{
+	int x;
+	for (x = 0; x < DAHDI_CHUNKSIZE; x++)
+		acc[x] += src[x];
+}
+
+/* Add the accumulator to dst, saturating once */
+static inline void MIXL(short *dst, const int *acc)
+{
+	int x;
+	for (x = 0; x < DAHDI_CHUNKSIZE; x++)
+		dst[x] = SAT16(dst[x] + acc[x]);
+}
+
+/* Add the accumulator minus self to dst, saturating once */
+static inline void MIXLS(short *dst, const int *acc, const short *self)
+{
+	int x;
+	for (x = 0; x < DAHDI_CHUNKSIZE; x++)
+		dst[x] = SAT16(dst[x] + acc[x] - self[x]);
+}
+#endif	/* DAHDI_CHUNKSIZE */
+
 #endif	/* _DAHDI_ARITH_H */
@@ -50,6 +50,14 @@
 #include <linux/list.h>
 #include <linux/delay.h>
 #include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/idr.h>
+#include <linux/file.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 26)
+#include <linux/rculist.h>
+#else
+#include <linux/rcupdate.h>
+#endif
 
 #if defined(HAVE_UNLOCKED_IOCTL) && defined(CONFIG_BKL)
 #include <linux/smp_lock.h>
@@ -160,31 +168,77 @@ enum dahdi_txstate {
 	DAHDI_TXSTATE_PULSEAFTER,
 };
 
-typedef short sumtype[DAHDI_MAX_CHUNKSIZE];
+/* Wide enough that adding every member of a conference cannot overflow */
+typedef int sumtype[DAHDI_MAX_CHUNKSIZE];
 
-static sumtype sums[(DAHDI_MAX_CONF + 1) * 3];
+/*
+ * Conference numbers as seen by user space (confna) go up to max_conferences
+ * and are translated into small, dense aliases (_confn). Everything indexed
+ * by alias is sized by conf_rows, which dahdi_conf_reserve() grows on demand,
+ * so the per-tick work scales with the conferences actually in use.
+ */
+static int max_conferences = DAHDI_MAX_CONF;
 
 /* Translate conference aliases into actual conferences
    and vice-versa */
-static short confalias[DAHDI_MAX_CONF + 1];
-static short confrev[DAHDI_MAX_CONF + 1];
+static int *confalias;		/* max_conferences + 1 entries */
+static int *confrev;		/* conf_rows entries */
+static int conf_rows;
+static int nconfs;		/* aliases in use */
 
+#define DAHDI_CONF_MIN_ROWS	32
+
+static sumtype *sums;		/* 3 planes of conf_rows */
+static int sum_pos;
 static sumtype *conf_sums_next;
 static sumtype *conf_sums;
 static sumtype *conf_sums_prev;
 
+/*
+ * Silence-aware conferencing (DAHDI_CONF_CONF only).
+ *
+ * conf_vad_threshold: members whose smoothed mean amplitude stays below this
+ * for longer than conf_vad_hangover ms neither add into the conference nor
+ * subtract their own last sample back out. 0 disables.
+ *
+ * conf_max_talkers: mix at most this many members into each conference
+ * chunk, preferring the ones that were loudest in the previous chunk. 0
+ * disables.
+ */
+#define DAHDI_CONF_MAX_TALKERS	8
+
+static int conf_vad_threshold;
+static int conf_vad_hangover = 200;
+static int conf_max_talkers;
+
+/* Talkers mixed into each conference, kept in step with the sums above */
+static unsigned char *talker_counts;	/* 3 planes of conf_rows */
+static unsigned char *conf_talkers_next;
+static unsigned char *conf_talkers;
+
+static struct conf_rank {
+	/* Loudest talkers seen since the last rotate_sums(), loudest first */
+	unsigned short	loudest[DAHDI_CONF_MAX_TALKERS];
+	unsigned char	nloudest;
+	/* Quietest talker that made the cut last chunk */
+	unsigned short	floor;
+} *conf_rank;			/* conf_rows entries */
+
 static struct dahdi_span *master_span;
 struct file_operations *dahdi_transcode_fops = NULL;
 
 
 #ifdef CONFIG_DAHDI_CONFLINK
-static struct {
+struct conf_link {
+	struct list_head node;
 	int	src;	/* source conf number */
 	int	dst;	/* dst conf number */
-} conf_links[DAHDI_MAX_CONF + 1];
-
-static int maxlinks;
+};
 
+/* Active conference links. Protected by chan_lock. */
+static LIST_HEAD(conf_links);
+static int nconflinks;
+static int max_conflinks = DAHDI_MAX_CONF;
 #endif
 
 #ifdef CONFIG_DAHDI_CORE_TIMER
@@ -382,6 +436,11 @@ enum { FIRST_PSEUDO_CHANNEL = 0x8000, };
 /* This list is protected by the chan_lock. */
 static LIST_HEAD(pseudo_chans);
 
+/* Pseudo channels are allocated from pseudo_cache and numbered from
+ * pseudo_ida, both under the registration_mutex. */
+static struct kmem_cache *pseudo_cache;
+static DEFINE_IDA(pseudo_ida);
+
 /**
  * is_pseudo_chan() - By definition pseudo channels are not on a span.
  */
@@ -421,28 +480,38 @@ __for_each_channel(unsigned long (*func)(struct dahdi_chan *chan,
 }
 
 /**
- * _chan_from_num - Lookup a channel
+ * _pseudo_from_num - Lookup a pseudo channel
  *
  * Must be called with the registration_mutex held.
  *
  */
-static struct dahdi_chan *_chan_from_num(unsigned int channo)
+static struct dahdi_chan *_pseudo_from_num(unsigned int channo)
 {
-	struct dahdi_span *s;
 	struct pseudo_chan *pseudo;
 
-	if (channo >= FIRST_PSEUDO_CHANNEL) {
-		list_for_each_entry(pseudo, &pseudo_chans, node) {
-			if (pseudo->chan.channo == channo)
-				return &pseudo->chan;
-		}
-		return NULL;
+	list_for_each_entry(pseudo, &pseudo_chans, node) {
+		if (pseudo->chan.channo == channo)
+			return &pseudo->chan;
 	}
+	return NULL;
+}
+
+/**
+ * _span_chan_from_num - Lookup a channel that belongs to a span
+ *
+ * Must be called under rcu_read_lock(). The span_list is only modified under
+ * the chan_lock with the RCU list primitives, and _dahdi_unassign_span() waits
+ * for a grace period before the span may go away.
+ *
+ */
+static struct dahdi_chan *_span_chan_from_num(unsigned int channo)
+{
+	struct dahdi_span *s;
 
 	/* When searching for the channel amongst the spans, we can use the
 	 * fact that channels on a span must be numbered consecutively to skip
 	 * checking each individual channel. */
-	list_for_each_entry(s, &span_list, spans_node) {
+	list_for_each_entry_rcu(s, &span_list, spans_node) {
 		unsigned int basechan;
 		struct dahdi_chan *chan;
 
@@ -470,9 +539,19 @@ static struct dahdi_chan *_chan_from_num(unsigned int channo)
 static struct dahdi_chan *chan_from_num(unsigned int channo)
 {
 	struct dahdi_chan *chan;
-	mutex_lock(&registration_mutex);
-	chan = _chan_from_num(channo);
-	mutex_unlock(&registration_mutex);
+
+	if (channo >= FIRST_PSEUDO_CHANNEL) {
+		/* Pseudo channels come and go with every open / close and are
+		 * therefore left under the registration_mutex. */
+		mutex_lock(&registration_mutex);
+		chan = _pseudo_from_num(channo);
+		mutex_unlock(&registration_mutex);
+		return chan;
+	}
+
+	rcu_read_lock();
+	chan = _span_chan_from_num(channo);
+	rcu_read_unlock();
 	return chan;
 }
 
@@ -485,13 +564,13 @@ static inline struct dahdi_chan *chan_from_file(struct file *file)
 /**
  * _find_span() - Find a span by span number.
  *
- * Must be called with registration_mutex held.
+ * Must be called under rcu_read_lock() (or with the registration_mutex held).
  *
  */
 static struct dahdi_span *_find_span(int spanno)
 {
 	struct dahdi_span *s;
-	list_for_each_entry(s, &span_list, spans_node) {
+	list_for_each_entry_rcu(s, &span_list, spans_node) {
 		if (s->spanno == spanno) {
 			return s;
 		}
@@ -510,11 +589,11 @@ static struct dahdi_span *span_find_and_get(int spanno)
 {
 	struct dahdi_span *found;
 
-	mutex_lock(&registration_mutex);
+	rcu_read_lock();
 	found = _find_span(spanno);
 	if (found && !get_span(found))
 		found = NULL;
-	mutex_unlock(&registration_mutex);
+	rcu_read_unlock();
 	return found;
 }
 
@@ -522,11 +601,11 @@ static unsigned int span_count(void)
 {
 	unsigned int count = 0;
 	struct dahdi_span *s;
-	unsigned long flags;
-	spin_lock_irqsave(&chan_lock, flags);
-	list_for_each_entry(s, &span_list, spans_node)
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(s, &span_list, spans_node)
 		++count;
-	spin_unlock_irqrestore(&chan_lock, flags);
+	rcu_read_unlock();
 	return count;
 }
 
@@ -614,15 +693,231 @@ int dahdi_is_sync_master(const struct dahdi_span *span)
 	return span == master_span;
 }
 
+static inline int conf_max_talkers_clamped(void)
+{
+	return min(conf_max_talkers, DAHDI_CONF_MAX_TALKERS);
+}
+
+static void set_sum_planes(void)
+{
+	conf_sums_prev = sums + conf_rows * sum_pos;
+	conf_sums = sums + conf_rows * ((sum_pos + 1) % 3);
+	conf_sums_next = sums + conf_rows * ((sum_pos + 2) % 3);
+	conf_talkers = talker_counts + conf_rows * ((sum_pos + 1) % 3);
+	conf_talkers_next = talker_counts + conf_rows * ((sum_pos + 2) % 3);
+}
+
+static void rank_talkers(void)
+{
+	int x;
+	const int max = conf_max_talkers_clamped();
+
+	if (max <= 0)
+		return;
+
+	for (x = 1; x < maxconfs; x++) {
+		struct conf_rank *const rank = &conf_rank[x];
+
+		if (rank->nloudest >= max)
+			rank->floor = rank->loudest[max - 1];
+		else
+			rank->floor = 0;
+		rank->nloudest = 0;
+	}
+}
+
 static inline void rotate_sums(void)
 {
 	/* Rotate where we sum and so forth */
-	static int pos = 0;
-	conf_sums_prev = sums + (DAHDI_MAX_CONF + 1) * pos;
-	conf_sums = sums + (DAHDI_MAX_CONF + 1) * ((pos + 1) % 3);
-	conf_sums_next = sums + (DAHDI_MAX_CONF + 1) * ((pos + 2) % 3);
-	pos = (pos + 1) % 3;
+	sum_pos = (sum_pos + 1) % 3;
+	set_sum_planes();
 	memset(conf_sums_next, 0, maxconfs * sizeof(sumtype));
+	memset(conf_talkers_next, 0, maxconfs);
+	rank_talkers();
+}
+
+/**
+ * dahdi_conf_reserve() - Make sure there is a row for another conference.
+ *
+ * The alias tables are allocated outside of chan_lock and swapped in under
+ * it. Must be called without chan_lock held, before anything that may
+ * allocate an alias. Concurrent callers may all be counting on the same
+ * spare row, so the one that finds it gone under chan_lock calls this again.
+ */
+static int dahdi_conf_reserve(void)
+{
+	unsigned long flags;
+	int rows;
+	int old_rows;
+	int p;
+	sumtype *new_sums;
+	unsigned char *new_talkers;
+	int *new_confrev;
+	struct conf_rank *new_rank;
+
+	/* Aliases 1..nconfs + 1 plus the unused row 0 */
+	if (nconfs + 2 <= conf_rows)
+		return 0;
+
+	rows = max(conf_rows * 2, DAHDI_CONF_MIN_ROWS);
+	rows = min(rows, max_conferences + 1);
+	if (rows <= conf_rows)
+		return 0;
+
+	new_sums = kcalloc(rows * 3, sizeof(*new_sums), GFP_KERNEL);
+	new_talkers = kcalloc(rows * 3, sizeof(*new_talkers), GFP_KERNEL);
+	new_confrev = kcalloc(rows, sizeof(*new_confrev), GFP_KERNEL);
+	new_rank = kcalloc(rows, sizeof(*new_rank), GFP_KERNEL);
+	if (!new_sums || !new_talkers || !new_confrev || !new_rank) {
+		kfree(new_sums);
+		kfree(new_talkers);
+		kfree(new_confrev);
+		kfree(new_rank);
+		return -ENOMEM;
+	}
+
+	spin_lock_irqsave(&chan_lock, flags);
+	old_rows = conf_rows;
+	if (rows > old_rows) {
+		for (p = 0; p < 3; p++) {
+			memcpy(new_sums + rows * p, sums + old_rows * p,
+			       old_rows * sizeof(*sums));
+			memcpy(new_talkers + rows * p,
+			       talker_counts + old_rows * p, old_rows);
+		}
+		memcpy(new_confrev, confrev, old_rows * sizeof(*confrev));
+		memcpy(new_rank, conf_rank, old_rows * sizeof(*conf_rank));
+		swap(sums, new_sums);
+		swap(talker_counts, new_talkers);
+		swap(confrev, new_confrev);
+		swap(conf_rank, new_rank);
+		conf_rows = rows;
+		set_sum_planes();
+	}
+	spin_unlock_irqrestore(&chan_lock, flags);
+
+	/* Span drivers touch the sums from their interrupt handlers without
+	 * chan_lock; let them finish with the old tables first. */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 20, 0)
+	synchronize_rcu();
+#else
+	synchronize_sched();
+#endif
+
+	/* Either the old tables, or the new ones if someone beat us to it */
+	kfree(new_sums);
+	kfree(new_talkers);
+	kfree(new_confrev);
+	kfree(new_rank);
+	return 0;
+}
+
+static void dahdi_conf_free(void)
+{
+#ifdef CONFIG_DAHDI_CONFLINK
+	struct conf_link *link, *next;
+
+	list_for_each_entry_safe(link, next, &conf_links, node) {
+		list_del(&link->node);
+		kfree(link);
+	}
+	nconflinks = 0;
+#endif
+	kfree(sums);
+	kfree(talker_counts);
+	kfree(confrev);
+	kfree(conf_rank);
+	kfree(confalias);
+	sums = NULL;
+	talker_counts = NULL;
+	confrev = NULL;
+	conf_rank = NULL;
+	confalias = NULL;
+	conf_rows = 0;
+}
+
+/**
+ * conf_rank_talker() - Remember how loud a talker was in this chunk.
+ *
+ * Keeps the conf_max_talkers loudest, so that rank_talkers() can work out
+ * the cut for the next chunk.
+ */
+static void conf_rank_talker(int confn, unsigned short energy, int max)
+{
+	struct conf_rank *const rank = &conf_rank[confn];
+	unsigned short *loudest = rank->loudest;
+	int n = rank->nloudest;
+	int x;
+
+	if (n == max) {
+		if (energy <= loudest[n - 1])
+			return;
+		--n;
+	}
+	for (x = n; x > 0 && loudest[x - 1] < energy; x--)
+		loudest[x] = loudest[x - 1];
+	loudest[x] = energy;
+	rank->nloudest = n + 1;
+}
+
+/**
+ * conf_should_talk() - Should this member's audio be mixed into the conference?
+ * @ms:		The conference member.
+ * @lin:	What it is about to contribute, in linear.
+ * @talkers:	conf_talkers or conf_talkers_next, matching the sums that are
+ *		about to be added into.
+ *
+ * Called with the channel lock held, once per chunk, for members of a
+ * DAHDI_CONF_CONF conference that have DAHDI_CONF_TALKER set.
+ */
+static bool conf_should_talk(struct dahdi_chan *ms, const short *lin,
+			     unsigned char *talkers)
+{
+	const int max = conf_max_talkers_clamped();
+	int energy = 0;
+	int x;
+
+	if (likely(!conf_vad_threshold && max <= 0))
+		return true;
+
+	for (x = 0; x < DAHDI_CHUNKSIZE; x++)
+		energy += abs(lin[x]);
+	energy /= DAHDI_CHUNKSIZE;
+	ms->conf_energy += (energy - ms->conf_energy) / 4;
+
+	if (conf_vad_threshold) {
+		if (ms->conf_energy >= conf_vad_threshold)
+			ms->conf_hangover = conf_vad_hangover * 8 /
+						DAHDI_CHUNKSIZE;
+		else if (ms->conf_hangover > 0)
+			--ms->conf_hangover;
+		else
+			return false;
+	}
+
+	if (max <= 0)
+		return true;
+
+	conf_rank_talker(ms->_confn, ms->conf_energy, max);
+	if (ms->conf_energy < conf_rank[ms->_confn].floor ||
+	    talkers[ms->_confn] >= max)
+		return false;
+	++talkers[ms->_confn];
+	return true;
+}
+
+/**
+ * conf_silence() - Member adds nothing to the conference this chunk.
+ *
+ * conflast only needs clearing once; while conf_silent is set the listener
+ * side skips subtracting it.
+ */
+static inline void conf_silence(struct dahdi_chan *ms)
+{
+	if (!ms->conf_silent) {
+		memset(ms->conflast, 0, DAHDI_CHUNKSIZE * sizeof(short));
+		ms->conf_silent = 1;
+	}
 }
 
 /**
@@ -1019,7 +1314,7 @@ static int dahdi_first_empty_alias(void)
 {
 	/* Find the first conference which has no alias pointing to it */
 	int x;
-	for (x=1;x<DAHDI_MAX_CONF;x++) {
+	for (x = 1; x < conf_rows; x++) {
 		if (!confrev[x])
 			return x;
 	}
@@ -1030,7 +1325,7 @@ static void recalc_maxconfs(void)
 {
 	int x;
 
-	for (x = DAHDI_MAX_CONF - 1; x > 0; x--) {
+	for (x = conf_rows - 1; x > 0; x--) {
 		if (confrev[x]) {
 			maxconfs = x + 1;
 			return;
@@ -1045,7 +1340,7 @@ static int dahdi_first_empty_conference(void)
 	/* Find the first conference which has no alias */
 	int x;
 
-	for (x = DAHDI_MAX_CONF - 1; x > 0; x--) {
+	for (x = max_conferences - 1; x > 0; x--) {
 		if (!confalias[x])
 			return x;
 	}
@@ -1053,6 +1348,7 @@ static int dahdi_first_empty_conference(void)
 	return -1;
 }
 
+/* Call with chan_lock held, after dahdi_conf_reserve(). */
 static int dahdi_get_conf_alias(int x)
 {
 	int a;
@@ -1062,8 +1358,11 @@ static int dahdi_get_conf_alias(int x)
 
 	/* Allocate an alias */
 	a = dahdi_first_empty_alias();
+	if (a < 0)
+		return 0;
 	confalias[x] = a;
 	confrev[a] = x;
+	++nconfs;
 
 	/* Highest conference may have changed */
 	recalc_maxconfs();
@@ -1082,32 +1381,16 @@ static unsigned long _chan_in_conf(struct dahdi_chan *chan, unsigned long x)
 	     confmode == DAHDI_CONF_REALANDPSEUDO)) ? 1 : 0;
 }
 
-#ifdef CONFIG_DAHDI_CONFLINK
-static void recalc_maxlinks(void)
-{
-	int x;
-
-	for (x = DAHDI_MAX_CONF - 1; x > 0; x--) {
-		if (conf_links[x].src || conf_links[x].dst) {
-			maxlinks = x + 1;
-			return;
-		}
-	}
-
-	maxlinks = 0;
-}
-#endif
-
 static void dahdi_check_conf(int x)
 {
 	unsigned long res;
 	unsigned long flags;
 #ifdef CONFIG_DAHDI_CONFLINK
-	int i;
+	struct conf_link *link, *next;
 #endif
 
 	/* return if no valid conf number */
-	if (x <= 0)
+	if (x <= 0 || x > max_conferences)
 		return;
 
 	/* Return if there is no alias */
@@ -1116,28 +1399,31 @@ static void dahdi_check_conf(int x)
 
 	spin_lock_irqsave(&chan_lock, flags);
 	res = __for_each_channel(_chan_in_conf, x);
-	spin_unlock_irqrestore(&chan_lock, flags);
-	if (res)
+	if (res || !confalias[x]) {
+		spin_unlock_irqrestore(&chan_lock, flags);
 		return;
+	}
 
 	/* If we get here, nobody is in the conference anymore.  Clear it out
 	   both forward and reverse */
 	confrev[confalias[x]] = 0;
 	confalias[x] = 0;
+	--nconfs;
 
 	/* Highest conference may have changed */
 	recalc_maxconfs();
 
 #ifdef CONFIG_DAHDI_CONFLINK
 	/* And unlink it from any conflinks */
-	for (i = DAHDI_MAX_CONF - 1; i > 0; i--) {
-		if (conf_links[i].src == x)
-			conf_links[i].src = 0;
-		if (conf_links[i].dst == x)
-			conf_links[i].dst = 0;
+	list_for_each_entry_safe(link, next, &conf_links, node) {
+		if (link->src == x || link->dst == x) {
+			list_del(&link->node);
+			kfree(link);
+			--nconflinks;
+		}
 	}
-	recalc_maxlinks();
 #endif
+	spin_unlock_irqrestore(&chan_lock, flags);
 }
 
 /* enqueue an event on a channel */
@@ -1285,6 +1571,7 @@ static int dahdi_reallocbufs(struct dahdi_chan *ss, int blocksize, int numbufs)
 
 static int dahdi_hangup(struct dahdi_chan *chan);
 static void dahdi_set_law(struct dahdi_chan *chan, int law);
+static const struct file_operations dahdi_fops;
 
 /* Pull a DAHDI_CHUNKSIZE piece off the queue.  Returns
    0 on success or -1 on failure.  If failed, provides
@@ -1613,6 +1900,7 @@ static void close_channel(struct dahdi_chan *chan)
 	chan->txgain = defgain;
 	chan->eventinidx = chan->eventoutidx = 0;
 	chan->flags &= ~(DAHDI_FLAG_LOOPED | DAHDI_FLAG_LINEAR | DAHDI_FLAG_PPP | DAHDI_FLAG_SIGFREEZE);
+	chan->flags &= ~DAHDI_FLAG_ECREADY_EVENTS;
 
 	dahdi_set_law(chan, DAHDI_LAW_DEFAULT);
 
@@ -3088,6 +3376,8 @@ static int dahdi_specchan_open(struct file *file)
 			if (!res) {
 				chan->file = file;
 				file->private_data = chan;
+				/* Count errors per call, not since boot */
+				memset(&chan->stats, 0, sizeof(chan->stats));
 				/* Since we know we're a channel now, we can
 				 * update the f_op pointer and bypass a few of
 				 * the checks on the minor number. */
@@ -3172,6 +3462,46 @@ static int can_open_timer(void)
 static unsigned int max_pseudo_channels = 512;
 static unsigned int num_pseudo_channels;
 
+static int dahdi_get_pseudo_channo(void)
+{
+	const int last = FIRST_PSEUDO_CHANNEL + max_pseudo_channels - 1;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+	return ida_alloc_range(&pseudo_ida, FIRST_PSEUDO_CHANNEL, last,
+			       GFP_KERNEL);
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(3, 1, 0)
+	return ida_simple_get(&pseudo_ida, FIRST_PSEUDO_CHANNEL, last + 1,
+			      GFP_KERNEL);
+#else
+	int channo;
+	int res;
+
+	do {
+		if (!ida_pre_get(&pseudo_ida, GFP_KERNEL))
+			return -ENOMEM;
+		res = ida_get_new_above(&pseudo_ida, FIRST_PSEUDO_CHANNEL,
+					&channo);
+	} while (-EAGAIN == res);
+	if (res)
+		return res;
+	if (channo > last) {
+		ida_remove(&pseudo_ida, channo);
+		return -ENOSPC;
+	}
+	return channo;
+#endif
+}
+
+static void dahdi_put_pseudo_channo(int channo)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 19, 0)
+	ida_free(&pseudo_ida, channo);
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(3, 1, 0)
+	ida_simple_remove(&pseudo_ida, channo);
+#else
+	ida_remove(&pseudo_ida, channo);
+#endif
+}
+
 /**
  * dahdi_alloc_pseudo() - Returns a new pseudo channel.
  *
@@ -3184,9 +3514,7 @@ static struct dahdi_chan *dahdi_alloc_pseudo(struct file *file)
 {
 	struct pseudo_chan *pseudo;
 	unsigned long flags;
-	unsigned int channo;
-	struct pseudo_chan *p;
-	struct list_head *pos = &pseudo_chans;
+	int channo;
 
 	/* Don't allow /dev/dahdi/pseudo to open if there is not a timing
 	 * source. */
@@ -3196,23 +3524,21 @@ static struct dahdi_chan *dahdi_alloc_pseudo(struct file *file)
 	if (unlikely(num_pseudo_channels >= max_pseudo_channels))
 		return NULL;
 
-	pseudo = kzalloc(sizeof(*pseudo), GFP_KERNEL);
+	pseudo = kmem_cache_zalloc(pseudo_cache, GFP_KERNEL);
 	if (NULL == pseudo)
 		return NULL;
 
+	channo = dahdi_get_pseudo_channo();
+	if (channo < 0) {
+		kmem_cache_free(pseudo_cache, pseudo);
+		return NULL;
+	}
+
 	pseudo->chan.sig = DAHDI_SIG_CLEAR;
 	pseudo->chan.sigcap = DAHDI_SIG_CLEAR;
 	pseudo->chan.flags = DAHDI_FLAG_AUDIO;
 	pseudo->chan.span = NULL; /* No span == psuedo channel */
 
-	channo = FIRST_PSEUDO_CHANNEL;
-	list_for_each_entry(p, &pseudo_chans, node) {
-		if (channo != p->chan.channo)
-			break;
-		pos = &p->node;
-		++channo;
-	}
-
 	pseudo->chan.channo = channo;
 	pseudo->chan.chanpos = channo - FIRST_PSEUDO_CHANNEL + 1;
 	__dahdi_init_chan(&pseudo->chan);
@@ -3227,7 +3553,7 @@ static struct dahdi_chan *dahdi_alloc_pseudo(struct file *file)
 	 * live. */
 	spin_lock_irqsave(&chan_lock, flags);
 	++num_pseudo_channels;
-	list_add(&pseudo->node, pos);
+	list_add_tail(&pseudo->node, &pseudo_chans);
 	spin_unlock_irqrestore(&chan_lock, flags);
 
 	return &pseudo->chan;
@@ -3249,9 +3575,11 @@ static void dahdi_free_pseudo(struct dahdi_chan *chan)
 	--num_pseudo_channels;
 	spin_unlock_irqrestore(&chan_lock, flags);
 
+	/* dahdi_chan_unreg() clears the channel number */
+	dahdi_put_pseudo_channo(chan->channo);
 	dahdi_chan_unreg(chan);
 	mutex_unlock(&registration_mutex);
-	kfree(pseudo);
+	kmem_cache_free(pseudo_cache, pseudo);
 }
 
 static int dahdi_open(struct inode *inode, struct file *file)
@@ -4227,6 +4555,28 @@ static int dahdi_ioctl_chandiag(struct file *file, unsigned long data)
 	return 0;
 }
 
+/**
+ * dahdi_chan_rxisoffhook() - Return non-zero if rx is not in idle state.
+ *
+ */
+static int dahdi_chan_rxisoffhook(struct dahdi_chan *chan)
+{
+	int j;
+
+	if (chan->span) {
+		j = dahdi_q_sig(chan);
+		if (j >= 0) { /* if returned with success */
+			return ((chan->rxsig & (j >> 8)) != (j & 0xff));
+		} else {
+			const int sig = chan->rxhooksig;
+			return ((sig != DAHDI_RXSIG_ONHOOK) &&
+				(sig != DAHDI_RXSIG_INITIAL));
+		}
+	}
+	return ((chan->txstate == DAHDI_TXSTATE_KEWL) ||
+		(chan->txstate == DAHDI_TXSTATE_AFTERKEWL));
+}
+
 /**
  * dahdi_ioctl_getparams() - Get channel parameters.
  *
@@ -4237,7 +4587,6 @@ static int dahdi_ioctl_getparams(struct file *file, unsigned long data)
 	struct dahdi_params param;
 	bool return_master = false;
 	struct dahdi_chan *chan;
-	int j;
 	size_to_copy = sizeof(struct dahdi_params);
 	if (copy_from_user(&param, (void __user *)data, size_to_copy))
 		return -EFAULT;
@@ -4259,23 +4608,7 @@ static int dahdi_ioctl_getparams(struct file *file, unsigned long data)
 
 	/* point to relevant structure */
 	param.sigtype = chan->sig;  /* get signalling type */
-	/* return non-zero if rx not in idle state */
-	if (chan->span) {
-		j = dahdi_q_sig(chan);
-		if (j >= 0) { /* if returned with success */
-			param.rxisoffhook = ((chan->rxsig & (j >> 8)) !=
-							(j & 0xff));
-		} else {
-			const int sig = chan->rxhooksig;
-			param.rxisoffhook = ((sig != DAHDI_RXSIG_ONHOOK) &&
-				(sig != DAHDI_RXSIG_INITIAL));
-		}
-	} else if ((chan->txstate == DAHDI_TXSTATE_KEWL) ||
-		   (chan->txstate == DAHDI_TXSTATE_AFTERKEWL)) {
-		param.rxisoffhook = 1;
-	} else {
-		param.rxisoffhook = 0;
-	}
+	param.rxisoffhook = dahdi_chan_rxisoffhook(chan);
 
 	if (chan->span &&
 	    chan->span->ops->rbsbits && !(chan->sig & DAHDI_SIG_CLEAR)) {
@@ -4589,7 +4922,9 @@ static int dahdi_ioctl_conflink(struct file *file, unsigned long data)
 	struct dahdi_confinfo conf;
 	unsigned long flags;
 	int res = 0;
-	int i;
+	struct conf_link *link, *next;
+	struct conf_link *new_link = NULL;
+	LIST_HEAD(unlinked);
 
 	chan = chan_from_file(file);
 	if (!chan)
@@ -4599,63 +4934,63 @@ static int dahdi_ioctl_conflink(struct file *file, unsigned long data)
 	if (copy_from_user(&conf, (void __user *)data, sizeof(conf)))
 		return -EFAULT;
 	/* check sanity of arguments */
-	if ((conf.chan < 0) || (conf.chan > DAHDI_MAX_CONF))
+	if ((conf.chan < 0) || (conf.chan > max_conferences))
 		return -EINVAL;
-	if ((conf.confno < 0) || (conf.confno > DAHDI_MAX_CONF))
+	if ((conf.confno < 0) || (conf.confno > max_conferences))
 		return -EINVAL;
 	/* cant listen to self!! */
 	if (conf.chan && (conf.chan == conf.confno))
 		return -EINVAL;
 
+	if (conf.confmode) {
+		new_link = kzalloc(sizeof(*new_link), GFP_KERNEL);
+		if (!new_link)
+			return -ENOMEM;
+		new_link->src = conf.chan;
+		new_link->dst = conf.confno;
+	}
+
 	spin_lock_irqsave(&chan_lock, flags);
 	spin_lock(&chan->lock);
 
 	/* if to clear all links */
 	if ((!conf.chan) && (!conf.confno)) {
 		/* clear all the links */
-		memset(conf_links, 0, sizeof(conf_links));
-		recalc_maxlinks();
-		spin_unlock(&chan->lock);
-		spin_unlock_irqrestore(&chan_lock, flags);
-		return 0;
+		list_splice_init(&conf_links, &unlinked);
+		nconflinks = 0;
+		goto out;
 	}
 	/* look for already existant specified combination */
-	for (i = 1; i <= DAHDI_MAX_CONF; i++) {
+	list_for_each_entry(link, &conf_links, node) {
 		/* if found, exit */
-		if ((conf_links[i].src == conf.chan) &&
-		    (conf_links[i].dst == conf.confno))
+		if ((link->src == conf.chan) && (link->dst == conf.confno))
 			break;
 	}
-	if (i <= DAHDI_MAX_CONF) { /* if found */
+	if (&link->node != &conf_links) { /* if found */
 		if (!conf.confmode) { /* if to remove link */
-			conf_links[i].src = 0;
-			conf_links[i].dst = 0;
+			list_move(&link->node, &unlinked);
+			--nconflinks;
 		} else { /* if to add and already there, error */
 			res = -EEXIST;
 		}
 	} else { /* if not found */
-		if (conf.confmode) { /* if to add link */
-			/* look for empty location */
-			for (i = 1; i <= DAHDI_MAX_CONF; i++) {
-				/* if empty, exit loop */
-				if ((!conf_links[i].src) &&
-				    (!conf_links[i].dst))
-					break;
-			}
-			/* if empty spot found */
-			if (i <= DAHDI_MAX_CONF) {
-				conf_links[i].src = conf.chan;
-				conf_links[i].dst = conf.confno;
-			} else { /* if no empties -- error */
-				res = -ENOSPC;
-			 }
-		} else { /* if to remove, and not found -- error */
+		if (!conf.confmode) { /* if to remove, and not found -- error */
 			res = -ENOENT;
+		} else if (nconflinks >= max_conflinks) { /* if full, error */
+			res = -ENOSPC;
+		} else { /* add link */
+			list_add_tail(&new_link->node, &conf_links);
+			new_link = NULL;
+			++nconflinks;
 		}
 	}
-	recalc_maxlinks();
+out:
 	spin_unlock(&chan->lock);
 	spin_unlock_irqrestore(&chan_lock, flags);
+
+	kfree(new_link);
+	list_for_each_entry_safe(link, next, &unlinked, node)
+		kfree(link);
 	return res;
 }
 #else
@@ -4666,6 +5001,205 @@ static int dahdi_ioctl_conflink(struct file *file, unsigned long data)
 #endif
 
 
+static void dahdi_snapshot_span(const struct dahdi_span *s,
+				struct dahdi_snapshot_span *ss)
+{
+	ss->spanno = s->spanno;
+	ss->alarms = s->alarms;
+	ss->basechan = (s->channels) ? s->chans[0]->channo : 0;
+	ss->channels = s->channels;
+	ss->syncsrc = s->syncsrc;
+	ss->rxlevel = s->rxlevel;
+	ss->txlevel = s->txlevel;
+	ss->irqmisses = s->parent->irqmisses;
+	ss->bpvcount = s->count.bpv;
+	ss->crc4count = s->count.crc4;
+	ss->ebitcount = s->count.ebit;
+	ss->fascount = s->count.fas;
+	ss->fecount = s->count.fe;
+	ss->cvcount = s->count.cv;
+	ss->becount = s->count.be;
+	ss->prbs = s->count.prbs;
+	ss->errsec = s->count.errsec;
+}
+
+static void dahdi_snapshot_chan(struct dahdi_chan *chan,
+				struct dahdi_snapshot_chan *sc)
+{
+	unsigned long flags;
+
+	sc->channo = chan->channo;
+	sc->spanno = chan->span->spanno;
+	sc->sigtype = chan->sig;
+	sc->chan_alarms = chan->chan_alarms;
+	sc->flags = 0;
+	if (test_bit(DAHDI_FLAGBIT_OPEN, &chan->flags))
+		sc->flags |= DAHDI_SNAPSHOT_CHAN_OPEN;
+	if (dahdi_chan_rxisoffhook(chan))
+		sc->flags |= DAHDI_SNAPSHOT_CHAN_OFFHOOK;
+	if (chan->span->ops->rbsbits && !(chan->sig & DAHDI_SIG_CLEAR)) {
+		sc->rxbits = chan->rxsig;
+		sc->txbits = chan->txsig;
+	} else {
+		sc->rxbits = -1;
+		sc->txbits = -1;
+	}
+	if ((chan->span->ops->rbsbits || chan->span->ops->hooksig) &&
+	    !(chan->sig & DAHDI_SIG_CLEAR)) {
+		sc->rxhooksig = chan->rxhooksig;
+		sc->txhooksig = chan->txhooksig;
+	} else {
+		sc->rxhooksig = -1;
+		sc->txhooksig = -1;
+	}
+
+	/* The echo canceller is torn down under the channel lock. */
+	spin_lock_irqsave(&chan->lock, flags);
+	if (chan->ec_state) {
+		sc->flags |= DAHDI_SNAPSHOT_CHAN_EC;
+		if (chan->ec_state->status.mode == ECHO_MODE_FAX)
+			sc->flags |= DAHDI_SNAPSHOT_CHAN_EC_FAX;
+	}
+	sc->stats = chan->stats;
+	spin_unlock_irqrestore(&chan->lock, flags);
+	sc->stats.version = DAHDI_CHAN_STATS_VERSION;
+}
+
+/* Channels copied out to user space at a time by DAHDI_SNAPSHOT */
+#define DAHDI_SNAPSHOT_BATCH	32
+
+/**
+ * _snapshot_next_span() - First span numbered spanno or above.
+ *
+ * Must be called under rcu_read_lock(). The span_list is kept sorted by
+ * span number, so DAHDI_SNAPSHOT picks up where it left off by number
+ * after it dropped the lock, even if the span it was on went away.
+ */
+static struct dahdi_span *_snapshot_next_span(unsigned int spanno)
+{
+	struct dahdi_span *s;
+
+	list_for_each_entry_rcu(s, &span_list, spans_node) {
+		if ((unsigned int)s->spanno >= spanno)
+			return s;
+	}
+	return NULL;
+}
+
+/**
+ * dahdi_ioctl_snapshot() - Status of all the spans and their channels.
+ *
+ * Entries are gathered under rcu_read_lock(), at most one span and
+ * DAHDI_SNAPSHOT_BATCH of its channels at a time, into a bounce buffer that
+ * is copied out to user space with the lock dropped. A slow or faulting
+ * caller therefore holds up nobody, and the kernel allocation does not
+ * depend on how much room the caller offers, or on how many spans and
+ * channels there are. The span being read is held with get_span() until
+ * its entries are copied out.
+ */
+static int dahdi_ioctl_snapshot(unsigned long data)
+{
+	struct dahdi_snapshot snap;
+	struct dahdi_snapshot_span ss;
+	struct dahdi_snapshot_span __user *uspans;
+	struct dahdi_snapshot_chan __user *uchans;
+	struct dahdi_snapshot_chan *chans;
+	unsigned int nspans = 0;
+	unsigned int nchans = 0;
+	unsigned int spanno;
+	struct dahdi_span *s;
+	bool have_span;
+	int channels;
+	int res = 0;
+	int x = 0;
+	int i, n;
+
+	if (copy_from_user(&snap, (void __user *)data, sizeof(snap)))
+		return -EFAULT;
+	if (snap.version != DAHDI_SNAPSHOT_VERSION)
+		return -EINVAL;
+	uspans = (struct dahdi_snapshot_span __user *)(unsigned long)snap.spans;
+	uchans = (struct dahdi_snapshot_chan __user *)(unsigned long)snap.chans;
+
+	chans = kmalloc(DAHDI_SNAPSHOT_BATCH * sizeof(*chans), GFP_KERNEL);
+	if (!chans)
+		return -ENOMEM;
+
+	snap.total_spans = 0;
+	snap.total_chans = 0;
+	rcu_read_lock();
+	list_for_each_entry_rcu(s, &span_list, spans_node) {
+		snap.total_spans++;
+		snap.total_chans += s->channels;
+	}
+	rcu_read_unlock();
+
+	spanno = max_t(u32, snap.first_span, 1);
+	while (nspans < snap.nspans || nchans < snap.nchans) {
+		rcu_read_lock();
+		s = _snapshot_next_span(spanno);
+		if (!s) {
+			rcu_read_unlock();
+			break;
+		}
+		if ((unsigned int)s->spanno != spanno)
+			x = 0;
+		spanno = s->spanno;
+		if (!get_span(s)) {
+			/* Its driver is on the way out */
+			rcu_read_unlock();
+			spanno++;
+			x = 0;
+			continue;
+		}
+		have_span = (!x && nspans < snap.nspans);
+		if (have_span)
+			dahdi_snapshot_span(s, &ss);
+		channels = s->channels;
+		if (x > channels)
+			x = channels;
+		n = min_t(int, channels - x, DAHDI_SNAPSHOT_BATCH);
+		n = min_t(u32, n, snap.nchans - nchans);
+		for (i = 0; i < n; i++)
+			dahdi_snapshot_chan(s->chans[x + i], &chans[i]);
+		rcu_read_unlock();
+
+		if (have_span) {
+			if (copy_to_user(&uspans[nspans], &ss, sizeof(ss)))
+				res = -EFAULT;
+			else
+				nspans++;
+		}
+		if (!res && n) {
+			if (copy_to_user(&uchans[nchans], chans,
+					 n * sizeof(*chans)))
+				res = -EFAULT;
+			else
+				nchans += n;
+		}
+		put_span(s);
+		if (res)
+			break;
+
+		x += n;
+		if (x >= channels || nchans >= snap.nchans) {
+			spanno++;
+			x = 0;
+		}
+	}
+	kfree(chans);
+	if (res)
+		return res;
+
+	snap.nspans = nspans;
+	snap.nchans = nchans;
+	if (copy_to_user((void __user *)data, &snap, sizeof(snap)))
+		return -EFAULT;
+	return 0;
+}
+
+static int dahdi_ioctl_pseudo_bulk(unsigned long data);
+
 static int dahdi_common_ioctl(struct file *file, unsigned int cmd,
 			      unsigned long data)
 {
@@ -4698,6 +5232,12 @@ static int dahdi_common_ioctl(struct file *file, unsigned int cmd,
 	case DAHDI_CONFLINK:
 		return dahdi_ioctl_conflink(file, data);
 
+	case DAHDI_PSEUDO_BULK:
+		return dahdi_ioctl_pseudo_bulk(data);
+
+	case DAHDI_SNAPSHOT:
+		return dahdi_ioctl_snapshot(data);
+
 	default:
 		return -ENOTTY;
 	}
@@ -5615,22 +6155,27 @@ static int ioctl_dahdi_dial(struct dahdi_chan *chan, unsigned long data)
 	return rv;
 }
 
-static int dahdi_ioctl_setconf(struct file *file, unsigned long data)
+/**
+ * dahdi_setconf() - Put a channel into (or take it out of) a conference.
+ * @file:	Used to find the channel when conf->chan is 0.
+ * @conf:	What to do. On success, chan and confno are updated with the
+ *		channel and conference actually used.
+ */
+static int dahdi_setconf(struct file *file, struct dahdi_confinfo *conf)
 {
-	struct dahdi_confinfo conf;
 	struct dahdi_chan *chan;
 	struct dahdi_chan *conf_chan = NULL;
 	unsigned long flags;
 	unsigned int confmode;
 	int oldconf;
+	int confno;
+	bool to_conf;
+	bool grow;
 	enum {NONE, ENABLE_HWPREEC, DISABLE_HWPREEC} preec = NONE;
 
-	if (copy_from_user(&conf, (void __user *)data, sizeof(conf)))
-		return -EFAULT;
-
-	confmode = conf.confmode & DAHDI_CONF_MODE_MASK;
+	confmode = conf->confmode & DAHDI_CONF_MODE_MASK;
 
-	chan = (conf.chan) ? chan_from_num(conf.chan) :
+	chan = (conf->chan) ? chan_from_num(conf->chan) :
 			     chan_from_file(file);
 	if (!chan)
 		return -EINVAL;
@@ -5639,44 +6184,70 @@ static int dahdi_ioctl_setconf(struct file *file, unsigned long data)
 		return -EINVAL;
 
 	if ((DAHDI_CONF_DIGITALMON == confmode) ||
-	    is_monitor_mode(conf.confmode)) {
-		conf_chan = chan_from_num(conf.confno);
+	    is_monitor_mode(conf->confmode)) {
+		conf_chan = chan_from_num(conf->confno);
 		if (!conf_chan)
 			return -EINVAL;
 	} else {
 		/* make sure conf number makes sense, too */
-		if ((conf.confno < -1) || (conf.confno > DAHDI_MAX_CONF))
+		if ((conf->confno < -1) || (conf->confno > max_conferences))
 			return -EINVAL;
 	}
 
 	/* if taking off of any conf, must have 0 mode */
-	if ((!conf.confno) && conf.confmode)
+	if ((!conf->confno) && conf->confmode)
 		return -EINVAL;
 	/* likewise if 0 mode must have no conf */
-	if ((!conf.confmode) && conf.confno)
+	if ((!conf->confmode) && conf->confno)
 		return -EINVAL;
-	dahdi_check_conf(conf.confno);
-	conf.chan = chan->channo;  /* return with real channel # */
+	dahdi_check_conf(conf->confno);
+	conf->chan = chan->channo;  /* return with real channel # */
+	confno = conf->confno;
+retry:
+	if (dahdi_conf_reserve())
+		return -ENOMEM;
 	spin_lock_irqsave(&chan_lock, flags);
 	spin_lock(&chan->lock);
-	if (conf.confno == -1)
-		conf.confno = dahdi_first_empty_conference();
-	if ((conf.confno < 1) && (conf.confmode)) {
+	conf->confno = confno;
+	if (conf->confno == -1)
+		conf->confno = dahdi_first_empty_conference();
+	to_conf = conf->confno > 0 &&
+		  (confmode == DAHDI_CONF_CONF ||
+		   confmode == DAHDI_CONF_CONFANN ||
+		   confmode == DAHDI_CONF_CONFMON ||
+		   confmode == DAHDI_CONF_CONFANNMON ||
+		   confmode == DAHDI_CONF_REALANDPSEUDO);
+	if (to_conf && !confalias[conf->confno] &&
+	    dahdi_first_empty_alias() < 0) {
+		/* Another caller took the spare row since the reserve. Grow
+		 * the tables again unless they are as large as they get. */
+		grow = (conf_rows < max_conferences + 1);
+		spin_unlock(&chan->lock);
+		spin_unlock_irqrestore(&chan_lock, flags);
+		if (grow)
+			goto retry;
+		/* No more empty conferences */
+		return -EBUSY;
+	}
+	if ((conf->confno < 1) && (conf->confmode)) {
 		/* No more empty conferences */
 		spin_unlock(&chan->lock);
 		spin_unlock_irqrestore(&chan_lock, flags);
 		return -EBUSY;
 	}
 	  /* if changing confs, clear last added info */
-	if (conf.confno != chan->confna) {
+	if (conf->confno != chan->confna) {
 		memset(chan->conflast, 0, DAHDI_MAX_CHUNKSIZE);
 		memset(chan->conflast1, 0, DAHDI_MAX_CHUNKSIZE);
 		memset(chan->conflast2, 0, DAHDI_MAX_CHUNKSIZE);
 	}
 	oldconf = chan->confna;  /* save old conference number */
-	chan->confna = conf.confno;   /* set conference number */
+	chan->confna = conf->confno;   /* set conference number */
 	chan->conf_chan = conf_chan;
-	chan->confmode = conf.confmode;  /* set conference mode */
+	chan->confmode = conf->confmode;  /* set conference mode */
+	/* conf_silent is only maintained in DAHDI_CONF_CONF mode */
+	chan->conf_silent = 0;
+	chan->conf_hangover = 0;
 	chan->_confn = 0;		     /* Clear confn */
 	if (chan->span && chan->span->ops->dacs) {
 		if ((confmode == DAHDI_CONF_DIGITALMON) &&
@@ -5690,14 +6261,9 @@ static int dahdi_ioctl_setconf(struct file *file, unsigned long data)
 		}
 	}
 	/* if we are going onto a conf */
-	if (conf.confno &&
-	    (confmode == DAHDI_CONF_CONF ||
-	     confmode == DAHDI_CONF_CONFANN ||
-	     confmode == DAHDI_CONF_CONFMON ||
-	     confmode == DAHDI_CONF_CONFANNMON ||
-	     confmode == DAHDI_CONF_REALANDPSEUDO)) {
+	if (to_conf) {
 		/* Get alias */
-		chan->_confn = dahdi_get_conf_alias(conf.confno);
+		chan->_confn = dahdi_get_conf_alias(conf->confno);
 	}
 
 	spin_unlock(&chan->lock);
@@ -5745,11 +6311,96 @@ static int dahdi_ioctl_setconf(struct file *file, unsigned long data)
 	}
 
 	dahdi_check_conf(oldconf);
+	return 0;
+}
+
+static int dahdi_ioctl_setconf(struct file *file, unsigned long data)
+{
+	struct dahdi_confinfo conf;
+	int res;
+
+	if (copy_from_user(&conf, (void __user *)data, sizeof(conf)))
+		return -EFAULT;
+	res = dahdi_setconf(file, &conf);
+	if (res)
+		return res;
 	if (copy_to_user((void __user *)data, &conf, sizeof(conf)))
 		return -EFAULT;
 	return 0;
 }
 
+/**
+ * dahdi_ioctl_pseudo_bulk() - Set up a batch of open pseudo channels.
+ *
+ * Stops at the first descriptor that fails; count is set to the number
+ * that were set up before it.
+ */
+static int dahdi_ioctl_pseudo_bulk(unsigned long data)
+{
+	struct dahdi_pseudo_bulk *bulk;
+	struct dahdi_chan *chan;
+	struct file *file;
+	int res = 0;
+	int i;
+
+	bulk = kmalloc(sizeof(*bulk), GFP_KERNEL);
+	if (!bulk)
+		return -ENOMEM;
+	if (copy_from_user(bulk, (void __user *)data, sizeof(*bulk))) {
+		kfree(bulk);
+		return -EFAULT;
+	}
+	if ((bulk->count < 0) || (bulk->count > DAHDI_PSEUDO_BULK_MAX) ||
+	    (bulk->law < -1) || (bulk->law > DAHDI_LAW_ALAW) ||
+	    (bulk->blocksize && ((bulk->blocksize < 16) ||
+				 (bulk->blocksize > DAHDI_MAX_BLOCKSIZE)))) {
+		kfree(bulk);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < bulk->count; i++) {
+		file = fget(bulk->fds[i]);
+		if (!file) {
+			res = -EBADF;
+			break;
+		}
+		chan = file->private_data;
+		if ((file->f_op != &dahdi_chan_fops) ||
+		    (UNIT(file) != DAHDI_PSEUDO) || !chan) {
+			fput(file);
+			res = -EINVAL;
+			break;
+		}
+
+		if (bulk->law >= 0)
+			dahdi_set_law(chan, bulk->law);
+		if (bulk->blocksize)
+			res = dahdi_reallocbufs(chan, bulk->blocksize,
+						chan->numbufs);
+		if (!res && bulk->confmode) {
+			struct dahdi_confinfo conf = {
+				.chan = 0,
+				.confno = bulk->confno,
+				.confmode = bulk->confmode,
+			};
+			res = dahdi_setconf(file, &conf);
+			/* The rest join the same conference as the first */
+			if (!res)
+				bulk->confno = conf.confno;
+		}
+		bulk->channos[i] = chan->channo;
+		fput(file);
+		if (res)
+			break;
+	}
+
+	bulk->count = i;
+	if (copy_to_user((void __user *)data, bulk, sizeof(*bulk)))
+		res = -EFAULT;
+	kfree(bulk);
+	return res;
+}
+
 /**
  * dahdi_ioctl_confdiag() - Output debug info about conferences to console.
  *
@@ -5776,7 +6427,7 @@ static int dahdi_ioctl_confdiag(struct file *file, unsigned long data)
 	get_user(j, (int __user *)data);  /* get conf # */
 
 	/* loop thru the interesting ones */
-	for (i = ((j) ? j : 1); i <= ((j) ? j : DAHDI_MAX_CONF); i++) {
+	for (i = ((j) ? j : 1); i <= ((j) ? j : max_conferences); i++) {
 		struct dahdi_span *s;
 		struct pseudo_chan *pseudo;
 		int k;
@@ -5807,10 +6458,11 @@ static int dahdi_ioctl_confdiag(struct file *file, unsigned long data)
 
 #ifdef CONFIG_DAHDI_CONFLINK
 		{
+			struct conf_link *link;
 			int rv;
 			rv = 0;
-			for (k = 1; k <= DAHDI_MAX_CONF; k++) {
-				if (conf_links[k].dst == i) {
+			list_for_each_entry(link, &conf_links, node) {
+				if (link->dst == i) {
 					if (!c) {
 						c = 1;
 						module_printk(KERN_NOTICE,
@@ -5822,7 +6474,7 @@ static int dahdi_ioctl_confdiag(struct file *file, unsigned long data)
 							      "Snooping on:\n");
 					}
 					module_printk(KERN_NOTICE, "conf %d\n",
-						      conf_links[k].src);
+						      link->src);
 				}
 			}
 		}
@@ -6891,6 +7543,15 @@ static int dahdi_chan_ioctl(struct file *file, unsigned int cmd, unsigned long d
 		else
 			clear_bit(DAHDI_FLAGBIT_BUFEVENTS, &chan->flags);
 
+		break;
+	case DAHDI_EC_READY_EVENTS:
+		if (get_user(j, (int __user *)data))
+			return -EFAULT;
+		if (j)
+			set_bit(DAHDI_FLAGBIT_ECREADY_EVENTS, &chan->flags);
+		else
+			clear_bit(DAHDI_FLAGBIT_ECREADY_EVENTS, &chan->flags);
+
 		break;
 	default:
 		return dahdi_chanandpseudo_ioctl(file, cmd, data);
@@ -7081,17 +7742,18 @@ static inline struct dahdi_span *span_from_node(struct list_head *node)
  * Call with registration_mutex held.  Make sure all the spans are on the list
  * ordered by span.
  *
+ * The span_list is walked locklessly by chan_from_num() and
+ * span_find_and_get(), so the span must be fully set up before it is
+ * published here.
+ *
  */
 static void _dahdi_add_span_to_span_list(struct dahdi_span *span)
 {
 	unsigned long flags;
 	struct dahdi_span *pos;
 
-	if (list_empty(&span_list)) {
-		list_add_tail(&span->spans_node, &span_list);
-		return;
-	}
-
+	/* If the loop runs off the end, pos->spans_node is the list head and
+	 * the span is added to the tail. */
 	list_for_each_entry(pos, &span_list, spans_node) {
 		WARN_ON(0 == pos->spanno);
 		if (pos->spanno > span->spanno)
@@ -7099,7 +7761,7 @@ static void _dahdi_add_span_to_span_list(struct dahdi_span *span)
 	}
 
 	spin_lock_irqsave(&chan_lock, flags);
-	list_add(&span->spans_node, pos->spans_node.prev);
+	list_add_rcu(&span->spans_node, pos->spans_node.prev);
 	spin_unlock_irqrestore(&chan_lock, flags);
 }
 
@@ -7230,6 +7892,61 @@ void dahdi_init_span(struct dahdi_span *span)
 }
 EXPORT_SYMBOL(dahdi_init_span);
 
+/**
+ * dahdi_span_alloc_chunks() - Give a span contiguous read / write chunks.
+ * @span:	A span whose chans are allocated but not yet registered.
+ *
+ * Allocates one [channels][DAHDI_CHUNKSIZE] array for receive and one for
+ * transmit, each starting on a cache line, and points the readchunk and
+ * writechunk of every member channel into them. The driver can then fill
+ * the whole span in one sweep through span->rxchunks, and the per-channel
+ * work in the tick walks the chunks in order instead of touching every
+ * dahdi_chan.
+ *
+ * Must be balanced with dahdi_span_free_chunks() once the span is
+ * unregistered and the driver no longer touches the chunks.
+ */
+int dahdi_span_alloc_chunks(struct dahdi_span *span)
+{
+	size_t size;
+	u_char *p;
+	int x;
+
+	if (span->rxchunks || !span->channels)
+		return 0;
+	/* kmalloc() hands out buffers this size on a cache line already */
+	size = L1_CACHE_ALIGN(span->channels * DAHDI_CHUNKSIZE);
+	p = kzalloc(2 * size, GFP_KERNEL);
+	if (!p)
+		return -ENOMEM;
+	span->rxchunks = p;
+	span->txchunks = p + size;
+	for (x = 0; x < span->channels; x++) {
+		span->chans[x]->readchunk =
+		    span->rxchunks + x * DAHDI_CHUNKSIZE;
+		span->chans[x]->writechunk =
+		    span->txchunks + x * DAHDI_CHUNKSIZE;
+	}
+	return 0;
+}
+EXPORT_SYMBOL(dahdi_span_alloc_chunks);
+
+void dahdi_span_free_chunks(struct dahdi_span *span)
+{
+	int x;
+
+	if (!span->rxchunks)
+		return;
+	for (x = 0; x < span->channels; x++) {
+		span->chans[x]->readchunk = span->chans[x]->sreadchunk;
+		span->chans[x]->writechunk = span->chans[x]->swritechunk;
+	}
+	kfree(span->rxchunks);
+	span->rxchunks = NULL;
+	span->txchunks = NULL;
+}
+EXPORT_SYMBOL(dahdi_span_free_chunks);
+
 /**
  * _dahdi_assign_span() - Assign a new DAHDI span
  * @span:	the DAHDI span
@@ -7490,8 +8207,12 @@ static int _dahdi_unassign_span(struct dahdi_span *span)
 		return -EINVAL;
 	}
 	spin_lock_irqsave(&chan_lock, flags);
-	list_del_init(&span->spans_node);
+	list_del_rcu(&span->spans_node);
 	spin_unlock_irqrestore(&chan_lock, flags);
+	/* Wait for lockless readers of the span_list to move on before the
+	 * span number and channels are torn down. */
+	synchronize_rcu();
+	INIT_LIST_HEAD(&span->spans_node);
 	span->spanno = 0;
 	clear_bit(DAHDI_FLAGBIT_REGISTERED, &span->flags);
 
@@ -7774,7 +8495,7 @@ static inline void __dahdi_process_getaudio_chunk(struct dahdi_chan *ss, unsigne
 	/* Called with ss->lock held */
 	struct dahdi_chan *ms = ss->master;
 	/* Linear representation */
-	short getlin[DAHDI_CHUNKSIZE], k[DAHDI_CHUNKSIZE];
+	short getlin[DAHDI_CHUNKSIZE];
 	int x;
 
 	/* Okay, now we've got something to transmit */
@@ -7887,17 +8608,11 @@ static inline void __dahdi_process_getaudio_chunk(struct dahdi_chan *ss, unsigne
 				real channel's last sample. */
 			  /* if to talk on conf */
 			if (ms->confmode & DAHDI_CONF_PSEUDO_TALKER) {
-				/* Store temp value */
-				memcpy(k, getlin, DAHDI_CHUNKSIZE * sizeof(short));
-				/* Add conf value */
-				ACSS(k, conf_sums_next[ms->_confn]);
 				/* save last one */
 				memcpy(ms->conflast2, ms->conflast1, DAHDI_CHUNKSIZE * sizeof(short));
-				memcpy(ms->conflast1, k, DAHDI_CHUNKSIZE * sizeof(short));
-				/*  get amount actually added */
-				SCSS(ms->conflast1, conf_sums_next[ms->_confn]);
-				/* Really add in new value */
-				ACSS(conf_sums_next[ms->_confn], ms->conflast1);
+				memcpy(ms->conflast1, getlin, DAHDI_CHUNKSIZE * sizeof(short));
+				/* Add in new value */
+				ACSL(conf_sums_next[ms->_confn], getlin);
 			} else {
 				memset(ms->conflast1, 0, DAHDI_CHUNKSIZE * sizeof(short));
 				memset(ms->conflast2, 0, DAHDI_CHUNKSIZE * sizeof(short));
@@ -7911,18 +8626,18 @@ static inline void __dahdi_process_getaudio_chunk(struct dahdi_chan *ss, unsigne
 			   {
 				  /* if to talk on conf */
 				if (ms->confmode & DAHDI_CONF_TALKER) {
-					/* Store temp value */
-					memcpy(k, getlin, DAHDI_CHUNKSIZE * sizeof(short));
-					/* Add conf value */
-					ACSS(k, conf_sums[ms->_confn]);
-					/*  get amount actually added */
-					memcpy(ms->conflast, k, DAHDI_CHUNKSIZE * sizeof(short));
-					SCSS(ms->conflast, conf_sums[ms->_confn]);
-					/* Really add in new value */
-					ACSS(conf_sums[ms->_confn], ms->conflast);
+					if (conf_should_talk(ms, getlin, conf_talkers)) {
+						/* Remember what we add, to take it
+						 * back out when listening */
+						memcpy(ms->conflast, getlin, DAHDI_CHUNKSIZE * sizeof(short));
+						ACSL(conf_sums[ms->_confn], getlin);
+						ms->conf_silent = 0;
+					} else {
+						conf_silence(ms);
+					}
 					memcpy(ms->getlin, getlin, DAHDI_CHUNKSIZE * sizeof(short));
 				} else {
-					memset(ms->conflast, 0, DAHDI_CHUNKSIZE * sizeof(short));
+					conf_silence(ms);
 					memcpy(getlin, ms->getlin, DAHDI_CHUNKSIZE * sizeof(short));
 				}
 				txb[0] = DAHDI_LIN2X(0, ms);
@@ -7932,10 +8647,13 @@ static inline void __dahdi_process_getaudio_chunk(struct dahdi_chan *ss, unsigne
 			/* fall through */
 		case DAHDI_CONF_CONFMON:	/* Conference monitor mode */
 			if (ms->confmode & DAHDI_CONF_LISTENER) {
-				/* Subtract out last sample written to conf */
-				SCSS(getlin, ms->conflast);
-				/* Add in conference */
-				ACSS(getlin, conf_sums[ms->_confn]);
+				/* Add in conference, minus the last sample
+				 * written to it */
+				if (ms->conf_silent)
+					MIXL(getlin, conf_sums[ms->_confn]);
+				else
+					MIXLS(getlin, conf_sums[ms->_confn],
+					      ms->conflast);
 			}
 			for (x=0;x<DAHDI_CHUNKSIZE;x++)
 				txb[x] = DAHDI_LIN2X(getlin[x], ms);
@@ -7943,15 +8661,14 @@ static inline void __dahdi_process_getaudio_chunk(struct dahdi_chan *ss, unsigne
 		case DAHDI_CONF_CONFANN:
 		case DAHDI_CONF_CONFANNMON:
 			/* First, add tx buffer to conf */
-			ACSS(conf_sums_next[ms->_confn], getlin);
+			ACSL(conf_sums_next[ms->_confn], getlin);
 			/* Start with silence */
 			memset(getlin, 0, DAHDI_CHUNKSIZE * sizeof(short));
 			/* If a listener on the conf... */
 			if (ms->confmode & DAHDI_CONF_LISTENER) {
-				/* Subtract last value written */
-				SCSS(getlin, ms->conflast);
-				/* Add in conf */
-				ACSS(getlin, conf_sums[ms->_confn]);
+				/* Add in conf, minus the last value written */
+				MIXLS(getlin, conf_sums[ms->_confn],
+				      ms->conflast);
 			}
 			for (x=0;x<DAHDI_CHUNKSIZE;x++)
 				txb[x] = DAHDI_LIN2X(getlin[x], ms);
@@ -8184,6 +8901,7 @@ out in the later versions, and is put back now. */
 
 	if (needtxunderrun) {
 		if (!test_bit(DAHDI_FLAGBIT_TXUNDERRUN, &ms->flags)) {
+			ms->stats.tx_underruns++;
 			if (test_bit(DAHDI_FLAGBIT_BUFEVENTS, &ms->flags))
 				__qevent(ms, DAHDI_EVENT_WRITE_UNDERRUN);
 			set_bit(DAHDI_FLAGBIT_TXUNDERRUN, &ms->flags);
@@ -8640,6 +9358,8 @@ static void process_echocan_events(struct dahdi_chan *chan)
 {
 	union dahdi_echocan_events events = chan->ec_state->events;
 
+	chan->stats.ec_events++;
+
 	if (events.bit.CED_tx_detected) {
 		dahdi_qevent_nolock(chan, DAHDI_EVENT_TX_CED_DETECTED);
 		if (chan->ec_state) {
@@ -8840,8 +9560,9 @@ static inline void __dahdi_process_putaudio_chunk(struct dahdi_chan *ss, unsigne
 	/* Called with ss->lock held */
 	struct dahdi_chan *ms = ss->master;
 	/* Linear version of received data */
-	short putlin[DAHDI_CHUNKSIZE],k[DAHDI_CHUNKSIZE];
+	short putlin[DAHDI_CHUNKSIZE];
 	int x,r;
+	bool is_conf;
 
 	if (ms->dialing) ms->afterdialingtimer = 50;
 	else if (ms->afterdialingtimer) ms->afterdialingtimer--;
@@ -8997,23 +9718,17 @@ static inline void __dahdi_process_putaudio_chunk(struct dahdi_chan *ss, unsigne
 		case DAHDI_CONF_REALANDPSEUDO:
 			  /* do normal conf mode processing */
 			if (ms->confmode & DAHDI_CONF_TALKER) {
-				/* Store temp value */
-				memcpy(k, putlin, DAHDI_CHUNKSIZE * sizeof(short));
-				/* Add conf value */
-				ACSS(k, conf_sums_next[ms->_confn]);
-				/*  get amount actually added */
-				memcpy(ms->conflast, k, DAHDI_CHUNKSIZE * sizeof(short));
-				SCSS(ms->conflast, conf_sums_next[ms->_confn]);
-				/* Really add in new value */
-				ACSS(conf_sums_next[ms->_confn], ms->conflast);
+				memcpy(ms->conflast, putlin, DAHDI_CHUNKSIZE * sizeof(short));
+				/* Add in new value */
+				ACSL(conf_sums_next[ms->_confn], putlin);
 			} else memset(ms->conflast, 0, DAHDI_CHUNKSIZE * sizeof(short));
 			  /* do the pseudo-channel part processing */
 			memset(putlin, 0, DAHDI_CHUNKSIZE * sizeof(short));
 			if (ms->confmode & DAHDI_CONF_PSEUDO_LISTENER) {
-				/* Subtract out previous last sample written to conf */
-				SCSS(putlin, ms->conflast2);
-				/* Add in conference */
-				ACSS(putlin, conf_sums[ms->_confn]);
+				/* Add in conference, minus the previous last
+				 * sample written to it */
+				MIXLS(putlin, conf_sums[ms->_confn],
+				      ms->conflast2);
 			}
 			/* Convert back */
 			for(x=0;x<DAHDI_CHUNKSIZE;x++)
@@ -9023,10 +9738,13 @@ static inline void __dahdi_process_putaudio_chunk(struct dahdi_chan *ss, unsigne
 			if (is_pseudo_chan(ms)) /* if a pseudo-channel */
 			   {
 				if (ms->confmode & DAHDI_CONF_LISTENER) {
-					/* Subtract out last sample written to conf */
-					SCSS(putlin, ms->conflast);
-					/* Add in conference */
-					ACSS(putlin, conf_sums[ms->_confn]);
+					/* Add in conference, minus the last
+					 * sample written to it */
+					if (ms->conf_silent)
+						MIXL(putlin, conf_sums[ms->_confn]);
+					else
+						MIXLS(putlin, conf_sums[ms->_confn],
+						      ms->conflast);
 				}
 				/* Convert back */
 				for(x=0;x<DAHDI_CHUNKSIZE;x++)
@@ -9036,38 +9754,33 @@ static inline void __dahdi_process_putaudio_chunk(struct dahdi_chan *ss, unsigne
 			   }
 			/* fall through */
 		case DAHDI_CONF_CONFANN:  /* Conference with announce */
-			if (ms->confmode & DAHDI_CONF_TALKER) {
-				/* Store temp value */
-				memcpy(k, putlin, DAHDI_CHUNKSIZE * sizeof(short));
-				/* Add conf value */
-				ACSS(k, conf_sums_next[ms->_confn]);
-				/*  get amount actually added */
-				memcpy(ms->conflast, k, DAHDI_CHUNKSIZE * sizeof(short));
-				SCSS(ms->conflast, conf_sums_next[ms->_confn]);
-				/* Really add in new value */
-				ACSS(conf_sums_next[ms->_confn], ms->conflast);
-			} else
+			is_conf = (ms->confmode & DAHDI_CONF_MODE_MASK) ==
+					DAHDI_CONF_CONF;
+			if ((ms->confmode & DAHDI_CONF_TALKER) &&
+			    (!is_conf ||
+			     conf_should_talk(ms, putlin, conf_talkers_next))) {
+				memcpy(ms->conflast, putlin, DAHDI_CHUNKSIZE * sizeof(short));
+				/* Add in new value */
+				ACSL(conf_sums_next[ms->_confn], putlin);
+				ms->conf_silent = 0;
+			} else if (is_conf)
+				conf_silence(ms);
+			else
 				memset(ms->conflast, 0, DAHDI_CHUNKSIZE * sizeof(short));
 			  /* rxc unmodified */
 			break;
 		case DAHDI_CONF_CONFMON:
 		case DAHDI_CONF_CONFANNMON:
 			if (ms->confmode & DAHDI_CONF_TALKER) {
-				/* Store temp value */
-				memcpy(k, putlin, DAHDI_CHUNKSIZE * sizeof(short));
 				/* Subtract last value */
-				SCSS(conf_sums[ms->_confn], ms->conflast);
-				/* Add conf value */
-				ACSS(k, conf_sums[ms->_confn]);
-				/*  get amount actually added */
-				memcpy(ms->conflast, k, DAHDI_CHUNKSIZE * sizeof(short));
-				SCSS(ms->conflast, conf_sums[ms->_confn]);
-				/* Really add in new value */
-				ACSS(conf_sums[ms->_confn], ms->conflast);
+				SCSL(conf_sums[ms->_confn], ms->conflast);
+				memcpy(ms->conflast, putlin, DAHDI_CHUNKSIZE * sizeof(short));
+				/* Add in new value */
+				ACSL(conf_sums[ms->_confn], putlin);
 			} else
 				memset(ms->conflast, 0, DAHDI_CHUNKSIZE * sizeof(short));
 			for (x=0;x<DAHDI_CHUNKSIZE;x++)
-				rxb[x] = DAHDI_LIN2X((int)conf_sums_prev[ms->_confn][x], ms);
+				rxb[x] = DAHDI_LIN2X(SAT16(conf_sums_prev[ms->_confn][x]), ms);
 			break;
 		case DAHDI_CONF_DIGITALMON:
 			  /* if not a pseudo-channel, ignore */
@@ -9300,6 +10013,10 @@ that the waitqueue is empty. */
 				/* Start over reading frame */
 				ms->readidx[ms->inreadbuf] = 0;
 				ms->infcs = PPP_INITFCS;
+				if (abort == DAHDI_EVENT_BADFCS)
+					ms->stats.hdlc_badfcs++;
+				else if (abort == DAHDI_EVENT_ABORT)
+					ms->stats.hdlc_aborts++;
 
 #ifdef CONFIG_DAHDI_NET
 				if (dahdi_have_netdev(ms)) {
@@ -9365,6 +10082,7 @@ that the waitqueue is empty. */
 
 	if (bytes) {
 		if (!test_bit(DAHDI_FLAGBIT_RXOVERRUN, &ms->flags)) {
+			ms->stats.rx_overruns++;
 			if (test_bit(DAHDI_FLAGBIT_BUFEVENTS, &ms->flags))
 				__qevent(ms, DAHDI_EVENT_READ_OVERRUN);
 			set_bit(DAHDI_FLAGBIT_RXOVERRUN, &ms->flags);
@@ -9650,7 +10368,8 @@ static inline void __dahdi_real_transmit(struct dahdi_chan *chan)
 #endif
 	if (chan->confmode) {
 		/* Pull queued data off the conference */
-		__buf_pull(&chan->confout, chan->writechunk, chan);
+		if (__buf_pull(&chan->confout, chan->writechunk, chan))
+			chan->stats.confout_underruns++;
 	} else {
 		__dahdi_transmit_chunk(chan, chan->writechunk);
 	}
@@ -9736,7 +10455,8 @@ static inline void __dahdi_real_receive(struct dahdi_chan *chan)
 #endif
 	if (chan->confmode) {
 		/* Load into queue if we have space */
-		__buf_push(&chan->confin, chan->readchunk);
+		if (__buf_push(&chan->confin, chan->readchunk))
+			chan->stats.confin_drops++;
 	} else {
 		__dahdi_receive_chunk(chan, chan->readchunk);
 	}
@@ -9932,25 +10652,20 @@ static void _process_masterspan(void)
 	}
 
 #ifdef CONFIG_DAHDI_CONFLINK
-	if (maxlinks) {
+	{
+		struct conf_link *link;
 		int z;
 		int y;
-#ifdef CONFIG_DAHDI_MMX
-		dahdi_kernel_fpu_begin();
-#endif
 		/* process all the conf links */
-		for (x = 1; x <= maxlinks; x++) {
+		list_for_each_entry(link, &conf_links, node) {
 			/* if we have a destination conf */
-			z = confalias[conf_links[x].dst];
+			z = confalias[link->dst];
 			if (z) {
-				y = confalias[conf_links[x].src];
+				y = confalias[link->src];
 				if (y)
-					ACSS(conf_sums[z], conf_sums[y]);
+					ACLL(conf_sums[z], conf_sums[y]);
 			}
 		}
-#ifdef CONFIG_DAHDI_MMX
-		dahdi_kernel_fpu_end();
-#endif
 	}
 #endif /* CONFIG_DAHDI_CONFLINK */
 
@@ -9969,6 +10684,8 @@ static void _process_masterspan(void)
 			__dahdi_transmit_chunk(chan, data);
 			if (data)
 				__buf_push(&chan->confout, NULL);
+			else
+				chan->stats.confout_drops++;
 			spin_unlock(&chan->lock);
 		}
 
@@ -10238,6 +10955,34 @@ MODULE_PARM_DESC(max_pseudo_channels, "Maximum number of pseudo channels.");
 module_param(hwec_overrides_swec, int, 0644);
 MODULE_PARM_DESC(hwec_overrides_swec, "When true, a hardware echo canceller is used instead of configured SWEC.");
 
+module_param(max_conferences, int, 0444);
+MODULE_PARM_DESC(max_conferences,
+		 "Highest conference number user space may use (default "
+		 __stringify(DAHDI_MAX_CONF) "). Conference storage is "
+		 "allocated as conferences are created.");
+
+#ifdef CONFIG_DAHDI_CONFLINK
+module_param(max_conflinks, int, 0644);
+MODULE_PARM_DESC(max_conflinks,
+		 "Most conference links DAHDI_CONFLINK may set up (default "
+		 __stringify(DAHDI_MAX_CONF) ").");
+#endif
+
+module_param(conf_vad_threshold, int, 0644);
+MODULE_PARM_DESC(conf_vad_threshold,
+		 "Mean linear amplitude below which a DAHDI_CONF_CONF member "
+		 "is treated as silent and not mixed. 0 (default) disables.");
+
+module_param(conf_vad_hangover, int, 0644);
+MODULE_PARM_DESC(conf_vad_hangover,
+		 "How long (ms) a conference member keeps being mixed after "
+		 "dropping below conf_vad_threshold.");
+
+module_param(conf_max_talkers, int, 0644);
+MODULE_PARM_DESC(conf_max_talkers,
+		 "Mix at most this many (up to 8) of the loudest talkers into "
+		 "each DAHDI_CONF_CONF conference. 0 (default) mixes all.");
+
 module_param(auto_assign_spans, int, 0644);
 MODULE_PARM_DESC(auto_assign_spans,
 		 "If 1 spans will automatically have their children span and "
@@ -10446,10 +11191,35 @@ static int __init dahdi_init(void)
 	int res = 0;
 
 	module_printk(KERN_INFO, "Version: %s\n", dahdi_version);
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 23)
+	pseudo_cache = kmem_cache_create("dahdi_pseudo",
+					 sizeof(struct pseudo_chan), 0,
+					 SLAB_HWCACHE_ALIGN, NULL, NULL);
+#else
+	pseudo_cache = kmem_cache_create("dahdi_pseudo",
+					 sizeof(struct pseudo_chan), 0,
+					 SLAB_HWCACHE_ALIGN, NULL);
+#endif
+	if (!pseudo_cache)
+		return -ENOMEM;
+
+	if (max_conferences < 1)
+		max_conferences = 1;
+	confalias = kcalloc(max_conferences + 1, sizeof(*confalias),
+			    GFP_KERNEL);
+	if (!confalias || dahdi_conf_reserve()) {
+		dahdi_conf_free();
+		kmem_cache_destroy(pseudo_cache);
+		return -ENOMEM;
+	}
+
 #ifdef CONFIG_PROC_FS
 	root_proc_entry = proc_mkdir("dahdi", NULL);
 	if (!root_proc_entry) {
 		dahdi_err("dahdi init: Failed creating /proc/dahdi\n");
+		dahdi_conf_free();
+		kmem_cache_destroy(pseudo_cache);
 		return -EEXIST;
 	}
 #endif
@@ -10481,6 +11251,8 @@ failed_driver_init:
 		remove_proc_entry("dahdi", NULL);
 		root_proc_entry = NULL;
 	}
+	dahdi_conf_free();
+	kmem_cache_destroy(pseudo_cache);
 	return res;
 }
 
@@ -10547,6 +11319,9 @@ static void __exit dahdi_cleanup(void)
 	watchdog_cleanup();
 #endif
 	flush_find_master_work();
+	dahdi_conf_free();
+	kmem_cache_destroy(pseudo_cache);
+	ida_destroy(&pseudo_ida);
 }
 
 module_init(dahdi_init);
@@ -69,6 +69,24 @@ chan_attr(blocksize, "%d\n");
 chan_attr(chanmute, "%d\n");
 #endif
 
+#define chan_stat_attr(field)			\
+static BUS_ATTR_READER(field##_show, dev, buf)	\
+{						\
+	struct dahdi_chan *chan;		\
+						\
+	chan = dev_to_chan(dev);		\
+	return sprintf(buf, "%u\n", chan->stats.field); \
+}
+
+chan_stat_attr(rx_overruns);
+chan_stat_attr(tx_underruns);
+chan_stat_attr(confin_drops);
+chan_stat_attr(confout_drops);
+chan_stat_attr(confout_underruns);
+chan_stat_attr(hdlc_aborts);
+chan_stat_attr(hdlc_badfcs);
+chan_stat_attr(ec_events);
+
 static BUS_ATTR_READER(sigcap_show, dev, buf)
 {
 	struct dahdi_chan *chan;
@@ -172,9 +190,55 @@ static struct device_attribute chan_dev_attrs[] = {
 	__ATTR_RO(chanmute),
 #endif
 	__ATTR_RO(in_use),
+	__ATTR_RO(rx_overruns),
+	__ATTR_RO(tx_underruns),
+	__ATTR_RO(confin_drops),
+	__ATTR_RO(confout_drops),
+	__ATTR_RO(confout_underruns),
+	__ATTR_RO(hdlc_aborts),
+	__ATTR_RO(hdlc_badfcs),
+	__ATTR_RO(ec_events),
 	__ATTR_NULL,
 };
 
+/*
+ * All the counters above as one struct dahdi_chan_stats, so a monitor
+ * can sample every channel with a single read() each.
+ */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 35)
+static ssize_t chan_stats_read(struct file *filp, struct kobject *kobj,
+		struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+#else
+static ssize_t chan_stats_read(struct kobject *kobj,
+		struct bin_attribute *attr, char *buf, loff_t off, size_t count)
+#endif
+{
+	struct device *dev = container_of(kobj, struct device, kobj);
+	struct dahdi_chan *chan = dev_to_chan(dev);
+	struct dahdi_chan_stats stats;
+	unsigned long flags;
+
+	if (off >= sizeof(stats))
+		return 0;
+	if (count > sizeof(stats) - off)
+		count = sizeof(stats) - off;
+	spin_lock_irqsave(&chan->lock, flags);
+	stats = chan->stats;
+	spin_unlock_irqrestore(&chan->lock, flags);
+	stats.version = DAHDI_CHAN_STATS_VERSION;
+	memcpy(buf, (char *)&stats + off, count);
+	return count;
+}
+
+static struct bin_attribute chan_stats_attr = {
+	.attr = {
+		.name = "stats",
+		.mode = S_IRUGO,
+	},
+	.size = sizeof(struct dahdi_chan_stats),
+	.read = chan_stats_read,
+};
+
 static void chan_release(struct device *dev)
 {
 	struct dahdi_chan *chan;
@@ -257,6 +321,13 @@ int chan_sysfs_create(struct dahdi_chan *chan)
 		put_device(dev);
 		return res;
 	}
+	res = device_create_bin_file(dev, &chan_stats_attr);
+	if (res) {
+		chan_err(chan, "%s: device_create_bin_file failed: %d\n",
+				__func__, res);
+		device_unregister(dev);
+		return res;
+	}
 	set_bit(DAHDI_FLAGBIT_DEVFILE, &chan->flags);
 	return 0;
 }
@@ -272,6 +343,7 @@ void chan_sysfs_remove(struct dahdi_chan *chan)
 		return;
 	dev = &chan->chan_device;
 	BUG_ON(dev_get_drvdata(dev) != chan);
+	device_remove_bin_file(dev, &chan_stats_attr);
 	device_unregister(dev);
 	/* FIXME: should have been done earlier in dahdi_chan_unreg */
 	chan->channo = -1;
@@ -27,7 +27,9 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/spinlock.h>
+#include <linux/bitops.h>
 #include <linux/slab.h>
+#include <linux/file.h>
 #include <linux/kmod.h>
 #include <linux/sched.h>
 #include <linux/interrupt.h>
@@ -58,12 +60,15 @@ struct dahdi_transcoder *dahdi_transcoder_alloc(int numchans)
 {
 	struct dahdi_transcoder *tc;
 	unsigned int x;
-	size_t size = sizeof(*tc) + (sizeof(tc->channels[0]) * numchans);
+	size_t size = sizeof(*tc) + (sizeof(tc->channels[0]) * numchans) +
+		      (BITS_TO_LONGS(numchans) * sizeof(unsigned long));
 
 	if (!(tc = kmalloc(size, GFP_KERNEL)))
 		return NULL;
 
 	memset(tc, 0, size);
+	/* The busy bitmap lives just past the channel array. */
+	tc->busy_map = (unsigned long *)&tc->channels[numchans];
 	strcpy(tc->name, "<unspecified>");
 	INIT_LIST_HEAD(&tc->registration_list_node);
 	INIT_LIST_HEAD(&tc->active_list_node);
@@ -165,11 +170,19 @@ static int dahdi_tc_open(struct inode *inode, struct file *file)
 
 static void dtc_release(struct dahdi_transcoder_channel *chan)
 {
+	struct dahdi_transcoder *tc;
+
 	BUG_ON(!chan);
-	if (chan->parent && chan->parent->release) {
-		chan->parent->release(chan);
+	tc = chan->parent;
+	if (tc && tc->release) {
+		tc->release(chan);
 	}
+
+	spin_lock(&translock);
 	dahdi_tc_clear_busy(chan);
+	if (tc)
+		__clear_bit(chan - tc->channels, tc->busy_map);
+	spin_unlock(&translock);
 }
 
 static int dahdi_tc_release(struct inode *inode, struct file *file)
@@ -184,34 +197,33 @@ static int dahdi_tc_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
-/* Find a free channel on the transcoder and mark it busy. */
+/* Find a free channel on the transcoder and mark it busy.
+ *
+ * Only the channels clear in busy_map are visited, so a transcoder that is
+ * mostly (or completely) in use is passed over quickly. */
 static inline struct dahdi_transcoder_channel *
 get_free_channel(struct dahdi_transcoder *tc,
 	const struct dahdi_transcoder_formats *fmts)
 {
 	struct dahdi_transcoder_channel *chan;
+	const u32 wanted_fmts = fmts->srcfmt | fmts->dstfmt;
 	int i;
 	/* Should be called with the translock held. */
 #ifdef CONFIG_SMP
 	WARN_ON(!spin_is_locked(&translock));
 #endif
 
-	for (i = 0; i < tc->numchannels; i++) {
+	for (i = find_first_zero_bit(tc->busy_map, tc->numchannels);
+	     i < tc->numchannels;
+	     i = find_next_zero_bit(tc->busy_map, tc->numchannels, i + 1)) {
 		chan = &tc->channels[i];
-		if (!dahdi_tc_is_busy(chan)) {
-			if (!dahdi_tc_is_built(chan)) {
-				dahdi_tc_set_busy(chan);
-				return chan;
-			} else {
-				/* If the channel is already built, we must
-				 * make sure that it can support the formats
-				 * that we're interested in. */
-				if ((fmts->srcfmt|fmts->dstfmt) == chan->built_fmts) {
-					dahdi_tc_set_busy(chan);
-					return chan;
-				}
-			}
-		}
+		/* If the channel is already built, we must make sure that it
+		 * can support the formats that we're interested in. */
+		if (dahdi_tc_is_built(chan) && (wanted_fmts != chan->built_fmts))
+			continue;
+		__set_bit(i, tc->busy_map);
+		dahdi_tc_set_busy(chan);
+		return chan;
 	}
 	return NULL;
 }
@@ -366,6 +378,139 @@ static ssize_t dahdi_tc_read(struct file *file, __user char *usrbuf, size_t coun
 	}
 }
 
+/* Number of distinct transcoders that are told about a single batch. Frames
+ * for any further transcoders are still handled, just not bracketed. */
+#define DAHDI_TC_BATCH_PARENTS	4
+
+/* Returns the transcoder channel behind file, or NULL if file is not an
+ * allocated transcoder. */
+static struct dahdi_transcoder_channel *dahdi_tc_file_to_chan(struct file *file)
+{
+	if (!file->f_op || file->f_op->release != dahdi_tc_release)
+		return NULL;
+	return file->private_data;
+}
+
+static ssize_t dahdi_tc_batch_one(struct file *file,
+	struct dahdi_transcoder_channel *chan,
+	const struct dahdi_transcoder_frame *f, bool submit)
+{
+	loff_t pos = 0;
+
+	if (submit) {
+		return file->f_op->write(file,
+				(__user const char *)(unsigned long)f->buf,
+				f->len, &pos);
+	}
+	/* Do not let a blocking channel put the whole batch to sleep. */
+	if (!dahdi_tc_is_data_waiting(chan))
+		return -EAGAIN;
+	return file->f_op->read(file, (__user char *)(unsigned long)f->buf,
+				f->len, &pos);
+}
+
+/* Handles DAHDI_TC_SUBMIT_BATCH and DAHDI_TC_RETRIEVE_BATCH.
+ *
+ * The frames are processed in order, each through the read / write method of
+ * the driver that owns the channel, so the per-frame semantics are the same
+ * as a sequence of read(2) / write(2) calls.  On submit, drivers that
+ * implement batch_begin / batch_end get to hold the frames back and hand
+ * them to the hardware in one go. */
+static long dahdi_tc_batch(unsigned long data, bool submit)
+{
+	struct dahdi_transcoder_batch batch;
+	struct dahdi_transcoder_frame *frames;
+	struct dahdi_transcoder *begun[DAHDI_TC_BATCH_PARENTS];
+	struct file *pinned[DAHDI_TC_BATCH_PARENTS];
+	unsigned int nbegun = 0;
+	unsigned int i, j;
+	size_t size;
+	long res = 0;
+
+	if (copy_from_user(&batch, (__user const void *) data, sizeof(batch)))
+		return -EFAULT;
+
+	if (!batch.count || batch.count > DAHDI_TC_MAX_BATCH)
+		return -EINVAL;
+
+	size = batch.count * sizeof(*frames);
+	frames = kmalloc(size, GFP_KERNEL);
+	if (!frames)
+		return -ENOMEM;
+
+	if (copy_from_user(frames, (__user const void *)(unsigned long)
+			   batch.frames, size)) {
+		kfree(frames);
+		return -EFAULT;
+	}
+
+	batch.completed = 0;
+	for (i = 0; i < batch.count; ++i) {
+		struct dahdi_transcoder_frame *const f = &frames[i];
+		struct dahdi_transcoder_channel *chan;
+		struct dahdi_transcoder *tc;
+		struct file *file;
+		ssize_t ret;
+
+		file = fget(f->fd);
+		if (!file) {
+			f->result = -EBADF;
+			f->len = 0;
+			continue;
+		}
+
+		chan = dahdi_tc_file_to_chan(file);
+		if (!chan) {
+			fput(file);
+			f->result = -EINVAL;
+			f->len = 0;
+			continue;
+		}
+
+		tc = chan->parent;
+		if (submit && tc->batch_begin && nbegun < ARRAY_SIZE(begun)) {
+			for (j = 0; j < nbegun; ++j) {
+				if (begun[j] == tc)
+					break;
+			}
+			if (j == nbegun) {
+				/* Holding on to this file keeps the driver
+				 * around until batch_end has been called. */
+				get_file(file);
+				pinned[nbegun] = file;
+				begun[nbegun++] = tc;
+				tc->batch_begin(tc);
+			}
+		}
+
+		ret = dahdi_tc_batch_one(file, chan, f, submit);
+		fput(file);
+
+		if (ret < 0) {
+			f->result = ret;
+			f->len = 0;
+		} else {
+			f->result = 0;
+			f->len = ret;
+			++batch.completed;
+		}
+	}
+
+	for (j = 0; j < nbegun; ++j) {
+		if (begun[j]->batch_end)
+			begun[j]->batch_end(begun[j]);
+		fput(pinned[j]);
+	}
+
+	if (copy_to_user((__user void *)(unsigned long)batch.frames,
+			 frames, size) ||
+	    copy_to_user((__user void *) data, &batch, sizeof(batch)))
+		res = -EFAULT;
+
+	kfree(frames);
+	return res;
+}
+
 static long dahdi_tc_unlocked_ioctl(struct file *file, unsigned int cmd, unsigned long data)
 {
 	switch (cmd) {
@@ -373,6 +518,10 @@ static long dahdi_tc_unlocked_ioctl(struct file *file, unsigned int cmd, unsigne
 		return dahdi_tc_allocate(file, data);
 	case DAHDI_TC_GETINFO:
 		return dahdi_tc_getinfo(data);
+	case DAHDI_TC_SUBMIT_BATCH:
+		return dahdi_tc_batch(data, true);
+	case DAHDI_TC_RETRIEVE_BATCH:
+		return dahdi_tc_batch(data, false);
 	case DAHDI_TRANSCODE_OP:
 		/* This is a deprecated call from the previous transcoder
 		 * interface, which was all routed through the dahdi_ioctl in
@@ -0,0 +1,956 @@
+/*
+ * Software transcoder for DAHDI
+ *
+ * Implements the dahdi_transcoder interface entirely on the host CPU so that
+ * applications written against /dev/dahdi/transcode work on systems without
+ * transcoding hardware, and so that hardware transcoders have a reference to
+ * be measured against.
+ *
+ * Frames written to a channel are queued and transcoded on a workqueue; the
+ * results are read back exactly as they would be from a hardware transcoder.
+ *
+ * The G.726 code is derived from the Sun Microsystems reference
+ * implementation, which was placed in the public domain.
+ *
+ * Copyright (C) 2026, DAHDI Linux contributors
+ *
+ * All rights reserved.
+ *
+ */
+
+/*
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/moduleparam.h>
+#include <asm/uaccess.h>
+
+#include <dahdi/kernel.h>
+
+static int debug;
+static int numchannels = 32;
+
+/* Largest frame accepted, in samples (60ms at 8kHz). */
+#define SOFT_MAX_SAMPLES	480
+/* Frames allowed to be outstanding (written but not read) per channel. */
+#define SOFT_MAX_QUEUED		16
+
+/* G.726 32kbit/s (G.721) state. */
+struct g726_state {
+	long yl;	/* Locked or steady state step size multiplier. */
+	short yu;	/* Unlocked or non-steady state step size multiplier. */
+	short dms;	/* Short term energy estimate. */
+	short dml;	/* Long term energy estimate. */
+	short ap;	/* Linear weighting coefficient of 'yl' and 'yu'. */
+	short a[2];	/* Coefficients of pole portion of prediction filter. */
+	short b[6];	/* Coefficients of zero portion of prediction filter. */
+	short pk[2];	/* Signs of previous two samples of a partially
+			 * reconstructed signal. */
+	short dq[6];	/* Previous 6 samples of the quantized difference
+			 * signal, in floating point. */
+	short sr[2];	/* Previous 2 samples of the reconstructed signal,
+			 * in floating point. */
+	char td;	/* Delayed tone detect. */
+};
+
+/* Dialogic / OKI ADPCM state. */
+struct adpcm_state {
+	int signal;
+	int ssindex;
+};
+
+union soft_codec_state {
+	struct g726_state g726;
+	struct adpcm_state adpcm;
+};
+
+struct soft_codec {
+	u32 format;
+	const char *name;
+	unsigned int bits_per_sample;
+	void (*init)(union soft_codec_state *st);
+	void (*decode)(union soft_codec_state *st, const u8 *in,
+		       unsigned int samples, s16 *out);
+	void (*encode)(union soft_codec_state *st, const s16 *in,
+		       unsigned int samples, u8 *out);
+};
+
+struct soft_frame {
+	struct list_head node;
+	size_t len;
+	u8 data[0];
+};
+
+struct soft_chan {
+	struct dahdi_transcoder_channel *dtc;
+	const struct soft_codec *src;
+	const struct soft_codec *dst;
+	union soft_codec_state dec;
+	union soft_codec_state enc;
+	spinlock_t lock;
+	struct list_head in_queue;
+	struct list_head out_queue;
+	unsigned int queued;
+	/* Serializes the codec state if the work runs on two CPUs at once. */
+	struct mutex codec_lock;
+	struct work_struct work;
+	s16 linear[SOFT_MAX_SAMPLES];
+};
+
+static struct dahdi_transcoder *soft_tc;
+static struct soft_chan *soft_chans;
+static struct workqueue_struct *soft_wq;
+
+/* ---- G.711 ---- */
+
+static void ulaw_decode(union soft_codec_state *st, const u8 *in,
+			unsigned int samples, s16 *out)
+{
+	while (samples--)
+		*out++ = DAHDI_MULAW(*in++);
+}
+
+static void ulaw_encode(union soft_codec_state *st, const s16 *in,
+			unsigned int samples, u8 *out)
+{
+	while (samples--)
+		*out++ = DAHDI_LIN2MU(*in++);
+}
+
+static void alaw_decode(union soft_codec_state *st, const u8 *in,
+			unsigned int samples, s16 *out)
+{
+	while (samples--)
+		*out++ = DAHDI_ALAW(*in++);
+}
+
+static void alaw_encode(union soft_codec_state *st, const s16 *in,
+			unsigned int samples, u8 *out)
+{
+	while (samples--)
+		*out++ = DAHDI_LIN2A(*in++);
+}
+
+/* ---- Signed linear, host byte order ---- */
+
+static void slin_decode(union soft_codec_state *st, const u8 *in,
+			unsigned int samples, s16 *out)
+{
+	memcpy(out, in, samples * sizeof(s16));
+}
+
+static void slin_encode(union soft_codec_state *st, const s16 *in,
+			unsigned int samples, u8 *out)
+{
+	memcpy(out, in, samples * sizeof(s16));
+}
+
+/* ---- G.726 32kbit/s, RFC 3551 packing (first sample in the low nibble) ---- */
+
+static const short power2[15] = {1, 2, 4, 8, 0x10, 0x20, 0x40, 0x80,
+	0x100, 0x200, 0x400, 0x800, 0x1000, 0x2000, 0x4000};
+
+static const short qtab_721[7] = {-124, 80, 178, 246, 300, 349, 400};
+/* Maps G.721 code word to reconstructed scale factor normalized log
+ * magnitude values. */
+static const short dqlntab[16] = {-2048, 4, 135, 213, 273, 323, 373, 425,
+	425, 373, 323, 273, 213, 135, 4, -2048};
+/* Maps G.721 code word to log of scale factor multiplier. */
+static const short witab[16] = {-12, 18, 41, 64, 112, 198, 355, 1122,
+	1122, 355, 198, 112, 64, 41, 18, -12};
+/* Maps G.721 code words to a set of values whose long and short term
+ * averages are computed and then compared to give an indication how
+ * stationary (steady state) the signal is. */
+static const short fitab[16] = {0, 0, 0, 0x200, 0x200, 0x200, 0x600, 0xE00,
+	0xE00, 0x600, 0x200, 0x200, 0x200, 0, 0, 0};
+
+/* Returns the index of the first entry in table that val is less than. */
+static int quan(int val, const short *table, int size)
+{
+	int i;
+	for (i = 0; i < size; i++) {
+		if (val < *table++)
+			break;
+	}
+	return i;
+}
+
+/* Multiply the predictor coefficient an with the floating point value srn. */
+static int fmult(int an, int srn)
+{
+	short anmag, anexp, anmant;
+	short wanexp, wanmant;
+	short retval;
+
+	anmag = (an > 0) ? an : ((-an) & 0x1FFF);
+	anexp = quan(anmag, power2, 15) - 6;
+	anmant = (anmag == 0) ? 32 :
+		 (anexp >= 0) ? anmag >> anexp : anmag << -anexp;
+	wanexp = anexp + ((srn >> 6) & 0xF) - 13;
+
+	wanmant = (anmant * (srn & 077) + 0x30) >> 4;
+	retval = (wanexp >= 0) ? ((wanmant << wanexp) & 0x7FFF) :
+		 (wanmant >> -wanexp);
+
+	return ((an ^ srn) < 0) ? -retval : retval;
+}
+
+static void g726_init(union soft_codec_state *st)
+{
+	struct g726_state *s = &st->g726;
+	int i;
+
+	memset(s, 0, sizeof(*s));
+	s->yl = 34816;
+	s->yu = 544;
+	for (i = 0; i < 2; i++)
+		s->sr[i] = 32;
+	for (i = 0; i < 6; i++)
+		s->dq[i] = 32;
+}
+
+static int g726_predictor_zero(const struct g726_state *s)
+{
+	int i;
+	int sezi = fmult(s->b[0] >> 2, s->dq[0]);
+
+	for (i = 1; i < 6; i++)
+		sezi += fmult(s->b[i] >> 2, s->dq[i]);
+	return sezi;
+}
+
+static int g726_predictor_pole(const struct g726_state *s)
+{
+	return fmult(s->a[1] >> 2, s->sr[1]) + fmult(s->a[0] >> 2, s->sr[0]);
+}
+
+static int g726_step_size(const struct g726_state *s)
+{
+	int y, dif, al;
+
+	if (s->ap >= 256)
+		return s->yu;
+
+	y = s->yl >> 6;
+	dif = s->yu - y;
+	al = s->ap >> 2;
+	if (dif > 0)
+		y += (dif * al) >> 6;
+	else if (dif < 0)
+		y += (dif * al + 0x3F) >> 6;
+	return y;
+}
+
+static int g726_quantize(int d, int y, const short *table, int size)
+{
+	short dqm, exp, mant, dl, dln, i;
+
+	dqm = abs(d);
+	exp = quan(dqm >> 1, power2, 15);
+	mant = ((dqm << 7) >> exp) & 0x7F;
+	dl = (exp << 7) + mant;
+	dln = dl - (y >> 2);
+	i = quan(dln, table, size);
+	if (d < 0)
+		return (size << 1) + 1 - i;
+	else if (i == 0)
+		return (size << 1) + 1;
+	else
+		return i;
+}
+
+static int g726_reconstruct(int sign, int dqln, int y)
+{
+	short dql, dex, dqt, dq;
+
+	dql = dqln + (y >> 2);
+	if (dql < 0)
+		return (sign) ? -0x8000 : 0;
+
+	dex = (dql >> 7) & 15;
+	dqt = 128 + (dql & 127);
+	dq = (dqt << 7) >> (14 - dex);
+	return (sign) ? (dq - 0x8000) : dq;
+}
+
+static short g726_float(int mag)
+{
+	short exp = quan(mag, power2, 15);
+	return (exp << 6) + ((mag << 6) >> exp);
+}
+
+static void g726_update(int y, int wi, int fi, int dq, int sr, int dqsez,
+			struct g726_state *s)
+{
+	int cnt;
+	short mag;
+	short a2p = 0;
+	short a1ul;
+	short pks1;
+	short fa1;
+	char tr;
+	short ylint, thr2, dqthr;
+	short ylfrac, thr1;
+	short pk0;
+
+	pk0 = (dqsez < 0) ? 1 : 0;
+	mag = dq & 0x7FFF;
+
+	/* Transition detect */
+	ylint = s->yl >> 15;
+	ylfrac = (s->yl >> 10) & 0x1F;
+	thr1 = (32 + ylfrac) << ylint;
+	thr2 = (ylint > 9) ? 31 << 10 : thr1;
+	dqthr = (thr2 + (thr2 >> 1)) >> 1;
+	tr = (s->td && mag > dqthr) ? 1 : 0;
+
+	/* Quantizer scale factor adaptation. */
+	s->yu = y + ((wi - y) >> 5);
+	if (s->yu < 544)
+		s->yu = 544;
+	else if (s->yu > 5120)
+		s->yu = 5120;
+	s->yl += s->yu + ((-s->yl) >> 6);
+
+	/* Adaptive predictor coefficients. */
+	if (tr) {
+		s->a[0] = 0;
+		s->a[1] = 0;
+		for (cnt = 0; cnt < 6; cnt++)
+			s->b[cnt] = 0;
+	} else {
+		pks1 = pk0 ^ s->pk[0];
+
+		a2p = s->a[1] - (s->a[1] >> 7);
+		if (dqsez != 0) {
+			fa1 = (pks1) ? s->a[0] : -s->a[0];
+			if (fa1 < -8191)
+				a2p -= 0x100;
+			else if (fa1 > 8191)
+				a2p += 0xFF;
+			else
+				a2p += fa1 >> 5;
+
+			if (pk0 ^ s->pk[1]) {
+				if (a2p <= -12160)
+					a2p = -12288;
+				else if (a2p >= 12416)
+					a2p = 12288;
+				else
+					a2p -= 0x80;
+			} else if (a2p <= -12416) {
+				a2p = -12288;
+			} else if (a2p >= 12160) {
+				a2p = 12288;
+			} else {
+				a2p += 0x80;
+			}
+		}
+		s->a[1] = a2p;
+
+		s->a[0] -= s->a[0] >> 8;
+		if (dqsez != 0) {
+			if (pks1 == 0)
+				s->a[0] += 192;
+			else
+				s->a[0] -= 192;
+		}
+
+		a1ul = 15360 - a2p;
+		if (s->a[0] < -a1ul)
+			s->a[0] = -a1ul;
+		else if (s->a[0] > a1ul)
+			s->a[0] = a1ul;
+
+		for (cnt = 0; cnt < 6; cnt++) {
+			s->b[cnt] -= s->b[cnt] >> 8;
+			if (dq & 0x7FFF) {
+				if ((dq ^ s->dq[cnt]) >= 0)
+					s->b[cnt] += 128;
+				else
+					s->b[cnt] -= 128;
+			}
+		}
+	}
+
+	for (cnt = 5; cnt > 0; cnt--)
+		s->dq[cnt] = s->dq[cnt - 1];
+	if (mag == 0)
+		s->dq[0] = (dq >= 0) ? 0x20 : 0xFC20;
+	else
+		s->dq[0] = g726_float(mag) - ((dq >= 0) ? 0 : 0x400);
+
+	s->sr[1] = s->sr[0];
+	if (sr == 0)
+		s->sr[0] = 0x20;
+	else if (sr > 0)
+		s->sr[0] = g726_float(sr);
+	else if (sr > -32768)
+		s->sr[0] = g726_float(-sr) - 0x400;
+	else
+		s->sr[0] = 0xFC20;
+
+	s->pk[1] = s->pk[0];
+	s->pk[0] = pk0;
+
+	/* Tone detect */
+	if (tr)
+		s->td = 0;
+	else
+		s->td = (a2p < -11776) ? 1 : 0;
+
+	/* Adaptation speed control. */
+	s->dms += (fi - s->dms) >> 5;
+	s->dml += (((fi << 2) - s->dml) >> 7);
+
+	if (tr)
+		s->ap = 256;
+	else if (y < 1536)
+		s->ap += (0x200 - s->ap) >> 4;
+	else if (s->td)
+		s->ap += (0x200 - s->ap) >> 4;
+	else if (abs((s->dms << 2) - s->dml) >= (s->dml >> 3))
+		s->ap += (0x200 - s->ap) >> 4;
+	else
+		s->ap += (-s->ap) >> 4;
+}
+
+static int g726_encode_sample(struct g726_state *s, int sl)
+{
+	short sezi, se, sez;
+	short d, sr, y, dqsez, dq, i;
+
+	sl >>= 2;	/* 14 bit dynamic range */
+
+	sezi = g726_predictor_zero(s);
+	sez = sezi >> 1;
+	se = (sezi + g726_predictor_pole(s)) >> 1;
+
+	d = sl - se;
+
+	y = g726_step_size(s);
+	i = g726_quantize(d, y, qtab_721, 7);
+
+	dq = g726_reconstruct(i & 8, dqlntab[i], y);
+
+	sr = (dq < 0) ? se - (dq & 0x3FFF) : se + dq;
+
+	dqsez = sr + sez - se;
+
+	g726_update(y, witab[i] << 5, fitab[i], dq, sr, dqsez, s);
+
+	return i;
+}
+
+static int g726_decode_sample(struct g726_state *s, int i)
+{
+	short sezi, sez, se;
+	short y, sr, dq, dqsez;
+
+	i &= 0x0f;
+	sezi = g726_predictor_zero(s);
+	sez = sezi >> 1;
+	se = (sezi + g726_predictor_pole(s)) >> 1;
+
+	y = g726_step_size(s);
+
+	dq = g726_reconstruct(i & 0x08, dqlntab[i], y);
+
+	sr = (dq < 0) ? (se - (dq & 0x3FFF)) : se + dq;
+
+	dqsez = sr - se + sez;
+
+	g726_update(y, witab[i] << 5, fitab[i], dq, sr, dqsez, s);
+
+	return sr << 2;
+}
+
+static void g726_decode(union soft_codec_state *st, const u8 *in,
+			unsigned int samples, s16 *out)
+{
+	unsigned int x;
+
+	for (x = 0; x < samples; x++) {
+		u8 code = (x & 1) ? (in[x >> 1] >> 4) : (in[x >> 1] & 0xf);
+		out[x] = g726_decode_sample(&st->g726, code);
+	}
+}
+
+static void g726_encode(union soft_codec_state *st, const s16 *in,
+			unsigned int samples, u8 *out)
+{
+	unsigned int x;
+
+	for (x = 0; x < samples; x++) {
+		u8 code = g726_encode_sample(&st->g726, in[x]);
+		if (x & 1)
+			out[x >> 1] |= code << 4;
+		else
+			out[x >> 1] = code;
+	}
+}
+
+/* ---- Dialogic / OKI ADPCM (first sample in the high nibble) ---- */
+
+static const short adpcm_steps[49] = {
+	16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66,
+	73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253,
+	279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876,
+	963, 1060, 1166, 1282, 1411, 1552
+};
+
+static const short adpcm_index_adjust[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+static void adpcm_init(union soft_codec_state *st)
+{
+	st->adpcm.signal = 0;
+	st->adpcm.ssindex = 0;
+}
+
+/* Returns the new 12 bit signal after applying code word enc. */
+static int adpcm_decode_sample(struct adpcm_state *s, u8 enc)
+{
+	int step = adpcm_steps[s->ssindex];
+	int diff = step >> 3;
+
+	if (enc & 4)
+		diff += step;
+	if (enc & 2)
+		diff += step >> 1;
+	if (enc & 1)
+		diff += step >> 2;
+	if (enc & 8)
+		diff = -diff;
+
+	s->signal += diff;
+	if (s->signal > 2047)
+		s->signal = 2047;
+	else if (s->signal < -2048)
+		s->signal = -2048;
+
+	s->ssindex += adpcm_index_adjust[enc & 7];
+	if (s->ssindex < 0)
+		s->ssindex = 0;
+	else if (s->ssindex > 48)
+		s->ssindex = 48;
+
+	return s->signal;
+}
+
+static u8 adpcm_encode_sample(struct adpcm_state *s, int sample)
+{
+	int step = adpcm_steps[s->ssindex];
+	int diff = (sample >> 4) - s->signal;
+	u8 enc = 0;
+
+	if (diff < 0) {
+		enc = 8;
+		diff = -diff;
+	}
+	if (diff >= step) {
+		enc |= 4;
+		diff -= step;
+	}
+	step >>= 1;
+	if (diff >= step) {
+		enc |= 2;
+		diff -= step;
+	}
+	step >>= 1;
+	if (diff >= step)
+		enc |= 1;
+
+	/* Track exactly what the decoder on the far end will see. */
+	adpcm_decode_sample(s, enc);
+	return enc;
+}
+
+static void adpcm_decode(union soft_codec_state *st, const u8 *in,
+			 unsigned int samples, s16 *out)
+{
+	unsigned int x;
+
+	for (x = 0; x < samples; x++) {
+		u8 code = (x & 1) ? (in[x >> 1] & 0xf) : (in[x >> 1] >> 4);
+		out[x] = adpcm_decode_sample(&st->adpcm, code) << 4;
+	}
+}
+
+static void adpcm_encode(union soft_codec_state *st, const s16 *in,
+			 unsigned int samples, u8 *out)
+{
+	unsigned int x;
+
+	for (x = 0; x < samples; x++) {
+		u8 code = adpcm_encode_sample(&st->adpcm, in[x]);
+		if (x & 1)
+			out[x >> 1] |= code;
+		else
+			out[x >> 1] = code << 4;
+	}
+}
+
+/* Adding a codec only requires an entry here. */
+static const struct soft_codec soft_codecs[] = {
+	{
+		.format = DAHDI_FORMAT_ULAW,
+		.name = "ulaw",
+		.bits_per_sample = 8,
+		.decode = ulaw_decode,
+		.encode = ulaw_encode,
+	},
+	{
+		.format = DAHDI_FORMAT_ALAW,
+		.name = "alaw",
+		.bits_per_sample = 8,
+		.decode = alaw_decode,
+		.encode = alaw_encode,
+	},
+	{
+		.format = DAHDI_FORMAT_SLINEAR,
+		.name = "slinear",
+		.bits_per_sample = 16,
+		.decode = slin_decode,
+		.encode = slin_encode,
+	},
+	{
+		.format = DAHDI_FORMAT_G726,
+		.name = "g726",
+		.bits_per_sample = 4,
+		.init = g726_init,
+		.decode = g726_decode,
+		.encode = g726_encode,
+	},
+	{
+		.format = DAHDI_FORMAT_ADPCM,
+		.name = "adpcm",
+		.bits_per_sample = 4,
+		.init = adpcm_init,
+		.decode = adpcm_decode,
+		.encode = adpcm_encode,
+	},
+};
+
+static const struct soft_codec *soft_find_codec(u32 format)
+{
+	int i;
+	for (i = 0; i < ARRAY_SIZE(soft_codecs); ++i) {
+		if (soft_codecs[i].format == format)
+			return &soft_codecs[i];
+	}
+	return NULL;
+}
+
+static u32 soft_all_formats(void)
+{
+	u32 formats = 0;
+	int i;
+	for (i = 0; i < ARRAY_SIZE(soft_codecs); ++i)
+		formats |= soft_codecs[i].format;
+	return formats;
+}
+
+static inline size_t
+soft_bytes(const struct soft_codec *codec, unsigned int samples)
+{
+	return (samples * codec->bits_per_sample + 7) / 8;
+}
+
+static void soft_free_list(struct list_head *list)
+{
+	struct soft_frame *frame, *temp;
+	list_for_each_entry_safe(frame, temp, list, node) {
+		list_del(&frame->node);
+		kfree(frame);
+	}
+}
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 20)
+static void soft_work_fn(void *data)
+{
+	struct soft_chan *sc = data;
+#else
+static void soft_work_fn(struct work_struct *work)
+{
+	struct soft_chan *sc = container_of(work, struct soft_chan, work);
+#endif
+	struct soft_frame *frame;
+	unsigned long flags;
+	unsigned int samples;
+
+	mutex_lock(&sc->codec_lock);
+	while (1) {
+		spin_lock_irqsave(&sc->lock, flags);
+		if (list_empty(&sc->in_queue)) {
+			spin_unlock_irqrestore(&sc->lock, flags);
+			break;
+		}
+		frame = list_entry(sc->in_queue.next, struct soft_frame, node);
+		list_del(&frame->node);
+		spin_unlock_irqrestore(&sc->lock, flags);
+
+		/* The frame was allocated large enough for either format. */
+		samples = frame->len * 8 / sc->src->bits_per_sample;
+		sc->src->decode(&sc->dec, frame->data, samples, sc->linear);
+		sc->dst->encode(&sc->enc, sc->linear, samples, frame->data);
+		frame->len = soft_bytes(sc->dst, samples);
+
+		spin_lock_irqsave(&sc->lock, flags);
+		list_add_tail(&frame->node, &sc->out_queue);
+		dahdi_tc_set_data_waiting(sc->dtc);
+		spin_unlock_irqrestore(&sc->lock, flags);
+		dahdi_transcoder_alert(sc->dtc);
+	}
+	mutex_unlock(&sc->codec_lock);
+}
+
+static ssize_t soft_write(struct file *file, const char __user *buf,
+			  size_t count, loff_t *ppos)
+{
+	struct dahdi_transcoder_channel *dtc = file->private_data;
+	struct soft_chan *sc = dtc->pvt;
+	struct soft_frame *frame;
+	unsigned long flags;
+	unsigned int samples;
+
+	if (!dahdi_tc_is_built(dtc))
+		return -EAGAIN;
+
+	samples = count * 8 / sc->src->bits_per_sample;
+	if (!samples || samples > SOFT_MAX_SAMPLES)
+		return -EINVAL;
+
+	frame = kmalloc(sizeof(*frame) + max(count,
+			soft_bytes(sc->dst, samples)), GFP_KERNEL);
+	if (!frame)
+		return -ENOMEM;
+
+	if (copy_from_user(frame->data, buf, count)) {
+		kfree(frame);
+		return -EFAULT;
+	}
+	frame->len = count;
+
+	spin_lock_irqsave(&sc->lock, flags);
+	if (sc->queued >= SOFT_MAX_QUEUED) {
+		spin_unlock_irqrestore(&sc->lock, flags);
+		kfree(frame);
+		return -EAGAIN;
+	}
+	++sc->queued;
+	list_add_tail(&frame->node, &sc->in_queue);
+	spin_unlock_irqrestore(&sc->lock, flags);
+
+	queue_work(soft_wq, &sc->work);
+	return count;
+}
+
+static struct soft_frame *soft_get_ready(struct soft_chan *sc)
+{
+	struct soft_frame *frame = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&sc->lock, flags);
+	if (!list_empty(&sc->out_queue)) {
+		frame = list_entry(sc->out_queue.next, struct soft_frame, node);
+		list_del(&frame->node);
+		--sc->queued;
+	}
+	if (list_empty(&sc->out_queue))
+		dahdi_tc_clear_data_waiting(sc->dtc);
+	spin_unlock_irqrestore(&sc->lock, flags);
+	return frame;
+}
+
+static ssize_t soft_read(struct file *file, char __user *buf, size_t count,
+			 loff_t *ppos)
+{
+	struct dahdi_transcoder_channel *dtc = file->private_data;
+	struct soft_chan *sc = dtc->pvt;
+	struct soft_frame *frame;
+	unsigned long flags;
+	ssize_t ret;
+
+	frame = soft_get_ready(sc);
+	if (!frame) {
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		ret = wait_event_interruptible(dtc->ready,
+				dahdi_tc_is_data_waiting(dtc));
+		if (-ERESTARTSYS == ret)
+			return -EINTR;
+		frame = soft_get_ready(sc);
+		if (!frame)
+			return -EAGAIN;
+	}
+
+	if (count < frame->len) {
+		/* Leave it for a read with a large enough buffer. */
+		spin_lock_irqsave(&sc->lock, flags);
+		list_add(&frame->node, &sc->out_queue);
+		++sc->queued;
+		dahdi_tc_set_data_waiting(dtc);
+		spin_unlock_irqrestore(&sc->lock, flags);
+		return -EFBIG;
+	}
+
+	ret = frame->len;
+	if (copy_to_user(buf, frame->data, frame->len))
+		ret = -EFAULT;
+	kfree(frame);
+	return ret;
+}
+
+static int soft_operation_allocate(struct dahdi_transcoder_channel *dtc)
+{
+	struct soft_chan *sc = dtc->pvt;
+
+	sc->src = soft_find_codec(dtc->srcfmt);
+	sc->dst = soft_find_codec(dtc->dstfmt);
+	if (!sc->src || !sc->dst || sc->src == sc->dst)
+		return -EINVAL;
+
+	if (sc->src->init)
+		sc->src->init(&sc->dec);
+	if (sc->dst->init)
+		sc->dst->init(&sc->enc);
+
+	if (debug) {
+		printk(KERN_DEBUG "%s: channel %d: %s -> %s\n",
+		       THIS_MODULE->name, (int)(dtc - soft_tc->channels),
+		       sc->src->name, sc->dst->name);
+	}
+
+	dtc->built_fmts = dtc->srcfmt | dtc->dstfmt;
+	dahdi_tc_set_built(dtc);
+	return 0;
+}
+
+static int soft_operation_release(struct dahdi_transcoder_channel *dtc)
+{
+	struct soft_chan *sc = dtc->pvt;
+	unsigned long flags;
+	LIST_HEAD(local_list);
+
+	dahdi_tc_clear_built(dtc);
+	flush_workqueue(soft_wq);
+
+	spin_lock_irqsave(&sc->lock, flags);
+	list_splice_init(&sc->in_queue, &local_list);
+	list_splice_init(&sc->out_queue, &local_list);
+	sc->queued = 0;
+	dahdi_tc_clear_data_waiting(dtc);
+	spin_unlock_irqrestore(&sc->lock, flags);
+
+	soft_free_list(&local_list);
+	return 0;
+}
+
+static int __init soft_transcode_init(void)
+{
+	const u32 formats = soft_all_formats();
+	int i;
+	int res;
+
+	if (numchannels <= 0)
+		return -EINVAL;
+
+	soft_wq = create_workqueue("dahdi_tc_soft");
+	if (!soft_wq)
+		return -ENOMEM;
+
+	soft_chans = kcalloc(numchannels, sizeof(*soft_chans), GFP_KERNEL);
+	if (!soft_chans) {
+		res = -ENOMEM;
+		goto error_exit;
+	}
+
+	soft_tc = dahdi_transcoder_alloc(numchannels);
+	if (!soft_tc) {
+		res = -ENOMEM;
+		goto error_exit;
+	}
+
+	strlcpy(soft_tc->name, "DAHDI Software Transcoder",
+		sizeof(soft_tc->name));
+	soft_tc->srcfmts = formats;
+	soft_tc->dstfmts = formats;
+	soft_tc->allocate = soft_operation_allocate;
+	soft_tc->release = soft_operation_release;
+	soft_tc->fops.owner = THIS_MODULE;
+	soft_tc->fops.read = soft_read;
+	soft_tc->fops.write = soft_write;
+
+	for (i = 0; i < numchannels; ++i) {
+		struct soft_chan *sc = &soft_chans[i];
+
+		sc->dtc = &soft_tc->channels[i];
+		spin_lock_init(&sc->lock);
+		mutex_init(&sc->codec_lock);
+		INIT_LIST_HEAD(&sc->in_queue);
+		INIT_LIST_HEAD(&sc->out_queue);
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 20)
+		INIT_WORK(&sc->work, soft_work_fn, sc);
+#else
+		INIT_WORK(&sc->work, soft_work_fn);
+#endif
+		soft_tc->channels[i].pvt = sc;
+	}
+
+	res = dahdi_transcoder_register(soft_tc);
+	if (res)
+		goto error_exit;
+
+	return 0;
+
+error_exit:
+	if (soft_tc)
+		dahdi_transcoder_free(soft_tc);
+	kfree(soft_chans);
+	destroy_workqueue(soft_wq);
+	return res;
+}
+
+static void __exit soft_transcode_cleanup(void)
+{
+	int i;
+
+	dahdi_transcoder_unregister(soft_tc);
+	flush_workqueue(soft_wq);
+	destroy_workqueue(soft_wq);
+
+	for (i = 0; i < numchannels; ++i) {
+		soft_free_list(&soft_chans[i].in_queue);
+		soft_free_list(&soft_chans[i].out_queue);
+	}
+	dahdi_transcoder_free(soft_tc);
+	kfree(soft_chans);
+}
+
+module_param(debug, int, S_IRUGO | S_IWUSR);
+module_param(numchannels, int, S_IRUGO);
+MODULE_PARM_DESC(numchannels, "Number of software transcoder channels.");
+MODULE_DESCRIPTION("DAHDI Software Transcoder");
+MODULE_AUTHOR("DAHDI Linux contributors");
+MODULE_LICENSE("GPL v2");
+
+module_init(soft_transcode_init);
+module_exit(soft_transcode_cleanup);
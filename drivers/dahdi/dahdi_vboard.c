@@ -0,0 +1,591 @@
+/*
+ * Virtual TDM board for DAHDI
+ *
+ * Registers one or more T1, E1 or FXS-like spans that are driven from an
+ * hrtimer the same way a DMA board is driven from its interrupt: every
+ * millisecond a receive frame is taken off a descriptor ring, de-interleaved
+ * into the channels, handed to the core, and the core's transmit data is
+ * interleaved back into the ring.  This exercises _dahdi_receive(),
+ * _dahdi_transmit(), echo cancellation and conferencing without hardware.
+ *
+ * The receive side can carry silence, a digital milliwatt, or the transmit
+ * data looped back after 'latency' milliseconds.  Robbed bit signalling,
+ * hook state and red alarms can be toggled periodically.  The cost of each
+ * tick is exported in the tick_cost attribute of the dahdi device.
+ *
+ * This is a load-testing tool and is not built by default; uncomment its
+ * line in drivers/dahdi/Kbuild to build it.
+ *
+ * Copyright (C) 2026, DAHDI Linux contributors
+ *
+ * All rights reserved.
+ *
+ */
+
+/*
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
+#include <linux/device.h>
+#include <asm/div64.h>
+
+#include <dahdi/kernel.h>
+
+#ifndef HAVE_HRTIMER_ACCESSORS
+#if (LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 28))
+static inline ktime_t hrtimer_get_expires(const struct hrtimer *timer)
+{
+	return timer->expires;
+}
+#endif
+#endif
+
+#define VB_MAX_SPANS		8
+#define VB_TIMESLOTS		32	/* Timeslots per span in a frame */
+#define VB_RING_SIZE		32	/* Descriptors, one per millisecond */
+#define VB_TICK_NS		(1000000 / (8000 / DAHDI_CHUNKSIZE) * 1000)
+
+enum vb_pattern {
+	VB_PATTERN_SILENCE = 0,
+	VB_PATTERN_MILLIWATT = 1,
+	VB_PATTERN_LOOPBACK = 2,
+};
+
+static int debug;
+static int numspans = 1;
+static char *spantype = "t1";
+static int pattern = VB_PATTERN_SILENCE;
+static int latency = 2;
+static int alarm_period;
+static int sig_period;
+static int span_chunks = 1;
+
+/* A descriptor owns one chunk of frames in each direction.  Frames are laid
+ * out like the wcxb boards: DAHDI_CHUNKSIZE frames of numspans *
+ * VB_TIMESLOTS bytes each, with the spans interleaved within a timeslot. */
+struct vb_desc {
+	u8 *rx;
+	u8 *tx;
+};
+
+struct vb_span {
+	struct dahdi_span span;
+	struct dahdi_chan *chans[VB_TIMESLOTS];
+	/* Last bits passed to rbsbits / hooksig, looped back in loopback
+	 * mode. */
+	int txsig[VB_TIMESLOTS];
+	int looped_sig[VB_TIMESLOTS];
+	int sig_state;
+};
+
+struct vboard {
+	struct dahdi_device *ddev;
+	struct hrtimer timer;
+	enum spantypes type;
+	unsigned int frame_stride;
+	unsigned long ticks;
+	struct vb_desc ring[VB_RING_SIZE];
+	u8 *buffers;
+
+	/* Tick cost, in nanoseconds. Protected by disabling interrupts.
+	 * Kept apart from 'ticks', which also paces the ring and the
+	 * signalling, so that they can be reset on their own. */
+	unsigned long cost_ticks;
+	u64 cost_total;
+	u32 cost_last;
+	u32 cost_max;
+	unsigned long missed;
+
+	struct vb_span *vspans[VB_MAX_SPANS];
+};
+
+static struct vboard *board;
+
+static const u8 milliwatt_ulaw[8] = {
+	0x1e, 0x0b, 0x0b, 0x1e, 0x9e, 0x8b, 0x8b, 0x9e
+};
+static const u8 milliwatt_alaw[8] = {
+	0x34, 0x21, 0x21, 0x34, 0xb4, 0xa1, 0xa1, 0xb4
+};
+
+static inline struct vb_span *vb_span_from_span(struct dahdi_span *span)
+{
+	return container_of(span, struct vb_span, span);
+}
+
+static void vb_fill_pattern(struct vboard *vb, u8 *rx)
+{
+	int s, i, j;
+
+	for (s = 0; s < numspans; ++s) {
+		const struct dahdi_span *span = &vb->vspans[s]->span;
+		const bool alaw = (DAHDI_LAW_ALAW == span->deflaw);
+		for (j = 0; j < DAHDI_CHUNKSIZE; ++j) {
+			u8 sample;
+			u8 *frame = &rx[j * vb->frame_stride + s];
+
+			if (VB_PATTERN_MILLIWATT == pattern) {
+				sample = (alaw) ? milliwatt_alaw[j & 7] :
+						  milliwatt_ulaw[j & 7];
+			} else {
+				sample = (alaw) ? 0xd5 : 0xff;
+			}
+			for (i = 0; i < VB_TIMESLOTS; ++i)
+				frame[i * numspans] = sample;
+		}
+	}
+}
+
+/* Change the received signalling as if the far end had done it. */
+static void vb_toggle_signalling(struct vb_span *vs)
+{
+	int i;
+
+	vs->sig_state = !vs->sig_state;
+	for (i = 0; i < vs->span.channels; ++i) {
+		struct dahdi_chan *const chan = vs->chans[i];
+
+		if (!chan->sig || (chan->sig & DAHDI_SIG_CLEAR))
+			continue;
+		if (SPANTYPE_ANALOG_FXS == vs->span.spantype) {
+			dahdi_hooksig(chan, (vs->sig_state) ?
+				      DAHDI_RXSIG_OFFHOOK : DAHDI_RXSIG_ONHOOK);
+		} else {
+			dahdi_rbsbits(chan, (vs->sig_state) ?
+				      (DAHDI_ABIT | DAHDI_BBIT) : 0);
+		}
+	}
+}
+
+static void vb_loop_signalling(struct vb_span *vs)
+{
+	int i;
+
+	for (i = 0; i < vs->span.channels; ++i) {
+		if (vs->looped_sig[i] == vs->txsig[i])
+			continue;
+		vs->looped_sig[i] = vs->txsig[i];
+		if (SPANTYPE_ANALOG_FXS != vs->span.spantype)
+			dahdi_rbsbits(vs->chans[i], vs->looped_sig[i]);
+	}
+}
+
+static void vb_toggle_alarm(struct vb_span *vs)
+{
+	vs->span.alarms ^= DAHDI_ALARM_RED;
+	dahdi_alarm_notify(&vs->span);
+}
+
+/* What the hardware would do: fill the receive half of the descriptor. */
+static void vb_hw_receive(struct vboard *vb, struct vb_desc *d)
+{
+	const size_t len = DAHDI_CHUNKSIZE * vb->frame_stride;
+
+	/* The transmit half of this descriptor was filled 'latency' ticks ago
+	 * since the ring is walked modulo latency. */
+	if (VB_PATTERN_LOOPBACK == pattern)
+		memcpy(d->rx, d->tx, len);
+	else
+		vb_fill_pattern(vb, d->rx);
+}
+
+static void vb_handle_tick(struct vboard *vb)
+{
+	struct vb_desc *const d = &vb->ring[vb->ticks % latency];
+	const unsigned long ms = vb->ticks;
+	int s;
+
+	vb_hw_receive(vb, d);
+
+	for (s = 0; s < numspans; ++s) {
+		struct vb_span *const vs = vb->vspans[s];
+		struct dahdi_span *const span = &vs->span;
+
+		if (!test_bit(DAHDI_FLAGBIT_REGISTERED, &span->flags))
+			continue;
+
+		if (alarm_period && !(ms % alarm_period))
+			vb_toggle_alarm(vs);
+		if (sig_period && !(ms % sig_period))
+			vb_toggle_signalling(vs);
+		else if (VB_PATTERN_LOOPBACK == pattern)
+			vb_loop_signalling(vs);
+
+		dahdi_tdm_deinterleave_span(span, &d->rx[s], numspans,
+					    vb->frame_stride);
+		_dahdi_ec_span(span);
+		_dahdi_receive(span);
+
+		_dahdi_transmit(span);
+		dahdi_tdm_interleave_span(&d->tx[s], span, numspans,
+					  vb->frame_stride);
+	}
+	++vb->ticks;
+}
+
+static enum hrtimer_restart vb_timer_fn(struct hrtimer *timer)
+{
+	struct vboard *const vb = container_of(timer, struct vboard, timer);
+	unsigned long flags;
+	unsigned long overrun;
+	ktime_t start;
+	u32 cost;
+
+	local_irq_save(flags);
+	start = ktime_get();
+	vb_handle_tick(vb);
+	cost = (u32)ktime_to_ns(ktime_sub(ktime_get(), start));
+	vb->cost_last = cost;
+	++vb->cost_ticks;
+	vb->cost_total += cost;
+	if (cost > vb->cost_max)
+		vb->cost_max = cost;
+	local_irq_restore(flags);
+
+	overrun = hrtimer_forward(timer, hrtimer_get_expires(timer),
+				  ktime_set(0, VB_TICK_NS));
+	if (overrun > 1) {
+		vb->missed += overrun - 1;
+		if ((debug) && printk_ratelimit()) {
+			printk(KERN_NOTICE "%s: missed %lu ticks\n",
+			       THIS_MODULE->name, overrun - 1);
+		}
+	}
+	return HRTIMER_RESTART;
+}
+
+static ssize_t
+tick_cost_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct vboard *const vb = board;
+	unsigned long flags;
+	unsigned long ticks, missed;
+	u64 total;
+	u32 last, max;
+
+	local_irq_save(flags);
+	ticks = vb->cost_ticks;
+	missed = vb->missed;
+	total = vb->cost_total;
+	last = vb->cost_last;
+	max = vb->cost_max;
+	local_irq_restore(flags);
+
+	if (ticks)
+		do_div(total, ticks);
+
+	return sprintf(buf, "ticks: %lu\nmissed: %lu\nlast_ns: %u\n"
+		       "max_ns: %u\navg_ns: %llu\n", ticks, missed, last, max,
+		       (unsigned long long)total);
+}
+
+/* Writing anything resets the counters. */
+static ssize_t
+tick_cost_store(struct device *dev, struct device_attribute *attr,
+		const char *buf, size_t count)
+{
+	struct vboard *const vb = board;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	vb->cost_total = 0;
+	vb->cost_max = 0;
+	vb->missed = 0;
+	vb->cost_ticks = 0;
+	local_irq_restore(flags);
+	return count;
+}
+
+static DEVICE_ATTR(tick_cost, 0644, tick_cost_show, tick_cost_store);
+
+static int vb_spanconfig(struct file *file, struct dahdi_span *span,
+			 struct dahdi_lineconfig *lc)
+{
+	span->lineconfig = lc->lineconfig;
+	return 0;
+}
+
+static int vb_chanconfig(struct file *file, struct dahdi_chan *chan,
+			 int sigtype)
+{
+	return 0;
+}
+
+static int vb_rbsbits(struct dahdi_chan *chan, int bits)
+{
+	struct vb_span *vs = vb_span_from_span(chan->span);
+	vs->txsig[chan->chanpos - 1] = bits;
+	return 0;
+}
+
+static int vb_hooksig(struct dahdi_chan *chan, enum dahdi_txsig txsig)
+{
+	struct vb_span *vs = vb_span_from_span(chan->span);
+	vs->txsig[chan->chanpos - 1] = txsig;
+	return 0;
+}
+
+static const struct dahdi_span_ops vb_digital_ops = {
+	.owner = THIS_MODULE,
+	.spanconfig = vb_spanconfig,
+	.chanconfig = vb_chanconfig,
+	.rbsbits = vb_rbsbits,
+};
+
+static const struct dahdi_span_ops vb_analog_ops = {
+	.owner = THIS_MODULE,
+	.chanconfig = vb_chanconfig,
+	.hooksig = vb_hooksig,
+};
+
+static void vb_free_span(struct vb_span *vs)
+{
+	int i;
+
+	if (!vs)
+		return;
+	dahdi_span_free_chunks(&vs->span);
+	for (i = 0; i < VB_TIMESLOTS; ++i)
+		kfree(vs->chans[i]);
+	kfree(vs);
+}
+
+static struct vb_span *vb_alloc_span(enum spantypes type, int spanno)
+{
+	struct vb_span *vs;
+	int channels;
+	int i;
+
+	vs = kzalloc(sizeof(*vs), GFP_KERNEL);
+	if (!vs)
+		return NULL;
+
+	switch (type) {
+	case SPANTYPE_DIGITAL_E1:
+		channels = 31;
+		vs->span.deflaw = DAHDI_LAW_ALAW;
+		vs->span.linecompat = DAHDI_CONFIG_AMI | DAHDI_CONFIG_HDB3 |
+				      DAHDI_CONFIG_CCS | DAHDI_CONFIG_CRC4;
+		break;
+	case SPANTYPE_ANALOG_FXS:
+		channels = 24;
+		vs->span.deflaw = DAHDI_LAW_MULAW;
+		break;
+	default:
+		channels = 24;
+		vs->span.deflaw = DAHDI_LAW_MULAW;
+		vs->span.linecompat = DAHDI_CONFIG_AMI | DAHDI_CONFIG_B8ZS |
+				      DAHDI_CONFIG_D4 | DAHDI_CONFIG_ESF;
+		break;
+	}
+
+	vs->span.spantype = type;
+	vs->span.channels = channels;
+	vs->span.chans = vs->chans;
+	snprintf(vs->span.name, sizeof(vs->span.name), "VBOARD/%d",
+		 spanno + 1);
+	snprintf(vs->span.desc, sizeof(vs->span.desc),
+		 "DAHDI Virtual Board Span %d (%s)", spanno + 1,
+		 dahdi_spantype2str(type));
+	if (SPANTYPE_ANALOG_FXS == type) {
+		vs->span.ops = &vb_analog_ops;
+	} else {
+		vs->span.flags |= DAHDI_FLAG_RBS;
+		vs->span.ops = &vb_digital_ops;
+	}
+
+	for (i = 0; i < channels; ++i) {
+		struct dahdi_chan *chan;
+
+		chan = kzalloc(sizeof(*chan), GFP_KERNEL);
+		if (!chan) {
+			vb_free_span(vs);
+			return NULL;
+		}
+		vs->chans[i] = chan;
+		snprintf(chan->name, sizeof(chan->name), "VBOARD/%d/%d",
+			 spanno + 1, i + 1);
+		chan->chanpos = i + 1;
+		chan->pvt = vs;
+		if (SPANTYPE_ANALOG_FXS == type) {
+			chan->sigcap = DAHDI_SIG_FXOKS | DAHDI_SIG_FXOLS |
+				       DAHDI_SIG_FXOGS | DAHDI_SIG_CLEAR;
+		} else {
+			chan->sigcap = DAHDI_SIG_EM | DAHDI_SIG_CLEAR |
+				       DAHDI_SIG_FXSLS | DAHDI_SIG_FXSGS |
+				       DAHDI_SIG_FXSKS | DAHDI_SIG_FXOLS |
+				       DAHDI_SIG_FXOGS | DAHDI_SIG_FXOKS |
+				       DAHDI_SIG_CAS | DAHDI_SIG_DACS_RBS |
+				       DAHDI_SIG_SF;
+			if (SPANTYPE_DIGITAL_E1 == type)
+				chan->sigcap |= DAHDI_SIG_MTP2;
+			chan->sigcap |= DAHDI_SIG_HDLCRAW | DAHDI_SIG_HDLCFCS |
+					DAHDI_SIG_HDLCNET | DAHDI_SIG_HARDHDLC;
+		}
+	}
+	if (span_chunks && dahdi_span_alloc_chunks(&vs->span)) {
+		vb_free_span(vs);
+		return NULL;
+	}
+	return vs;
+}
+
+static void vb_free(struct vboard *vb)
+{
+	int s;
+
+	for (s = 0; s < VB_MAX_SPANS; ++s)
+		vb_free_span(vb->vspans[s]);
+	kfree(vb->buffers);
+	if (vb->ddev)
+		dahdi_free_device(vb->ddev);
+	kfree(vb);
+}
+
+static int __init vb_init(void)
+{
+	struct vboard *vb;
+	size_t chunk_bytes;
+	int s, i;
+	int res;
+
+	if (numspans < 1 || numspans > VB_MAX_SPANS) {
+		printk(KERN_ERR "%s: numspans must be between 1 and %d.\n",
+		       THIS_MODULE->name, VB_MAX_SPANS);
+		return -EINVAL;
+	}
+	if (latency < 1 || latency > VB_RING_SIZE) {
+		printk(KERN_ERR "%s: latency must be between 1 and %d.\n",
+		       THIS_MODULE->name, VB_RING_SIZE);
+		return -EINVAL;
+	}
+
+	vb = kzalloc(sizeof(*vb), GFP_KERNEL);
+	if (!vb)
+		return -ENOMEM;
+
+	if (!strcasecmp(spantype, "e1")) {
+		vb->type = SPANTYPE_DIGITAL_E1;
+	} else if (!strcasecmp(spantype, "t1")) {
+		vb->type = SPANTYPE_DIGITAL_T1;
+	} else if (!strcasecmp(spantype, "fxs")) {
+		vb->type = SPANTYPE_ANALOG_FXS;
+	} else {
+		printk(KERN_ERR "%s: '%s' is not a valid spantype.\n",
+		       THIS_MODULE->name, spantype);
+		res = -EINVAL;
+		goto error_exit;
+	}
+
+	vb->frame_stride = numspans * VB_TIMESLOTS;
+	chunk_bytes = DAHDI_CHUNKSIZE * vb->frame_stride;
+	vb->buffers = kzalloc(2 * chunk_bytes * VB_RING_SIZE, GFP_KERNEL);
+	if (!vb->buffers) {
+		res = -ENOMEM;
+		goto error_exit;
+	}
+	for (i = 0; i < VB_RING_SIZE; ++i) {
+		vb->ring[i].rx = vb->buffers + (2 * i) * chunk_bytes;
+		vb->ring[i].tx = vb->buffers + (2 * i + 1) * chunk_bytes;
+	}
+
+	vb->ddev = dahdi_create_device();
+	if (!vb->ddev) {
+		res = -ENOMEM;
+		goto error_exit;
+	}
+	dev_set_name(&vb->ddev->dev, "dahdi_vboard");
+	vb->ddev->manufacturer = "DAHDI";
+	vb->ddev->devicetype = "DAHDI Virtual Board";
+	vb->ddev->location = "virtual";
+
+	for (s = 0; s < numspans; ++s) {
+		vb->vspans[s] = vb_alloc_span(vb->type, s);
+		if (!vb->vspans[s]) {
+			res = -ENOMEM;
+			goto error_exit;
+		}
+		list_add_tail(&vb->vspans[s]->span.device_node,
+			      &vb->ddev->spans);
+	}
+
+	res = dahdi_register_device(vb->ddev, NULL);
+	if (res)
+		goto error_exit;
+
+	board = vb;
+	res = device_create_file(&vb->ddev->dev, &dev_attr_tick_cost);
+	if (res) {
+		board = NULL;
+		dahdi_unregister_device(vb->ddev);
+		goto error_exit;
+	}
+
+	hrtimer_init(&vb->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	vb->timer.function = vb_timer_fn;
+	hrtimer_start(&vb->timer, ktime_set(0, VB_TICK_NS), HRTIMER_MODE_REL);
+
+	printk(KERN_INFO "%s: %d %s span(s), pattern %d, latency %dms.\n",
+	       THIS_MODULE->name, numspans, dahdi_spantype2str(vb->type),
+	       pattern, latency);
+	return 0;
+
+error_exit:
+	vb_free(vb);
+	return res;
+}
+
+static void __exit vb_cleanup(void)
+{
+	struct vboard *const vb = board;
+
+	hrtimer_cancel(&vb->timer);
+	device_remove_file(&vb->ddev->dev, &dev_attr_tick_cost);
+	dahdi_unregister_device(vb->ddev);
+	vb_free(vb);
+}
+
+module_param(debug, int, S_IRUGO | S_IWUSR);
+module_param(numspans, int, S_IRUGO);
+MODULE_PARM_DESC(numspans, "Number of spans to create (1-8).");
+module_param(spantype, charp, S_IRUGO);
+MODULE_PARM_DESC(spantype, "Type of the spans: t1, e1 or fxs.");
+module_param(pattern, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(pattern, "Receive data: 0 = silence, 1 = digital " \
+		 "milliwatt, 2 = loop back the transmit data.");
+module_param(latency, int, S_IRUGO);
+MODULE_PARM_DESC(latency, "Milliseconds between transmit and receive " \
+		 "when looping back (1-32).");
+module_param(alarm_period, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(alarm_period, "Toggle red alarm every this many ms " \
+		 "(0 = never).");
+module_param(sig_period, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(sig_period, "Toggle the received signalling every this " \
+		 "many ms (0 = never).");
+module_param(span_chunks, int, S_IRUGO);
+MODULE_PARM_DESC(span_chunks, "Keep each span's chunks in one contiguous " \
+		 "array (0 = per channel, for comparison).");
+
+MODULE_DESCRIPTION("DAHDI Virtual TDM Board");
+MODULE_AUTHOR("DAHDI Linux contributors");
+MODULE_LICENSE("GPL v2");
+
+module_init(vb_init);
+module_exit(vb_cleanup);
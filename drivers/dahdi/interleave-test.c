@@ -0,0 +1,269 @@
+/*
+ * Check and time the TDM interleave helpers in dahdi/interleave.h
+ *
+ * Copyright (C) 2026, DAHDI Linux contributors
+ *
+ * All rights reserved.
+ *
+ */
+
+/*
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ */
+
+/*
+  NOTE: This is a userspace program, it is not part of any module.
+  It runs the shared helpers against copies of the per-driver loops they
+  replaced, over random frames, for each frame layout the drivers use, and
+  times both. From this directory:
+
+    cc -O2 -I../../include -o interleave-test interleave-test.c
+    ./interleave-test [iterations]
+
+  Build again with -DDAHDI_CHUNKSIZE=16 (or any other size) to check the
+  generic loop instead of the unrolled one. The exit status is non-zero if
+  any layout produced different bytes.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef unsigned char u8;
+typedef unsigned char u_char;
+
+#ifndef DAHDI_CHUNKSIZE
+#define DAHDI_CHUNKSIZE 8
+#endif
+
+/* Just the members the helpers touch. */
+struct dahdi_chan {
+	u_char *writechunk;
+	u_char *readchunk;
+	u_char swritechunk[DAHDI_CHUNKSIZE];
+	u_char sreadchunk[DAHDI_CHUNKSIZE];
+};
+
+struct dahdi_span {
+	int channels;
+	struct dahdi_chan **chans;
+	u_char *rxchunks;
+	u_char *txchunks;
+};
+
+#include <dahdi/interleave.h>
+
+#define MAX_CHANS	32
+#define FRAME_BYTES	(256 * DAHDI_CHUNKSIZE * 2)
+
+struct layout {
+	const char *name;
+	int nchans;
+	unsigned int offset;		/* first channel's byte in a frame */
+	unsigned int chan_stride;
+	unsigned int frame_stride;
+};
+
+/*
+ * wcaxx, wcte13xp and wcte43x: 128 byte DMA frames, one channel every
+ * fourth byte after the first. wctdm24xxp: EFRAME_SIZE + EFRAME_GAP byte
+ * frames with the channels packed together.
+ */
+static const struct layout layouts[] = {
+	{ "wcaxx",		 8, 1, 4, 128 },
+	{ "wcte13xp (T1)",	24, 1, 4, 128 },
+	{ "wcte13xp (E1)",	31, 1, 4, 128 },
+	{ "wcte43x span 3",	31, 3, 4, 128 },
+	{ "wctdm24xxp",		24, 0, 1, 108 + 20 },
+};
+
+static struct dahdi_chan chans[MAX_CHANS];
+static struct dahdi_chan *chanp[MAX_CHANS];
+static struct dahdi_chan ref[MAX_CHANS];
+static u8 frame[FRAME_BYTES];
+static u8 new_frame[FRAME_BYTES];
+static u8 old_frame[FRAME_BYTES];
+static u8 spanchunks[MAX_CHANS * DAHDI_CHUNKSIZE];
+
+/* The loops the drivers used before the helpers. */
+static void old_deinterleave(const struct layout *l)
+{
+	int i, j;
+	for (j = 0; j < DAHDI_CHUNKSIZE; j++) {
+		for (i = 0; i < l->nchans; i++) {
+			ref[i].readchunk[j] =
+				frame[j*l->frame_stride + (l->offset +
+							   i*l->chan_stride)];
+		}
+	}
+}
+
+static void old_interleave(const struct layout *l)
+{
+	int i, j;
+	for (j = 0; j < DAHDI_CHUNKSIZE; j++) {
+		for (i = 0; i < l->nchans; i++) {
+			old_frame[j*l->frame_stride + (l->offset +
+						       i*l->chan_stride)] =
+				chans[i].writechunk[j];
+		}
+	}
+}
+
+static void fill_random(u8 *buf, size_t len)
+{
+	while (len--)
+		*buf++ = rand();
+}
+
+static int check_layout(const struct layout *l)
+{
+	struct dahdi_span span;
+	int i;
+	int res = 0;
+
+	memset(&span, 0, sizeof(span));
+	span.channels = l->nchans;
+	span.chans = chanp;
+
+	fill_random(frame, sizeof(frame));
+	for (i = 0; i < l->nchans; i++)
+		fill_random(chans[i].swritechunk, DAHDI_CHUNKSIZE);
+
+	old_deinterleave(l);
+	dahdi_tdm_deinterleave(chanp, l->nchans, &frame[l->offset],
+			       l->chan_stride, l->frame_stride);
+	for (i = 0; i < l->nchans; i++) {
+		if (memcmp(chans[i].readchunk, ref[i].readchunk,
+			   DAHDI_CHUNKSIZE)) {
+			printf("%s: dahdi_tdm_deinterleave differs on "
+			       "channel %d\n", l->name, i);
+			res = -1;
+		}
+	}
+
+	span.rxchunks = spanchunks;
+	dahdi_tdm_deinterleave_span(&span, &frame[l->offset],
+				    l->chan_stride, l->frame_stride);
+	for (i = 0; i < l->nchans; i++) {
+		if (memcmp(&spanchunks[i * DAHDI_CHUNKSIZE], ref[i].readchunk,
+			   DAHDI_CHUNKSIZE)) {
+			printf("%s: dahdi_tdm_deinterleave_span differs on "
+			       "channel %d\n", l->name, i);
+			res = -1;
+		}
+	}
+
+	memcpy(old_frame, frame, sizeof(frame));
+	memcpy(new_frame, frame, sizeof(frame));
+	old_interleave(l);
+	dahdi_tdm_interleave(&new_frame[l->offset], chanp, l->nchans,
+			     l->chan_stride, l->frame_stride);
+	if (memcmp(old_frame, new_frame, sizeof(frame))) {
+		printf("%s: dahdi_tdm_interleave differs\n", l->name);
+		res = -1;
+	}
+
+	memcpy(new_frame, frame, sizeof(frame));
+	for (i = 0; i < l->nchans; i++) {
+		memcpy(&spanchunks[i * DAHDI_CHUNKSIZE], chans[i].writechunk,
+		       DAHDI_CHUNKSIZE);
+	}
+	span.txchunks = spanchunks;
+	dahdi_tdm_interleave_span(&new_frame[l->offset], &span,
+				  l->chan_stride, l->frame_stride);
+	if (memcmp(old_frame, new_frame, sizeof(frame))) {
+		printf("%s: dahdi_tdm_interleave_span differs\n", l->name);
+		res = -1;
+	}
+
+	return res;
+}
+
+static double elapsed_ns(const struct timespec *start,
+			 const struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1e9 +
+	       (end->tv_nsec - start->tv_nsec);
+}
+
+static void time_layout(const struct layout *l, unsigned long iterations)
+{
+	struct timespec start, end;
+	double old_ns, new_ns;
+	unsigned long n;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (n = 0; n < iterations; n++) {
+		old_deinterleave(l);
+		old_interleave(l);
+		__asm__ __volatile__("" : : : "memory");
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	old_ns = elapsed_ns(&start, &end) / iterations;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (n = 0; n < iterations; n++) {
+		dahdi_tdm_deinterleave(chanp, l->nchans, &frame[l->offset],
+				       l->chan_stride, l->frame_stride);
+		dahdi_tdm_interleave(&new_frame[l->offset], chanp, l->nchans,
+				     l->chan_stride, l->frame_stride);
+		__asm__ __volatile__("" : : : "memory");
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	new_ns = elapsed_ns(&start, &end) / iterations;
+
+	printf("%-16s %2d chans: old %7.1f ns  helpers %7.1f ns per chunk\n",
+	       l->name, l->nchans, old_ns, new_ns);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long iterations = 1000000;
+	unsigned int x;
+	int i;
+	int res = 0;
+
+	if (argc > 1)
+		iterations = strtoul(argv[1], NULL, 0);
+	if (!iterations)
+		iterations = 1;
+
+	for (i = 0; i < MAX_CHANS; i++) {
+		chans[i].readchunk = chans[i].sreadchunk;
+		chans[i].writechunk = chans[i].swritechunk;
+		ref[i].readchunk = ref[i].sreadchunk;
+		chanp[i] = &chans[i];
+	}
+
+	srand(1);
+	printf("DAHDI_CHUNKSIZE %d\n", DAHDI_CHUNKSIZE);
+	for (x = 0; x < sizeof(layouts) / sizeof(layouts[0]); x++) {
+		/* A few rounds so one lucky frame can't hide a mistake. */
+		for (i = 0; i < 16; i++) {
+			if (check_layout(&layouts[x])) {
+				res = 1;
+				break;
+			}
+		}
+	}
+	if (res) {
+		printf("FAILED\n");
+		return res;
+	}
+
+	for (x = 0; x < sizeof(layouts) / sizeof(layouts[0]); x++)
+		time_layout(&layouts[x], iterations);
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,669 @@
+/*
+ * Octasic OCT6100 register simulator
+ *
+ * Copyright (C) 2026, DAHDI Linux contributors
+ *
+ * All rights reserved.
+ *
+ */
+
+/*
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ */
+
+/*
+  NOTE: This is a userspace program, it is not part of the oct612x module.
+  It links the Octasic API and oct612x-user.c against an in-memory model
+  of the chip instead of a VPM450 module, so that the API calls the
+  drivers make can be run, timed and checked without hardware. Every bus
+  access is counted against the API call that made it. sim-include/ has
+  the few kernel definitions oct612x-user.c needs, so it is the same file
+  the module is built from, write combining and all.
+
+  From this directory:
+
+    cc -O2 -include stddef.h -Isim-include $(./octasic-helper cflags .) \
+       -o oct612x-sim oct612x-sim.c oct612x-user.c \
+       $(./octasic-helper objects . | sed 's/\.o/.c/g')
+
+    ./oct612x-sim [/lib/firmware/dahdi-fw-oct6114-128.bin [channels]]
+
+  It first checks the write combining of oct612x-user.c: random single
+  writes, smears, bursts and reads, in and out of batches and with some
+  made as if from interrupt context, must leave the model with the same
+  contents as a plain copy, and no read may reach the chip while writes
+  are held back. With a firmware image it then opens the chip and its
+  channels as init_vpm450m() does.
+
+  The model is only as smart as the API needs it to be: memory reads back
+  what was last written, and the handful of status registers the API polls
+  during chip open answer the way a healthy chip does. The exit status is
+  non-zero if any check or API call fails, so it can be used for
+  regression runs.
+ */
+
+#include <linux/kernel.h>
+#include <stdlib.h>
+
+#include "oct612x.h"
+
+/* A 32-bit, 16-bit word addressed space, allocated 4KB at a time. */
+#define SIM_PAGE_SHIFT	12
+#define SIM_PAGE_WORDS	((1 << SIM_PAGE_SHIFT) / sizeof(u16))
+#define SIM_DIR_SHIFT	20
+#define SIM_DIR_SIZE	(1 << (32 - SIM_DIR_SHIFT))
+#define SIM_SUB_SIZE	(1 << (SIM_DIR_SHIFT - SIM_PAGE_SHIFT))
+
+enum sim_reg_kind {
+	SIM_REG_CONST,		/* Always reads value */
+	SIM_REG_COUNTER,	/* Advances by value on every read */
+	SIM_REG_KEEP,		/* Leaves the caller's buffer as it was */
+};
+
+struct sim_reg {
+	u32 address;
+	enum sim_reg_kind kind;
+	u16 value;
+};
+
+/*
+ * Registers the API polls while opening the chip, and what a chip that
+ * booted the firmware without errors answers.
+ */
+static struct sim_reg sim_regs[] = {
+	/* Key decode done and the firmware key valid. */
+	{ 0x160, SIM_REG_CONST, 0x0004 },
+	/* Chip id 0x29 (OCT6114), revision 0. */
+	{ cOCT6100_CHIP_ID_REVISION_REG, SIM_REG_CONST, 0x0029 },
+	/* The memory clock counter. */
+	{ 0x30A, SIM_REG_COUNTER, 1000 },
+	/* The AF CPU booted and its BIST passed. */
+	{ cOCT6100_POUCH_BASE, SIM_REG_CONST, cOCT6100_AF_BOOT_TYPE },
+	{ cOCT6100_POUCH_BASE + 2, SIM_REG_CONST, 0x0000 },
+	/* The firmware updates its codepoint as asked. */
+	{ cOCT6100_PART1_API_SCRATCH_PAD + 0x12, SIM_REG_KEEP, 0 },
+};
+
+struct sim_counts {
+	unsigned long writes;
+	unsigned long reads;
+	unsigned long smears;
+	unsigned long smear_words;
+	unsigned long write_bursts;
+	unsigned long write_burst_words;
+	unsigned long read_bursts;
+	unsigned long read_burst_words;
+};
+
+struct oct612x_sim {
+	struct oct612x_context context;
+	u16 **dir[SIM_DIR_SIZE];
+	struct sim_counts counts;	/* Since sim_begin() */
+	struct sim_counts total;
+	unsigned long errors;
+};
+
+int oct612x_sim_in_interrupt;
+
+static u16 *sim_word(struct oct612x_sim *sim, u32 address)
+{
+	u16 **sub = sim->dir[address >> SIM_DIR_SHIFT];
+	u16 *page;
+	unsigned int i = (address >> SIM_PAGE_SHIFT) & (SIM_SUB_SIZE - 1);
+
+	if (!sub) {
+		sub = calloc(SIM_SUB_SIZE, sizeof(*sub));
+		if (!sub) {
+			perror("calloc");
+			exit(2);
+		}
+		sim->dir[address >> SIM_DIR_SHIFT] = sub;
+	}
+	page = sub[i];
+	if (!page) {
+		page = calloc(SIM_PAGE_WORDS, sizeof(*page));
+		if (!page) {
+			perror("calloc");
+			exit(2);
+		}
+		sub[i] = page;
+	}
+	return &page[(address & ((1 << SIM_PAGE_SHIFT) - 1)) >> 1];
+}
+
+static struct sim_reg *sim_find_reg(u32 address)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(sim_regs) / sizeof(sim_regs[0]); i++) {
+		if (sim_regs[i].address == address)
+			return &sim_regs[i];
+	}
+	return NULL;
+}
+
+static void sim_load(struct oct612x_sim *sim, u32 address, u16 *value)
+{
+	struct sim_reg *reg = sim_find_reg(address);
+
+	if (!reg) {
+		*value = *sim_word(sim, address);
+		return;
+	}
+	switch (reg->kind) {
+	case SIM_REG_CONST:
+		*value = reg->value;
+		break;
+	case SIM_REG_COUNTER:
+		*value = *sim_word(sim, address);
+		*sim_word(sim, address) += reg->value;
+		break;
+	case SIM_REG_KEEP:
+		break;
+	}
+}
+
+static struct oct612x_sim *to_sim(struct oct612x_context *context)
+{
+	return (struct oct612x_sim *)((char *)context -
+				      offsetof(struct oct612x_sim, context));
+}
+
+/* Writes held back by oct612x-user.c must reach the chip before a read. */
+static void sim_check_flushed(struct oct612x_sim *sim, const char *what)
+{
+	if (sim->context.pending) {
+		fprintf(stderr, "%s with %u writes still pending!\n", what,
+			sim->context.pending);
+		sim->errors++;
+	}
+}
+
+static int sim_write(struct oct612x_context *context, u32 address, u16 value)
+{
+	struct oct612x_sim *sim = to_sim(context);
+
+	sim->counts.writes++;
+	*sim_word(sim, address) = value;
+	return 0;
+}
+
+static int sim_read(struct oct612x_context *context, u32 address, u16 *value)
+{
+	struct oct612x_sim *sim = to_sim(context);
+
+	sim_check_flushed(sim, "read");
+	sim->counts.reads++;
+	sim_load(sim, address, value);
+	return 0;
+}
+
+static int sim_write_smear(struct oct612x_context *context, u32 address,
+			   u16 value, size_t count)
+{
+	struct oct612x_sim *sim = to_sim(context);
+	size_t i;
+
+	sim->counts.smears++;
+	sim->counts.smear_words += count;
+	for (i = 0; i < count; i++)
+		*sim_word(sim, address + (i << 1)) = value;
+	return 0;
+}
+
+static int sim_write_burst(struct oct612x_context *context, u32 address,
+			   const u16 *value, size_t count)
+{
+	struct oct612x_sim *sim = to_sim(context);
+	size_t i;
+
+	sim->counts.write_bursts++;
+	sim->counts.write_burst_words += count;
+	for (i = 0; i < count; i++)
+		*sim_word(sim, address + (i << 1)) = value[i];
+	return 0;
+}
+
+static int sim_read_burst(struct oct612x_context *context, u32 address,
+			  u16 *value, size_t count)
+{
+	struct oct612x_sim *sim = to_sim(context);
+	size_t i;
+
+	sim_check_flushed(sim, "read burst");
+	sim->counts.read_bursts++;
+	sim->counts.read_burst_words += count;
+	for (i = 0; i < count; i++)
+		sim_load(sim, address + (i << 1), &value[i]);
+	return 0;
+}
+
+static const struct oct612x_ops sim_ops = {
+	.write = sim_write,
+	.read = sim_read,
+	.write_smear = sim_write_smear,
+	.write_burst = sim_write_burst,
+	.read_burst = sim_read_burst,
+};
+
+static void sim_free(struct oct612x_sim *sim)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < SIM_DIR_SIZE; i++) {
+		if (!sim->dir[i])
+			continue;
+		for (j = 0; j < SIM_SUB_SIZE; j++)
+			free(sim->dir[i][j]);
+		free(sim->dir[i]);
+	}
+	free(sim);
+}
+
+/*
+ * Per API call accounting. sim_begin() clears the counters and sim_end()
+ * prints what the call cost and adds it to the totals.
+ */
+static struct timeval sim_start;
+
+static void sim_begin(struct oct612x_sim *sim)
+{
+	memset(&sim->counts, 0, sizeof(sim->counts));
+	gettimeofday(&sim_start, NULL);
+}
+
+static void sim_print(const char *name, unsigned long calls,
+		      const struct sim_counts *c, long usecs)
+{
+	unsigned long transactions = c->writes + c->reads + c->smears +
+				     c->write_bursts + c->read_bursts;
+
+	printf("%-28s %6lu %9lu %9lu %7lu/%-8lu %7lu/%-8lu %7lu/%-8lu %9lu %8ld\n",
+	       name, calls, c->writes, c->reads,
+	       c->smears, c->smear_words,
+	       c->write_bursts, c->write_burst_words,
+	       c->read_bursts, c->read_burst_words,
+	       transactions, usecs);
+}
+
+static void sim_add(struct sim_counts *to, const struct sim_counts *from)
+{
+	to->writes += from->writes;
+	to->reads += from->reads;
+	to->smears += from->smears;
+	to->smear_words += from->smear_words;
+	to->write_bursts += from->write_bursts;
+	to->write_burst_words += from->write_burst_words;
+	to->read_bursts += from->read_bursts;
+	to->read_burst_words += from->read_burst_words;
+}
+
+static int sim_end(struct oct612x_sim *sim, const char *name,
+		   unsigned long calls, UINT32 result)
+{
+	struct timeval now;
+	long usecs;
+
+	gettimeofday(&now, NULL);
+	usecs = (now.tv_sec - sim_start.tv_sec) * 1000000 +
+		(now.tv_usec - sim_start.tv_usec);
+	sim_print(name, calls, &sim->counts, usecs);
+	sim_add(&sim->total, &sim->counts);
+	if (result != cOCT6100_ERR_OK) {
+		fprintf(stderr, "%s failed, code %08x!\n", name, result);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Drive the Oct6100UserDriver* functions in oct612x-user.c the way the API
+ * does, and check that the chip ends up with what a write-through copy of
+ * the same accesses has.
+ */
+#define TEST_BASE	0x00100000
+#define TEST_WORDS	1024
+#define TEST_OPS	200000
+#define TEST_MAX_LEN	32
+
+static u16 test_shadow[TEST_WORDS];
+
+static void test_compare(struct oct612x_sim *sim, u32 address,
+			 const u16 *value, unsigned int len)
+{
+	unsigned int i;
+	unsigned int word = (address - TEST_BASE) >> 1;
+
+	for (i = 0; i < len; i++) {
+		if (value[i] != test_shadow[word + i]) {
+			fprintf(stderr, "read %04x from %08x, wrote %04x\n",
+				value[i], address + (i << 1),
+				test_shadow[word + i]);
+			sim->errors++;
+			return;
+		}
+	}
+}
+
+static int sim_test_combining(struct oct612x_sim *sim)
+{
+	struct oct612x_context *context = &sim->context;
+	tOCT6100_WRITE_PARAMS write;
+	tOCT6100_WRITE_SMEAR_PARAMS smear;
+	tOCT6100_WRITE_BURST_PARAMS wburst;
+	tOCT6100_READ_PARAMS read;
+	tOCT6100_READ_BURST_PARAMS rburst;
+	tOCT6100_GET_TIME now;
+	u16 data[TEST_MAX_LEN];
+	unsigned int depth = 0;
+	unsigned int next = 0;
+	unsigned long singles = 0;
+	unsigned int n, i;
+
+	memset(&write, 0, sizeof(write));
+	memset(&smear, 0, sizeof(smear));
+	memset(&wburst, 0, sizeof(wburst));
+	memset(&read, 0, sizeof(read));
+	memset(&rburst, 0, sizeof(rburst));
+	memset(&now, 0, sizeof(now));
+	write.pProcessContext = context;
+	smear.pProcessContext = context;
+	wburst.pProcessContext = context;
+	read.pProcessContext = context;
+	rburst.pProcessContext = context;
+	now.pProcessContext = context;
+
+	srand(1);
+	sim_begin(sim);
+	for (n = 0; n < TEST_OPS; n++) {
+		unsigned int op = rand() % 100;
+		/* Mostly runs of consecutive registers, like the API writes */
+		unsigned int word = (rand() % 4) ? next : rand() % TEST_WORDS;
+		unsigned int len = 1 + rand() % TEST_MAX_LEN;
+		u32 address;
+
+		if (word >= TEST_WORDS)
+			word = 0;
+		if (len > TEST_WORDS - word)
+			len = TEST_WORDS - word;
+		address = TEST_BASE + (word << 1);
+		next = word + 1;
+
+		/* Bottom halves only run the API while no batch is open */
+		oct612x_sim_in_interrupt = (!depth && !(rand() % 4));
+
+		if (op < 50) {
+			write.ulWriteAddress = address;
+			write.usWriteData = rand();
+			test_shadow[word] = write.usWriteData;
+			Oct6100UserDriverWriteApi(&write);
+			singles++;
+		} else if (op < 58) {
+			smear.ulWriteAddress = address;
+			smear.usWriteData = rand();
+			smear.ulWriteLength = len;
+			for (i = 0; i < len; i++)
+				test_shadow[word + i] = smear.usWriteData;
+			Oct6100UserDriverWriteSmearApi(&smear);
+			next = word + len;
+		} else if (op < 66) {
+			for (i = 0; i < len; i++) {
+				data[i] = rand();
+				test_shadow[word + i] = data[i];
+			}
+			wburst.ulWriteAddress = address;
+			wburst.pusWriteData = data;
+			wburst.ulWriteLength = len;
+			Oct6100UserDriverWriteBurstApi(&wburst);
+			next = word + len;
+		} else if (op < 80) {
+			read.ulReadAddress = address;
+			read.pusReadData = data;
+			Oct6100UserDriverReadApi(&read);
+			test_compare(sim, address, data, 1);
+		} else if (op < 88) {
+			rburst.ulReadAddress = address;
+			rburst.pusReadData = data;
+			rburst.ulReadLength = len;
+			Oct6100UserDriverReadBurstApi(&rburst);
+			test_compare(sim, address, data, len);
+		} else if (op < 92) {
+			Oct6100UserGetTime(&now);
+			sim_check_flushed(sim, "time check");
+		} else if (op < 96) {
+			if (depth < 3 && !oct612x_sim_in_interrupt) {
+				oct612x_begin_batch(context);
+				depth++;
+			}
+		} else if (depth) {
+			oct612x_end_batch(context);
+			if (!--depth)
+				sim_check_flushed(sim, "end of batch");
+		}
+		if (oct612x_sim_in_interrupt)
+			sim_check_flushed(sim, "interrupt context access");
+	}
+	oct612x_sim_in_interrupt = 0;
+	while (depth--)
+		oct612x_end_batch(context);
+	sim_check_flushed(sim, "end of test");
+
+	for (i = 0; i < TEST_WORDS; i++) {
+		if (*sim_word(sim, TEST_BASE + (i << 1)) != test_shadow[i]) {
+			fprintf(stderr, "chip has %04x at %08x, wrote %04x\n",
+				*sim_word(sim, TEST_BASE + (i << 1)),
+				TEST_BASE + (i << 1), test_shadow[i]);
+			sim->errors++;
+			break;
+		}
+	}
+	printf("%lu single writes from the API went out as %lu writes, "
+	       "%lu smears and %lu bursts with the others\n", singles,
+	       sim->counts.writes, sim->counts.smears,
+	       sim->counts.write_bursts);
+	return sim_end(sim, "write combining check", n,
+		       (sim->errors) ? cOCT6100_ERR_BASE : cOCT6100_ERR_OK);
+}
+
+static unsigned char *load_firmware(const char *path, UINT32 *size)
+{
+	unsigned char *data;
+	FILE *f;
+	long len;
+
+	f = fopen(path, "rb");
+	if (!f) {
+		perror(path);
+		return NULL;
+	}
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	rewind(f);
+	data = malloc(len);
+	if (data && (fread(data, 1, len, f) != (size_t)len)) {
+		free(data);
+		data = NULL;
+	}
+	fclose(f);
+	*size = len;
+	return data;
+}
+
+int main(int argc, char **argv)
+{
+	struct oct612x_sim *sim;
+	tOCT6100_CHIP_OPEN ChipOpen;
+	tOCT6100_GET_INSTANCE_SIZE InstanceSize;
+	tOCT6100_CHANNEL_OPEN ChannelOpen;
+	tOCT6100_CHANNEL_MODIFY modify;
+	tOCT6100_CHIP_CLOSE ChipClose;
+	tOCT6100_API_GET_CAPACITY_PINS CapacityPins;
+	tPOCT6100_INSTANCE_API pApiInstance;
+	UINT32 *hndl;
+	UINT32 ulResult;
+	unsigned char *firmware;
+	UINT32 fwsize;
+	unsigned int numchans;
+	unsigned int x;
+	int res = 0;
+
+	numchans = (argc > 2) ? atoi(argv[2]) : 128;
+
+	sim = calloc(1, sizeof(*sim));
+	hndl = calloc(numchans, sizeof(*hndl));
+	if (!sim || !hndl) {
+		perror("calloc");
+		return 2;
+	}
+	sim->context.ops = &sim_ops;
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	printf("%-28s %6s %9s %9s %16s %16s %16s %9s %8s\n", "call", "count",
+	       "writes", "reads", "smears/words", "wbursts/words",
+	       "rbursts/words", "bus ops", "usecs");
+
+	Oct6100ApiGetCapacityPinsDef(&CapacityPins);
+	CapacityPins.pProcessContext = &sim->context;
+	CapacityPins.ulMemoryType = cOCT6100_MEM_TYPE_DDR;
+	CapacityPins.fEnableMemClkOut = TRUE;
+	CapacityPins.ulMemClkFreq = cOCT6100_MCLK_FREQ_133_MHZ;
+	sim_begin(sim);
+	oct612x_begin_batch(&sim->context);
+	ulResult = Oct6100ApiGetCapacityPins(&CapacityPins);
+	oct612x_end_batch(&sim->context);
+	if (sim_end(sim, "Oct6100ApiGetCapacityPins", 1, ulResult))
+		res = 1;
+
+	if (sim_test_combining(sim))
+		res = 1;
+
+	if (argc < 2) {
+		sim_print("total", 0, &sim->total, 0);
+		free(hndl);
+		sim_free(sim);
+		return res;
+	}
+
+	firmware = load_firmware(argv[1], &fwsize);
+	if (!firmware)
+		return 2;
+
+	/* The same parameters init_vpm450m() uses. */
+	Oct6100ChipOpenDef(&ChipOpen);
+	ChipOpen.ulUpclkFreq = cOCT6100_UPCLK_FREQ_33_33_MHZ;
+	ChipOpen.pProcessContext = &sim->context;
+	ChipOpen.pbyImageFile = firmware;
+	ChipOpen.ulImageSize = fwsize;
+	ChipOpen.fEnableMemClkOut = TRUE;
+	ChipOpen.ulMemClkFreq = cOCT6100_MCLK_FREQ_133_MHZ;
+	ChipOpen.ulMaxChannels = numchans;
+	ChipOpen.ulMemoryType = cOCT6100_MEM_TYPE_DDR;
+	ChipOpen.ulMemoryChipSize = cOCT6100_MEMORY_CHIP_SIZE_32MB;
+	ChipOpen.ulNumMemoryChips = 1;
+	ChipOpen.aulTdmStreamFreqs[0] = cOCT6100_TDM_STREAM_FREQ_8MHZ;
+	ChipOpen.ulMaxFlexibleConfParticipants = 0;
+	ChipOpen.ulMaxConfBridges = 0;
+	ChipOpen.ulMaxRemoteDebugSessions = 0;
+	ChipOpen.fEnableChannelRecording = FALSE;
+	ChipOpen.ulSoftToneEventsBufSize = 64;
+	if (numchans <= 128) {
+		ChipOpen.ulMaxTdmStreams = 4;
+		ChipOpen.ulTdmSampling = cOCT6100_TDM_SAMPLE_AT_FALLING_EDGE;
+	} else {
+		ChipOpen.ulMaxTdmStreams = 32;
+		ChipOpen.fEnableFastH100Mode = TRUE;
+		ChipOpen.ulTdmSampling = cOCT6100_TDM_SAMPLE_AT_RISING_EDGE;
+	}
+
+	Oct6100GetInstanceSizeDef(&InstanceSize);
+	ulResult = Oct6100GetInstanceSize(&ChipOpen, &InstanceSize);
+	if (ulResult != cOCT6100_ERR_OK) {
+		fprintf(stderr, "Failed to get instance size, code %08x!\n",
+			ulResult);
+		return 1;
+	}
+	pApiInstance = malloc(InstanceSize.ulApiInstanceSize);
+	if (!pApiInstance) {
+		perror("malloc");
+		return 2;
+	}
+
+	sim_begin(sim);
+	oct612x_begin_batch(&sim->context);
+	ulResult = Oct6100ChipOpen(pApiInstance, &ChipOpen);
+	oct612x_end_batch(&sim->context);
+	if (sim_end(sim, "Oct6100ChipOpen", 1, ulResult))
+		return 1;
+
+	sim_begin(sim);
+	for (x = 0; x < numchans; x++) {
+		Oct6100ChannelOpenDef(&ChannelOpen);
+		ChannelOpen.pulChannelHndl = &hndl[x];
+		ChannelOpen.ulUserChanId = x;
+		ChannelOpen.TdmConfig.ulRinPcmLaw = cOCT6100_PCM_U_LAW;
+		ChannelOpen.TdmConfig.ulRinStream = 0;
+		ChannelOpen.TdmConfig.ulRinTimeslot = x;
+		ChannelOpen.TdmConfig.ulSinPcmLaw = cOCT6100_PCM_U_LAW;
+		ChannelOpen.TdmConfig.ulSinStream = 1;
+		ChannelOpen.TdmConfig.ulSinTimeslot = x;
+		ChannelOpen.TdmConfig.ulSoutPcmLaw = cOCT6100_PCM_U_LAW;
+		ChannelOpen.TdmConfig.ulSoutStream = 2;
+		ChannelOpen.TdmConfig.ulSoutTimeslot = x;
+		ChannelOpen.TdmConfig.ulRoutPcmLaw = cOCT6100_PCM_U_LAW;
+		ChannelOpen.TdmConfig.ulRoutStream = 3;
+		ChannelOpen.TdmConfig.ulRoutTimeslot = x;
+		ChannelOpen.VqeConfig.fEnableNlp = TRUE;
+		ChannelOpen.VqeConfig.fRinDcOffsetRemoval = TRUE;
+		ChannelOpen.VqeConfig.fSinDcOffsetRemoval = TRUE;
+		ChannelOpen.fEnableToneDisabler = TRUE;
+		ChannelOpen.ulEchoOperationMode = cOCT6100_ECHO_OP_MODE_POWER_DOWN;
+		ulResult = Oct6100ChannelOpen(pApiInstance, &ChannelOpen);
+		if (ulResult != cOCT6100_ERR_OK)
+			break;
+	}
+	if (sim_end(sim, "Oct6100ChannelOpen", x, ulResult))
+		res = 1;
+
+	/* What turning echo cancellation on and off for a call costs. */
+	sim_begin(sim);
+	ulResult = cOCT6100_ERR_OK;
+	for (x = 0; (x < numchans) && (ulResult == cOCT6100_ERR_OK); x++) {
+		Oct6100ChannelModifyDef(&modify);
+		modify.ulChannelHndl = hndl[x];
+		modify.ulEchoOperationMode = cOCT6100_ECHO_OP_MODE_NORMAL;
+		ulResult = Oct6100ChannelModify(pApiInstance, &modify);
+		if (ulResult != cOCT6100_ERR_OK)
+			break;
+		Oct6100ChannelModifyDef(&modify);
+		modify.ulChannelHndl = hndl[x];
+		modify.ulEchoOperationMode = cOCT6100_ECHO_OP_MODE_POWER_DOWN;
+		ulResult = Oct6100ChannelModify(pApiInstance, &modify);
+	}
+	if (sim_end(sim, "Oct6100ChannelModify", x * 2, ulResult))
+		res = 1;
+
+	sim_begin(sim);
+	Oct6100ChipCloseDef(&ChipClose);
+	ulResult = Oct6100ChipClose(pApiInstance, &ChipClose);
+	if (sim_end(sim, "Oct6100ChipClose", 1, ulResult))
+		res = 1;
+
+	sim_print("total", 0, &sim->total, 0);
+	if (sim->errors)
+		res = 1;
+
+	free(pApiInstance);
+	free(firmware);
+	free(hndl);
+	sim_free(sim);
+	return res;
+}
@@ -22,11 +22,100 @@
 
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/interrupt.h>
 
 #include <dahdi/kernel.h>
 
 #include "oct612x.h"
 
+/*
+ * Write combining
+ *
+ * The API mostly writes one register at a time, and every write is an
+ * indirect bus transaction on the board. While a batch is open, writes to
+ * consecutive addresses are held back and go out together through
+ * write_burst (or write_smear when they are all the same value). Anything
+ * that could observe the chip -- a read, a burst from the API itself, the
+ * API checking the time to wait on the chip -- sends them out first.
+ *
+ * Every API call that takes the serialize object is a batch. Callers can
+ * open a wider one with oct612x_begin_batch() around calls that don't, like
+ * Oct6100ChipOpen. The boards poll tone events from their bottom halves, so
+ * calls made in interrupt context leave the batch state alone and write
+ * straight through.
+ */
+static void oct612x_flush(struct oct612x_context *context)
+{
+	unsigned int i;
+
+	if (!context->pending || in_interrupt())
+		return;
+
+	if (1 == context->pending) {
+		context->ops->write(context, context->pending_address,
+				    context->pending_data[0]);
+	} else {
+		for (i = 1; i < context->pending; ++i) {
+			if (context->pending_data[i] !=
+			    context->pending_data[0])
+				break;
+		}
+		if (i == context->pending) {
+			context->ops->write_smear(context,
+						  context->pending_address,
+						  context->pending_data[0],
+						  context->pending);
+		} else {
+			context->ops->write_burst(context,
+						  context->pending_address,
+						  context->pending_data,
+						  context->pending);
+		}
+	}
+	context->bus_writes++;
+	context->pending = 0;
+}
+
+static void oct612x_queue_write(struct oct612x_context *context,
+				u32 address, u16 value)
+{
+	if (context->pending &&
+	    ((context->pending == OCT612X_MAX_PENDING) ||
+	     (address != context->pending_address + (context->pending << 1))))
+		oct612x_flush(context);
+
+	if (!context->pending)
+		context->pending_address = address;
+	context->pending_data[context->pending++] = value;
+	context->writes++;
+}
+
+void oct612x_begin_batch(struct oct612x_context *context)
+{
+	if (in_interrupt())
+		return;
+	if (!context->batch++) {
+		context->writes = 0;
+		context->bus_writes = 0;
+	}
+}
+EXPORT_SYMBOL(oct612x_begin_batch);
+
+void oct612x_end_batch(struct oct612x_context *context)
+{
+	if (in_interrupt())
+		return;
+	if (WARN_ON(!context->batch))
+		return;
+	oct612x_flush(context);
+	if (!--context->batch && context->dev && context->writes) {
+		dev_dbg(context->dev,
+			"oct612x: %lu writes sent in %lu bus transactions\n",
+			context->writes, context->bus_writes);
+	}
+}
+EXPORT_SYMBOL(oct612x_end_batch);
+
 UINT32 Oct6100UserGetTime(tPOCT6100_GET_TIME f_pTime)
 {
 	/* Why couldn't they just take a timeval like everyone else? */
@@ -34,6 +123,10 @@ UINT32 Oct6100UserGetTime(tPOCT6100_GET_TIME f_pTime)
 	unsigned long long total_usecs;
 	unsigned int mask = ~0;
 
+	/* The API is timing something the chip does; let it see our writes. */
+	if (f_pTime->pProcessContext)
+		oct612x_flush(f_pTime->pProcessContext);
+
 	do_gettimeofday(&tv);
 	total_usecs = (((unsigned long long)(tv.tv_sec)) * 1000000) +
 				  (((unsigned long long)(tv.tv_usec)));
@@ -74,14 +167,16 @@ UINT32 Oct6100UserDestroySerializeObject(
 UINT32 Oct6100UserSeizeSerializeObject(
 		tPOCT6100_SEIZE_SERIALIZE_OBJECT f_pSeize)
 {
-	/* Not needed */
+	/* Callers serialize their API calls themselves, but the API call
+	 * this brackets is a good unit for write combining. */
+	oct612x_begin_batch(f_pSeize->pProcessContext);
 	return cOCT6100_ERR_OK;
 }
 
 UINT32 Oct6100UserReleaseSerializeObject(
 		tPOCT6100_RELEASE_SERIALIZE_OBJECT f_pRelease)
 {
-	/* Not needed */
+	oct612x_end_batch(f_pRelease->pProcessContext);
 	return cOCT6100_ERR_OK;
 }
 
@@ -94,6 +189,11 @@ UINT32 Oct6100UserDriverWriteApi(tPOCT6100_WRITE_PARAMS f_pWriteParams)
 		return cOCT6100_ERR_BASE;
 	}
 #endif
+	if (context->batch && !in_interrupt()) {
+		oct612x_queue_write(context, f_pWriteParams->ulWriteAddress,
+				    f_pWriteParams->usWriteData);
+		return cOCT6100_ERR_OK;
+	}
 	context->ops->write(context, f_pWriteParams->ulWriteAddress,
 			    f_pWriteParams->usWriteData);
 	return cOCT6100_ERR_OK;
@@ -108,6 +208,7 @@ UINT32 Oct6100UserDriverWriteSmearApi(tPOCT6100_WRITE_SMEAR_PARAMS f_pSmearParam
 		return cOCT6100_ERR_BASE;
 	}
 #endif
+	oct612x_flush(context);
 	context->ops->write_smear(context, f_pSmearParams->ulWriteAddress,
 				  f_pSmearParams->usWriteData,
 				  f_pSmearParams->ulWriteLength);
@@ -124,6 +225,7 @@ UINT32 Oct6100UserDriverWriteBurstApi(
 		return cOCT6100_ERR_BASE;
 	}
 #endif
+	oct612x_flush(context);
 	context->ops->write_burst(context, f_pBurstParams->ulWriteAddress,
 				  f_pBurstParams->pusWriteData,
 				  f_pBurstParams->ulWriteLength);
@@ -139,6 +241,7 @@ UINT32 Oct6100UserDriverReadApi(tPOCT6100_READ_PARAMS f_pReadParams)
 		return cOCT6100_ERR_BASE;
 	}
 #endif
+	oct612x_flush(context);
 	context->ops->read(context, f_pReadParams->ulReadAddress,
 			   f_pReadParams->pusReadData);
 	return cOCT6100_ERR_OK;
@@ -153,6 +256,7 @@ UINT32 Oct6100UserDriverReadBurstApi(tPOCT6100_READ_BURST_PARAMS f_pBurstParams)
 		return cOCT6100_ERR_BASE;
 	}
 #endif
+	oct612x_flush(context);
 	context->ops->read_burst(context, f_pBurstParams->ulReadAddress,
 				 f_pBurstParams->pusReadData,
 				 f_pBurstParams->ulReadLength);
@@ -41,9 +41,22 @@ struct oct612x_ops {
 			  u16 *value, size_t count);
 };
 
+#define OCT612X_MAX_PENDING	64
+
 struct oct612x_context {
 	const struct oct612x_ops *ops;
 	struct device *dev;
+
+	/* Write combining, see oct612x_begin_batch(). */
+	unsigned int batch;
+	unsigned int pending;
+	u32 pending_address;
+	u16 pending_data[OCT612X_MAX_PENDING];
+	unsigned long writes;		/* single writes from the API */
+	unsigned long bus_writes;	/* ...and what they went out as */
 };
 
+void oct612x_begin_batch(struct oct612x_context *context);
+void oct612x_end_batch(struct oct612x_context *context);
+
 #endif /* __OCT612X_H__ */
@@ -0,0 +1,9 @@
+#include <linux/kernel.h>
+
+struct dahdi_device;
+
+static inline int dahdi_register_device(struct dahdi_device *ddev,
+					struct device *parent)
+{
+	return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Just enough of the kernel for oct612x-user.c to build into oct612x-sim.
+ * See oct612x-sim.c.
+ *
+ * Copyright (C) 2026, DAHDI Linux contributors
+ *
+ * All rights reserved.
+ *
+ */
+
+/*
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ */
+#ifndef _OCT612X_SIM_LINUX_KERNEL_H
+#define _OCT612X_SIM_LINUX_KERNEL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/time.h>
+
+typedef uint16_t u16;
+typedef uint32_t u32;
+struct device;
+
+/* Set by the simulator to run the API as a bottom half would. */
+extern int oct612x_sim_in_interrupt;
+#define in_interrupt()	(oct612x_sim_in_interrupt)
+
+#define WARN_ON(condition) ({						\
+	int __ret_warn_on = !!(condition);				\
+	if (__ret_warn_on)						\
+		fprintf(stderr, "WARNING at %s:%d: %s\n", __FILE__,	\
+			__LINE__, #condition);				\
+	__ret_warn_on;							\
+})
+
+#define pr_debug(fmt, ...)	fprintf(stderr, fmt, ##__VA_ARGS__)
+#define dev_dbg(dev, fmt, ...)	fprintf(stderr, fmt, ##__VA_ARGS__)
+
+static inline void do_gettimeofday(struct timeval *tv)
+{
+	gettimeofday(tv, NULL);
+}
+
+/* <linux/module.h> */
+#define __init
+#define __exit
+#define EXPORT_SYMBOL(sym)	extern int oct612x_sim_symbols
+#define MODULE_AUTHOR(s)	extern int oct612x_sim_modinfo
+#define MODULE_DESCRIPTION(s)	extern int oct612x_sim_modinfo
+#define MODULE_LICENSE(s)	extern int oct612x_sim_modinfo
+#define module_init(fn)		int (*oct612x_sim_module_init)(void) = fn
+#define module_exit(fn)		void (*oct612x_sim_module_exit)(void) = fn
+
+#endif /* _OCT612X_SIM_LINUX_KERNEL_H */
@@ -36,6 +36,7 @@
 #include <linux/timer.h>
 #include <linux/module.h>
 #include <linux/sched.h>
+#include <linux/hrtimer.h>
 
 #include <dahdi/kernel.h>
 #include "voicebus.h"
@@ -94,6 +95,26 @@
 
 #define OWN_BIT cpu_to_le32(1 << 31)
 
+/* Seconds the host must go without an underrun before the latency is reduced
+ * by one millisecond. Zero disables shrinking the latency. */
+static unsigned int latency_shrink_interval = VOICEBUS_DEFAULT_SHRINK_INTERVAL;
+
+#if defined(CONFIG_VOICEBUS_POLLED)
+/* Service all the boards from one timer instead of their interrupts. */
+static int polled;
+
+#define VOICEBUS_POLL_NS	(NSEC_PER_SEC / 1000)
+
+/* vb_poll_lock protects vb_poll_list and is held while the boards are
+ * serviced, so taking it is enough to wait for a running tick to finish. */
+static DEFINE_SPINLOCK(vb_poll_lock);
+static LIST_HEAD(vb_poll_list);
+static struct hrtimer vb_poll_timer;
+
+static void vb_poll_add(struct voicebus *vb);
+static void vb_poll_del(struct voicebus *vb);
+#endif
+
 #ifdef CONFIG_VOICEBUS_ECREFERENCE
 
 /*
@@ -360,6 +381,8 @@ voicebus_set_minlatency(struct voicebus *vb, unsigned int ms)
 	}
 	spin_lock_irqsave(&vb->lock, flags);
 	vb->min_tx_buffer_count = ms;
+	vb->floor_latency = ms;
+	vb->peak_latency = max(vb->peak_latency, ms);
 	spin_unlock_irqrestore(&vb->lock, flags);
 	return 0;
 }
@@ -378,6 +401,32 @@ voicebus_current_latency(struct voicebus *vb)
 }
 EXPORT_SYMBOL(voicebus_current_latency);
 
+/*! \brief Returns the largest latency this interface has run at. */
+int
+voicebus_peak_latency(struct voicebus *vb)
+{
+	int latency;
+	unsigned long flags;
+	spin_lock_irqsave(&vb->lock, flags);
+	latency = vb->peak_latency;
+	spin_unlock_irqrestore(&vb->lock, flags);
+	return latency;
+}
+EXPORT_SYMBOL(voicebus_peak_latency);
+
+/*! \brief Returns how many times the host fell behind the hardware. */
+unsigned int
+voicebus_underrun_count(struct voicebus *vb)
+{
+	unsigned int count;
+	unsigned long flags;
+	spin_lock_irqsave(&vb->lock, flags);
+	count = vb->underrun_count;
+	spin_unlock_irqrestore(&vb->lock, flags);
+	return count;
+}
+EXPORT_SYMBOL(voicebus_underrun_count);
+
 
 /*!
  * \brief Read one of the hardware control registers without acquiring locks.
@@ -432,18 +481,70 @@ vb_is_stopped(struct voicebus *vb)
 	return ret;
 }
 
+#if defined(CONFIG_VOICEBUS_POLLED)
+
+static inline int vb_is_polled(const struct voicebus *vb)
+{
+	return test_bit(VOICEBUS_POLLED, &vb->flags);
+}
+
+/**
+ * vb_poll_sync() - Wait for any poll tick in progress to complete.
+ *
+ */
+static void vb_poll_sync(void)
+{
+	unsigned long flags;
+	spin_lock_irqsave(&vb_poll_lock, flags);
+	spin_unlock_irqrestore(&vb_poll_lock, flags);
+}
+
+#else
+
+static inline int vb_is_polled(const struct voicebus *vb)
+{
+	return 0;
+}
+
+static inline void vb_poll_sync(void) { return; }
+static inline void vb_poll_add(struct voicebus *vb) { return; }
+static inline void vb_poll_del(struct voicebus *vb) { return; }
+
+#endif
+
+/**
+ * voicebus_synchronize() - Wait for the deferred processing to finish.
+ *
+ * Like synchronize_irq(), but also works when the board is being serviced
+ * from the shared poll timer.
+ */
+void voicebus_synchronize(struct voicebus *vb)
+{
+	if (vb_is_polled(vb))
+		vb_poll_sync();
+	else
+		synchronize_irq(vb->pdev->irq);
+}
+EXPORT_SYMBOL(voicebus_synchronize);
+
 #if defined(CONFIG_VOICEBUS_INTERRUPT)
 
 static inline void vb_disable_deferred(struct voicebus *vb)
 {
-	if (atomic_inc_return(&vb->deferred_disabled_count) == 1)
-		disable_irq(vb->pdev->irq);
+	if (atomic_inc_return(&vb->deferred_disabled_count) == 1) {
+		if (vb_is_polled(vb))
+			vb_poll_sync();
+		else
+			disable_irq(vb->pdev->irq);
+	}
 }
 
 static inline void vb_enable_deferred(struct voicebus *vb)
 {
-	if (atomic_dec_return(&vb->deferred_disabled_count) == 0)
-		enable_irq(vb->pdev->irq);
+	if (atomic_dec_return(&vb->deferred_disabled_count) == 0) {
+		if (!vb_is_polled(vb))
+			enable_irq(vb->pdev->irq);
+	}
 }
 
 #else
@@ -1000,9 +1101,18 @@ __vb_rx_demand_poll(struct voicebus *vb)
 		__vb_setctl(vb, 0x0010, 0x00000000);
 }
 
+/*
+ * When polled, the interrupt enable register is left cleared and
+ * "enabling interrupts" only lets the poll timer service the board again.
+ */
 static void
 __vb_enable_interrupts(struct voicebus *vb)
 {
+	if (vb_is_polled(vb)) {
+		clear_bit(VOICEBUS_POLL_MASKED, &vb->flags);
+		return;
+	}
+
 	if (BOOT == vb->mode)
 		__vb_setctl(vb, IER_CSR7, DEFAULT_NO_IDLE_INTERRUPTS);
 	else
@@ -1012,6 +1122,7 @@ __vb_enable_interrupts(struct voicebus *vb)
 static void
 __vb_disable_interrupts(struct voicebus *vb)
 {
+	set_bit(VOICEBUS_POLL_MASKED, &vb->flags);
 	__vb_setctl(vb, IER_CSR7, 0);
 }
 
@@ -1208,8 +1319,11 @@ voicebus_release(struct voicebus *vb)
 
 	tasklet_kill(&vb->tasklet);
 
+	if (vb_is_polled(vb))
+		vb_poll_del(vb);
 #if !defined(CONFIG_VOICEBUS_TIMER)
-	free_irq(vb->pdev->irq, vb);
+	else
+		free_irq(vb->pdev->irq, vb);
 #endif
 
 	/* Cleanup memory and software resources. */
@@ -1230,6 +1344,103 @@ voicebus_release(struct voicebus *vb)
 }
 EXPORT_SYMBOL(voicebus_release);
 
+/**
+ * vb_reset_headroom() - Start a new observation window for the latency.
+ *
+ */
+static inline void vb_reset_headroom(struct voicebus *vb)
+{
+	vb->min_headroom = DRING_SIZE;
+	vb->latency_changed = jiffies;
+}
+
+/**
+ * vb_record_underrun() - Note that the host was not able to keep up.
+ *
+ * Each underrun doubles the time the host has to remain stable before the
+ * latency is allowed to shrink again, so that a host which periodically
+ * stalls does not oscillate between two latencies.
+ */
+static void vb_record_underrun(struct voicebus *vb)
+{
+	const unsigned long max_period = (unsigned long)latency_shrink_interval *
+					 VOICEBUS_MAX_SHRINK_BACKOFF * HZ;
+
+	++vb->underrun_count;
+	vb->shrink_period = min(vb->shrink_period << 1, max_period);
+	vb_reset_headroom(vb);
+}
+
+/**
+ * vb_update_headroom() - Track how far ahead of the hardware the host is.
+ *
+ * Called from the deferred routine after the completed transmit buffers have
+ * been removed from the ring, so txd.count is the number of frames still
+ * queued ahead of the hardware.
+ */
+static inline void vb_update_headroom(struct voicebus *vb)
+{
+	if (vb->txd.count < vb->min_headroom)
+		vb->min_headroom = vb->txd.count;
+}
+
+/**
+ * vb_decrease_latency() - Give back a transmit buffer if the host is stable.
+ * @vb:		The voicebus interface.
+ * @buffers:	Completed buffers about to be passed to handle_transmit.
+ *
+ * A host that services the card every millisecond always finds
+ * min_tx_buffer_count - 1 frames still queued.  Every millisecond it is late
+ * shows up as one less frame in the ring, so the lowest depth seen over the
+ * observation window tells us how much latency the host actually needed.
+ * If that fits in one less millisecond than we currently run with, one
+ * completed buffer is returned to the dma_pool instead of being resent.
+ *
+ * Returns 1 if the latency was reduced.
+ */
+static int
+vb_decrease_latency(struct voicebus *vb, struct list_head *buffers)
+{
+	struct vbb *vbb;
+	unsigned int lateness;
+	const unsigned int queued = vb->min_tx_buffer_count - 1;
+
+	if (!latency_shrink_interval || list_empty(buffers))
+		return 0;
+
+	if (test_bit(VOICEBUS_LATENCY_LOCKED, &vb->flags))
+		return 0;
+
+	if (vb->min_tx_buffer_count <= vb->floor_latency)
+		return 0;
+
+	if (time_before(jiffies, vb->latency_changed + vb->shrink_period))
+		return 0;
+
+	lateness = queued - min(vb->min_headroom, queued);
+	vb_reset_headroom(vb);
+
+	if ((VOICEBUS_DEFAULT_LATENCY + lateness) >= vb->min_tx_buffer_count)
+		return 0;
+
+	vbb = list_entry(buffers->prev, struct vbb, entry);
+	list_del(&vbb->entry);
+	dma_pool_free(vb->pool, vbb, vbb->dma_addr);
+
+	--vb->min_tx_buffer_count;
+	vb->shrink_period = max(vb->shrink_period >> 1,
+				(unsigned long)latency_shrink_interval * HZ);
+	return 1;
+}
+
+static void vb_print_latency_decrease(struct voicebus *vb)
+{
+	if (*vb->debug && printk_ratelimit()) {
+		dev_info(&vb->pdev->dev, "Host has been stable. Decreasing "
+			 "latency to %d ms.\n", vb->min_tx_buffer_count);
+	}
+}
+
 static void
 vb_increase_latency(struct voicebus *vb, unsigned int increase,
 		    struct list_head *buffers)
@@ -1244,6 +1455,8 @@ vb_increase_latency(struct voicebus *vb, unsigned int increase,
 	if (0 == increase)
 		return;
 
+	vb_record_underrun(vb);
+
 	if (test_bit(VOICEBUS_LATENCY_LOCKED, &vb->flags))
 		return;
 
@@ -1283,6 +1496,8 @@ vb_increase_latency(struct voicebus *vb, unsigned int increase,
 	/* Set the new latency (but we want to ensure that there aren't any
 	 * printks to the console, so we don't call the function) */
 	vb->min_tx_buffer_count += increase;
+	if (vb->min_tx_buffer_count > vb->peak_latency)
+		vb->peak_latency = vb->min_tx_buffer_count;
 }
 
 static void vb_schedule_deferred(struct voicebus *vb)
@@ -1375,6 +1590,7 @@ static void vb_tasklet_hx8(unsigned long data)
 {
 	struct voicebus *vb = (struct voicebus *)data;
 	int hardunderrun;
+	int decreased = 0;
 	LIST_HEAD(buffers);
 	struct vbb *vbb;
 	const int DEFAULT_COUNT = 5;
@@ -1394,9 +1610,14 @@ static void vb_tasklet_hx8(unsigned long data)
 	while ((vbb = vb_get_completed_txb(vb)))
 		list_add_tail(&vbb->entry, &vb->tx_complete);
 
+	vb_update_headroom(vb);
+
 	while (--count && !list_empty(&vb->tx_complete))
 		list_move_tail(vb->tx_complete.next, &buffers);
 
+	if (likely(!hardunderrun))
+		decreased = vb_decrease_latency(vb, &buffers);
+
 	/* Prep all the new buffers for transmit before actually sending any
 	 * of them. */
 	handle_transmit(vb, &buffers);
@@ -1433,6 +1654,8 @@ static void vb_tasklet_hx8(unsigned long data)
 			}
 		}
 #endif
+	} else if (unlikely(decreased)) {
+		vb_print_latency_decrease(vb);
 	}
 
 #if !defined(CONFIG_VOICEBUS_INTERRUPT)
@@ -1473,6 +1696,7 @@ static void vb_tasklet_normal(unsigned long data)
 {
 	struct voicebus *vb = (struct voicebus *)data;
 	int softunderrun;
+	int decreased = 0;
 	LIST_HEAD(buffers);
 	struct vbb *vbb;
 	struct voicebus_descriptor_list *const dl = &vb->txd;
@@ -1513,11 +1737,15 @@ static void vb_tasklet_normal(unsigned long data)
 
 	} else {
 		softunderrun = 0;
+		vb_update_headroom(vb);
 	}
 
 	while (--count && !list_empty(&vb->tx_complete))
 		list_move_tail(vb->tx_complete.next, &buffers);
 
+	if (likely(!softunderrun))
+		decreased = vb_decrease_latency(vb, &buffers);
+
 	/* Prep all the new buffers for transmit before actually sending any
 	 * of them. */
 	handle_transmit(vb, &buffers);
@@ -1588,6 +1816,8 @@ static void vb_tasklet_normal(unsigned long data)
 			}
 		}
 #endif
+	} else if (unlikely(decreased)) {
+		vb_print_latency_decrease(vb);
 	}
 
 #if !defined(CONFIG_VOICEBUS_INTERRUPT)
@@ -1656,6 +1886,8 @@ static void handle_hardunderrun(struct work_struct *work)
 				 "hardunderun.\n", DRING_SIZE);
 		}
 
+		vb_record_underrun(vb);
+
 		if (vb->ops->handle_error)
 			vb->ops->handle_error(vb);
 
@@ -1762,6 +1994,74 @@ vb_timer(unsigned long data)
 }
 #endif
 
+#if defined(CONFIG_VOICEBUS_POLLED)
+/**
+ * vb_poll_tick() - Service every polled board back-to-back.
+ *
+ * Runs once a millisecond in place of the per-board interrupts. Boards whose
+ * interrupts are masked or whose deferred processing is disabled are skipped.
+ * The timer stops itself once the last board has been removed.
+ */
+static enum hrtimer_restart vb_poll_tick(struct hrtimer *timer)
+{
+	struct voicebus *vb;
+	unsigned long flags;
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+
+	spin_lock_irqsave(&vb_poll_lock, flags);
+	list_for_each_entry(vb, &vb_poll_list, poll_node) {
+		if (test_bit(VOICEBUS_POLL_MASKED, &vb->flags) ||
+		    atomic_read(&vb->deferred_disabled_count))
+			continue;
+		vb_isr(vb->pdev->irq, vb);
+	}
+
+	if (!list_empty(&vb_poll_list)) {
+		hrtimer_forward_now(timer, ktime_set(0, VOICEBUS_POLL_NS));
+		ret = HRTIMER_RESTART;
+	}
+	spin_unlock_irqrestore(&vb_poll_lock, flags);
+	return ret;
+}
+
+static void vb_poll_add(struct voicebus *vb)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&vb_poll_lock, flags);
+	if (list_empty(&vb_poll_list)) {
+		hrtimer_start(&vb_poll_timer, ktime_set(0, VOICEBUS_POLL_NS),
+			      HRTIMER_MODE_REL);
+	}
+	list_add_tail(&vb->poll_node, &vb_poll_list);
+	spin_unlock_irqrestore(&vb_poll_lock, flags);
+}
+
+static void vb_poll_del(struct voicebus *vb)
+{
+	unsigned long flags;
+	int empty;
+
+	spin_lock_irqsave(&vb_poll_lock, flags);
+	list_del_init(&vb->poll_node);
+	empty = list_empty(&vb_poll_list);
+	spin_unlock_irqrestore(&vb_poll_lock, flags);
+
+	if (!empty)
+		return;
+
+	hrtimer_cancel(&vb_poll_timer);
+
+	/* Another board may have been added while the timer was cancelled. */
+	spin_lock_irqsave(&vb_poll_lock, flags);
+	if (!list_empty(&vb_poll_list)) {
+		hrtimer_start(&vb_poll_timer, ktime_set(0, VOICEBUS_POLL_NS),
+			      HRTIMER_MODE_REL);
+	}
+	spin_unlock_irqrestore(&vb_poll_lock, flags);
+}
+#endif
+
 /*!
  * \brief Initalize the voicebus interface.
  *
@@ -1794,7 +2094,19 @@ __voicebus_init(struct voicebus *vb, const char *board_name,
 
 	vb->mode = mode;
 
+#if defined(CONFIG_VOICEBUS_POLLED)
+	INIT_LIST_HEAD(&vb->poll_node);
+	if (polled)
+		set_bit(VOICEBUS_POLLED, &vb->flags);
+#endif
+	set_bit(VOICEBUS_POLL_MASKED, &vb->flags);
+
 	vb->min_tx_buffer_count = VOICEBUS_DEFAULT_LATENCY;
+	vb->floor_latency = VOICEBUS_DEFAULT_LATENCY;
+	vb->peak_latency = VOICEBUS_DEFAULT_LATENCY;
+	vb->underrun_count = 0;
+	vb->shrink_period = (unsigned long)latency_shrink_interval * HZ;
+	vb_reset_headroom(vb);
 
 	INIT_LIST_HEAD(&vb->tx_complete);
 	INIT_LIST_HEAD(&vb->free_rx);
@@ -1885,14 +2197,23 @@ __voicebus_init(struct voicebus *vb, const char *board_name,
 		goto cleanup;
 
 #if !defined(CONFIG_VOICEBUS_TIMER)
-	retval = request_irq(vb->pdev->irq, vb_isr, DAHDI_IRQ_SHARED,
-			     board_name, vb);
-	if (retval) {
-		dev_warn(&vb->pdev->dev, "Failed to request interrupt line.\n");
-		goto cleanup;
+	if (!vb_is_polled(vb)) {
+		retval = request_irq(vb->pdev->irq, vb_isr, DAHDI_IRQ_SHARED,
+				     board_name, vb);
+		if (retval) {
+			dev_warn(&vb->pdev->dev,
+				 "Failed to request interrupt line.\n");
+			goto cleanup;
+		}
 	}
 #endif
 
+	if (vb_is_polled(vb)) {
+		vb_poll_add(vb);
+		dev_info(&vb->pdev->dev, "Polling instead of using "
+			 "interrupts.\n");
+	}
+
 #ifdef VOICEBUS_NET_DEBUG
 	vb_net_register(vb, board_name);
 #endif
@@ -2032,14 +2353,31 @@ static int __init voicebus_module_init(void)
 	 * unloaded as well. */
 	dahdi_register_device(NULL, NULL);
 	spin_lock_init(&loader_list_lock);
+#if defined(CONFIG_VOICEBUS_POLLED)
+	hrtimer_init(&vb_poll_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	vb_poll_timer.function = vb_poll_tick;
+#endif
 	return 0;
 }
 
 static void __exit voicebus_module_cleanup(void)
 {
 	WARN_ON(!list_empty(&binary_loader_list));
+#if defined(CONFIG_VOICEBUS_POLLED)
+	WARN_ON(!list_empty(&vb_poll_list));
+	hrtimer_cancel(&vb_poll_timer);
+#endif
 }
 
+#if defined(CONFIG_VOICEBUS_POLLED)
+module_param(polled, int, 0444);
+MODULE_PARM_DESC(polled, "Set to 1 to service all boards from a shared "
+		 "1 ms timer instead of per-board interrupts.");
+#endif
+module_param(latency_shrink_interval, uint, 0644);
+MODULE_PARM_DESC(latency_shrink_interval, "Seconds without an underrun "
+		 "before the latency is reduced by 1 ms (0 to disable).");
+
 MODULE_DESCRIPTION("Voicebus Interface w/VPMADT032 support");
 MODULE_AUTHOR("Digium Incorporated <support@digium.com>");
 MODULE_LICENSE("GPL");
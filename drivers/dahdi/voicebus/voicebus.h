@@ -29,6 +29,7 @@
 #ifndef __VOICEBUS_H__
 #define __VOICEBUS_H__
 
+#include <linux/version.h>
 #include <linux/interrupt.h>
 
 
@@ -36,6 +37,12 @@
 #define VOICEBUS_DEFAULT_MAXLATENCY	25U
 #define VOICEBUS_MAXLATENCY_BUMP	6U
 
+/* Seconds without an underrun before the latency is allowed to shrink, and
+ * the largest multiple of that the period may back off to when underruns
+ * keep recurring. */
+#define VOICEBUS_DEFAULT_SHRINK_INTERVAL	60U
+#define VOICEBUS_MAX_SHRINK_BACKOFF		16U
+
 #define VOICEBUS_SFRAME_SIZE 1004U
 
 /*! The number of descriptors in both the tx and rx descriptor ring. */
@@ -57,6 +64,15 @@
  * (and not tasklet). */
 #define CONFIG_VOICEBUS_INTERRUPT
 
+/* Allow all the voicebus boards to be serviced back-to-back from one shared
+ * high resolution timer, with the board interrupts masked, instead of each
+ * board raising an interrupt every millisecond. Selected at load time with the
+ * 'polled' module parameter. */
+#if defined(CONFIG_VOICEBUS_INTERRUPT) && \
+	LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 25)
+#define CONFIG_VOICEBUS_POLLED
+#endif
+
 /*
  * Enable the following definition in order to disable Active-State Power
  * Management on the PCIe bridge for PCIe cards. This has been known to work
@@ -119,6 +135,8 @@ struct voicebus_descriptor_list {
 #define VOICEBUS_STOPPED			2
 #define VOICEBUS_LATENCY_LOCKED			3
 #define VOICEBUS_HARD_UNDERRUN			4
+#define VOICEBUS_POLLED				5
+#define VOICEBUS_POLL_MASKED			6
 
 /**
  * voicebus_mode
@@ -160,11 +178,21 @@ struct voicebus {
 	struct timer_list	timer;
 #endif
 
+#if defined(CONFIG_VOICEBUS_POLLED)
+	struct list_head	poll_node;
+#endif
+
 	struct work_struct	underrun_work;
 	const struct voicebus_operations *ops;
 	unsigned long		flags;
 	unsigned int		min_tx_buffer_count;
 	unsigned int		max_latency;
+	unsigned int		floor_latency;
+	unsigned int		peak_latency;
+	unsigned int		underrun_count;
+	unsigned int		min_headroom;
+	unsigned long		latency_changed;
+	unsigned long		shrink_period;
 	struct list_head	tx_complete;
 	struct list_head	free_rx;
 	struct dma_pool		*pool;
@@ -190,6 +218,9 @@ void voicebus_quiesce(struct voicebus *vb);
 int voicebus_transmit(struct voicebus *vb, struct vbb *vbb);
 int voicebus_set_minlatency(struct voicebus *vb, unsigned int milliseconds);
 int voicebus_current_latency(struct voicebus *vb);
+int voicebus_peak_latency(struct voicebus *vb);
+unsigned int voicebus_underrun_count(struct voicebus *vb);
+void voicebus_synchronize(struct voicebus *vb);
 
 static inline int voicebus_init(struct voicebus *vb, const char *board_name)
 {
@@ -203,7 +234,7 @@ voicebus_boot_init(struct voicebus *vb, const char *board_name)
 }
 
 /**
- * voicebus_lock_latency() - Do not increase the latency during underruns.
+ * voicebus_lock_latency() - Do not change the latency during underruns.
  *
  */
 static inline void voicebus_lock_latency(struct voicebus *vb)
@@ -212,7 +243,8 @@ static inline void voicebus_lock_latency(struct voicebus *vb)
 }
 
 /**
- * voicebus_unlock_latency() - Bump up the latency during underruns.
+ * voicebus_unlock_latency() - Bump up the latency during underruns, and let
+ * it shrink back once the host has been stable for a while.
  *
  */
 static inline void voicebus_unlock_latency(struct voicebus *vb)
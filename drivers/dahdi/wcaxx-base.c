@@ -570,7 +570,9 @@ static struct vpm450m *init_vpm450m(struct wcaxx *wc, int isalaw,
 
 	/* Perform the actual configuration of the chip. */
 	wcxb_enable_echocan_dram(&wc->xb);
+	oct612x_begin_batch(&vpm450m->context);
 	ulResult = Oct6100ChipOpen(vpm450m->pApiInstance, ChipOpen);
+	oct612x_end_batch(&vpm450m->context);
 	if (ulResult != cOCT6100_ERR_OK) {
 		dev_info(&wc->xb.pdev->dev, "Unable to Oct6100ChipOpen: %x\n",
 				ulResult);
@@ -922,6 +924,7 @@ static int ringdebounce = DEFAULT_RING_DEBOUNCE;
 static int latency = WCXB_DEFAULT_LATENCY;
 static unsigned int max_latency = WCXB_DEFAULT_MAXLATENCY;
 static int forceload;
+static int span_chunks;
 
 #define MS_PER_HOOKCHECK	(1)
 #define NEONMWI_ON_DEBOUNCE	(100/MS_PER_HOOKCHECK)
@@ -1969,7 +1972,7 @@ wcaxx_isr_misc_fxs(struct wcaxx *wc, struct wcaxx_module *const mod)
 
 static void wcaxx_handle_receive(struct wcxb *xb, void *_frame)
 {
-	int i, j;
+	int i;
 	struct wcaxx *wc = container_of(xb, struct wcaxx, xb);
 	u8 *const frame = _frame;
 
@@ -1990,12 +1993,7 @@ static void wcaxx_handle_receive(struct wcxb *xb, void *_frame)
 	if (!test_bit(DAHDI_FLAGBIT_REGISTERED, &wc->span.flags))
 		return;
 
-	for (j = 0; j < DAHDI_CHUNKSIZE; j++) {
-		for (i = 0; i < wc->span.channels; i++) {
-			wc->chans[i]->chan.readchunk[j] =
-				frame[j*WCXB_DMA_CHAN_SIZE+(1+i*4)];
-		}
-	}
+	dahdi_tdm_deinterleave_span(&wc->span, &frame[1], 4, WCXB_DMA_CHAN_SIZE);
 	for (i = 0; i < wc->span.channels; i++) {
 		struct dahdi_chan *const c = wc->span.chans[i];
 		__dahdi_ec_chunk(c, c->readchunk, c->readchunk, c->writechunk);
@@ -2006,7 +2004,6 @@ static void wcaxx_handle_receive(struct wcxb *xb, void *_frame)
 
 static void wcaxx_handle_transmit(struct wcxb *xb, void *_frame)
 {
-	int i, j;
 	struct wcaxx *wc = container_of(xb, struct wcaxx, xb);
 	u8 *const frame = _frame;
 
@@ -2017,12 +2014,7 @@ static void wcaxx_handle_transmit(struct wcxb *xb, void *_frame)
 		return;
 
 	_dahdi_transmit(&wc->span);
-	for (j = 0; j < DAHDI_CHUNKSIZE; j++) {
-		for (i = 0; i <  wc->span.channels; i++) {
-			struct dahdi_chan *c = &wc->chans[i]->chan;
-			frame[j*WCXB_DMA_CHAN_SIZE+(1+i*4)] = c->writechunk[j];
-		}
-	}
+	dahdi_tdm_interleave_span(&frame[1], &wc->span, 4, WCXB_DMA_CHAN_SIZE);
 	return;
 }
 
@@ -3846,6 +3838,7 @@ static void wcaxx_back_out_gracefully(struct wcaxx *wc)
 		mod->mod_poll = NULL;
 	}
 
+	dahdi_span_free_chunks(&wc->span);
 	kfree(wc->span.chans);
 	wc->span.chans = NULL;
 
@@ -4282,6 +4275,11 @@ __wcaxx_init_one(struct pci_dev *pdev, const struct pci_device_id *ent)
 	wcaxx_fixup_span(wc);
 	curchan += wc->desc->ports;
 
+	if (span_chunks && dahdi_span_alloc_chunks(&wc->span)) {
+		wcaxx_back_out_gracefully(wc);
+		return -ENOMEM;
+	}
+
 #ifdef USE_ASYNC_INIT
 	async_synchronize_cookie(cookie);
 #endif
@@ -4487,7 +4485,8 @@ static void __exit wcaxx_cleanup(void)
 module_param(debug, int, 0600);
 module_param(int_mode, int, 0400);
 MODULE_PARM_DESC(int_mode,
-	"0 = Use MSI interrupt if available. 1 = Legacy interrupt only.\n");
+	"0 = Use MSI interrupt if available. 1 = Legacy interrupt only. "
+	"2 = Poll all cards from a shared 1 ms timer.\n");
 module_param(fastpickup, int, 0400);
 MODULE_PARM_DESC(fastpickup,
 	"Set to 1 to shorten the calibration delay when taking an FXO port off "
@@ -4530,6 +4529,11 @@ module_param(forceload, int, 0600);
 MODULE_PARM_DESC(forceload,
 	"Set to 1 in order to force an FPGA reload after power on.");
 
+module_param(span_chunks, int, 0400);
+MODULE_PARM_DESC(span_chunks,
+	"Set to 1 to keep the chunks of all the channels in one contiguous "
+	"array instead of in each channel.");
+
 module_param(companding, charp, 0400);
 MODULE_PARM_DESC(companding,
 	"Change the companding to \"auto\" or \"alaw\" or \"ulaw\". Auto "
@@ -753,102 +753,7 @@ static void ec_init(struct b4xxp *b4)
 #endif
 }
 
-/* performs a register write and then waits for the HFC "busy" bit to clear */
-static void hfc_setreg_waitbusy(struct b4xxp *b4, const unsigned int reg, const unsigned int val)
-{
-	int timeout = 0;
-	unsigned long start;
-	const int TIMEOUT = HZ/4; /* 250ms */
-
-	start = jiffies;
-	while (unlikely((b4xxp_getreg8(b4, R_STATUS) & V_BUSY))) {
-		if (time_after(jiffies, start + TIMEOUT)) {
-			timeout = 1;
-			break;
-		}
-	};
-
-	mb();
-	b4xxp_setreg8(b4, reg, val);
-	mb();
-
-	start = jiffies;
-	while (likely((b4xxp_getreg8(b4, R_STATUS) & V_BUSY))) {
-		if (time_after(jiffies, start + TIMEOUT)) {
-			timeout = 1;
-			break;
-		}
-	};
-
-	if (timeout && printk_ratelimit()) {
-		dev_warn(&b4->pdev->dev,
-			 "hfc_setreg_waitbusy(write 0x%02x to 0x%02x) timed "
-			 "out waiting for busy flag to clear!\n", val, reg);
-	}
-}
-
-/*
- * reads an 8-bit register over over and over until the same value is read twice, then returns that value.
- */
-static inline unsigned char hfc_readcounter8(struct b4xxp *b4, const unsigned int reg)
-{
-	unsigned char r1, r2;
-	unsigned long maxwait = 1048576;
-
-	do {
-		r1 = b4xxp_getreg8(b4, reg);
-		r2 = b4xxp_getreg8(b4, reg);
-	} while ((r1 != r2) && maxwait--);
-
-	if (!maxwait && printk_ratelimit()) {
-		dev_warn(&b4->pdev->dev,
-			 "hfc_readcounter8(reg 0x%02x) timed out waiting "
-			 "for data to settle!\n", reg);
-	}
-
-	return r1;
-}
-
-/*
- * reads a 16-bit register over over and over until the same value is read twice, then returns that value.
- */
-static inline unsigned short hfc_readcounter16(struct b4xxp *b4, const unsigned int reg)
-{
-	unsigned short r1, r2;
-	unsigned long maxwait = 1048576;
-
-	do {
-		r1 = b4xxp_getreg16(b4, reg);
-		r2 = b4xxp_getreg16(b4, reg);
-	} while ((r1 != r2) && maxwait--);
-
-	if (!maxwait && printk_ratelimit()) {
-		dev_warn(&b4->pdev->dev,
-			 "hfc_readcounter16(reg 0x%02x) timed out waiting "
-			 "for data to settle!\n", reg);
-	}
-
-	return r1;
-}
-
-static inline unsigned int hfc_readcounter32(struct b4xxp *b4, const unsigned int reg)
-{
-	unsigned int r1, r2;
-	unsigned long maxwait = 1048576;
-
-	do {
-		r1 = b4xxp_getreg32(b4, reg);
-		r2 = b4xxp_getreg32(b4, reg);
-	} while ((r1 != r2) && maxwait--);
-
-	if (!maxwait && printk_ratelimit()) {
-		dev_warn(&b4->pdev->dev,
-			 "hfc_readcounter32(reg 0x%02x) timed out waiting "
-			 "for data to settle!\n", reg);
-	}
-
-	return r1;
-}
+#include "fifo.c"
 
 /* performs a soft-reset of the HFC-4S.  This is as clean-slate as you can get to a hardware reset. */
 static void hfc_reset(struct b4xxp *b4)
@@ -1208,11 +1113,43 @@ static ssize_t b4_timing_master_show(struct device *dev,
 
 static DEVICE_ATTR(timing_master, 0400, b4_timing_master_show, NULL);
 
+/* "<waits> <polls> <max>": how often, and how long, we spun on V_BUSY */
+static ssize_t b4_fifo_busywait_show(struct device *dev,
+				     struct device_attribute *attr,
+				     char *buf)
+{
+	struct b4xxp *b4 = dev_get_drvdata(dev);
+	return sprintf(buf, "%lu %lu %u\n", b4->busywait_count,
+		       b4->busywait_polls, b4->busywait_max);
+}
+
+/* any write clears the counters */
+static ssize_t b4_fifo_busywait_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	struct b4xxp *b4 = dev_get_drvdata(dev);
+	unsigned long irq_flags;
+
+	spin_lock_irqsave(&b4->fifolock, irq_flags);
+	b4->busywait_count = 0;
+	b4->busywait_polls = 0;
+	b4->busywait_max = 0;
+	spin_unlock_irqrestore(&b4->fifolock, irq_flags);
+	return count;
+}
+
+static DEVICE_ATTR(fifo_busywait, 0600, b4_fifo_busywait_show,
+		   b4_fifo_busywait_store);
+
 static void create_sysfs_files(struct b4xxp *b4)
 {
 	int ret;
 	ret = device_create_file(&b4->pdev->dev,
 				 &dev_attr_timing_master);
+	if (!ret)
+		ret = device_create_file(&b4->pdev->dev,
+					 &dev_attr_fifo_busywait);
 	if (ret) {
 		dev_info(&b4->pdev->dev,
 			"Failed to create device attributes.\n");
@@ -1221,6 +1158,8 @@ static void create_sysfs_files(struct b4xxp *b4)
 
 static void remove_sysfs_files(struct b4xxp *b4)
 {
+	device_remove_file(&b4->pdev->dev,
+			   &dev_attr_fifo_busywait);
 	device_remove_file(&b4->pdev->dev,
 			   &dev_attr_timing_master);
 }
@@ -1624,91 +1563,6 @@ static void hfc_init_all_st(struct b4xxp *b4)
 	}
 }
 
-/*
- * Look at one B-channel FIFO and determine if we should exchange data with it.
- * It is assumed that the S/T port is active.
- * returns 1 if data was exchanged, 0 otherwise.
- */
-static int hfc_poll_one_bchan_fifo(struct b4xxp_span *span, int c)
-{
-	int fifo, zlen, z1, z2, ret;
-	unsigned long irq_flags;
-	struct b4xxp *b4;
-	struct dahdi_chan *chan;
-
-	ret = 0;
-	b4 = span->parent;
-	fifo = span->fifos[c];
-	chan = span->chans[c];
-
-	spin_lock_irqsave(&b4->fifolock, irq_flags);
-
-/* select RX FIFO */
-	hfc_setreg_waitbusy(b4, R_FIFO, (fifo << V_FIFO_NUM_SHIFT) | V_FIFO_DIR | V_REV);
-
-	get_Z(z1, z2, zlen);
-
-/* TODO: error checking, full FIFO mostly */
-
-	if (zlen >= DAHDI_CHUNKSIZE) {
-		*(unsigned int *)&chan->readchunk[0] = b4xxp_getreg32(b4, A_FIFO_DATA2);
-		*(unsigned int *)&chan->readchunk[4] = b4xxp_getreg32(b4, A_FIFO_DATA2);
-/*
- * now TX FIFO
- *
- * Note that we won't write to the TX FIFO if there wasn't room in the RX FIFO.
- * The TX and RX sides should be kept pretty much lock-step.
- *
- * Write the last byte _NOINC so that if we don't get more data in time, we aren't leaking unknown data
- * (See HFC datasheet)
- */
-
-		hfc_setreg_waitbusy(b4, R_FIFO, (fifo << V_FIFO_NUM_SHIFT) | V_REV);
-
-		b4xxp_setreg32(b4, A_FIFO_DATA2, *(unsigned int *) &chan->writechunk[0]);
-		b4xxp_setreg32(b4, A_FIFO_DATA2, *(unsigned int *) &chan->writechunk[4]);
-		ret = 1;
-	}
-
-	spin_unlock_irqrestore(&b4->fifolock, irq_flags);
-	return ret;
-}
-
-/*
- * Run through all of the host-facing B-channel RX FIFOs, looking for at least 8 bytes available.
- * If a B channel RX fifo has enough data, perform the data transfer in both directions.
- * D channel is done in an interrupt handler.
- * The S/T port state must be active or we ignore the fifo.
- * Returns nonzero if there was at least DAHDI_CHUNKSIZE bytes in the FIFO
- */
-static int hfc_poll_fifos(struct b4xxp *b4)
-{
-	int ret=0, span;
-	unsigned long irq_flags;
-
-	for (span=0; span < b4->numspans; span++) {
-
-/* Make sure DAHDI's got this span up */
-		if (!(b4->spans[span].span.flags & DAHDI_FLAG_RUNNING))
-			continue;
-
-/* TODO: Make sure S/T port is in active state */
-#if 0
-		if (span_not_active(s))
-			continue;
-#endif
-		ret = hfc_poll_one_bchan_fifo(&b4->spans[span], 0);
-		ret |= hfc_poll_one_bchan_fifo(&b4->spans[span], 1);
-	}
-
-/* change the active FIFO one last time to make sure the last-changed FIFO updates its pointers (as per the datasheet) */
-	spin_lock_irqsave(&b4->fifolock, irq_flags);
-	hfc_setreg_waitbusy(b4, R_FIFO, (31 << V_FIFO_NUM_SHIFT));
-	spin_unlock_irqrestore(&b4->fifolock, irq_flags);
-
-	return ret;
-}
-
 /* NOTE: assumes fifo lock is held */
 static inline void debug_fz(struct b4xxp *b4, int fifo, const char *prefix, char *buf)
 {
@@ -1952,6 +1806,7 @@ static int hdlc_tx_frame(struct b4xxp_span *bspan)
 static void b4xxp_init_stage1(struct b4xxp *b4)
 {
 	int i;
+	unsigned long irq_flags;
 
 	hfc_reset(b4);				/* total reset of controller */
 	hfc_gpio_init(b4);			/* initialize controller GPIO for CPLD access */
@@ -1962,11 +1817,13 @@ static void b4xxp_init_stage1(struct b4xxp *b4)
 
 /* disable all FIFO interrupts */
 	for (i=0; i < HFC_NR_FIFOS; i++) {
+		spin_lock_irqsave(&b4->fifolock, irq_flags);
 		hfc_setreg_waitbusy(b4, R_FIFO, (i << V_FIFO_NUM_SHIFT));
 		b4xxp_setreg8(b4, A_IRQ_MSK, 0x00);	/* disable the interrupt */
 		hfc_setreg_waitbusy(b4, R_FIFO, (i << V_FIFO_NUM_SHIFT) | V_FIFO_DIR);
 		b4xxp_setreg8(b4, A_IRQ_MSK, 0x00);	/* disable the interrupt */
 		flush_pci();
+		spin_unlock_irqrestore(&b4->fifolock, irq_flags);
 	}
 
 /* clear any pending FIFO interrupts */
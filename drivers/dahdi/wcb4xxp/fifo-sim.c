@@ -0,0 +1,436 @@
+/*
+ * Run the wcb4xxp FIFO polling code against a model of the HFC registers
+ *
+ * Copyright (C) 2026, DAHDI Linux contributors
+ * All rights reserved.
+ *
+ */
+
+/*
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ */
+
+/*
+  NOTE: This is a userspace program, it is not part of any module.
+  It includes fifo.c, with the real struct b4xxp from wcb4xxp.h, and
+  provides the register accessors from a model of the HFC-4S FIFOs:
+
+  - R_FIFO selects a FIFO and leaves the HFC busy for a random number of
+    R_STATUS reads. Any other access while busy is an error.
+  - The host side Z counter of a FIFO only moves on to the HFC once
+    another FIFO is selected.
+  - Every register access must hold the fifolock.
+
+  Each tick the HFC puts DAHDI_CHUNKSIZE bytes of a per-channel sequence
+  in each RX FIFO of a running span and takes as much from its TX FIFO.
+  hfc_poll_fifos() must move the bytes in order to and from the right
+  channels, and the busywait counters must match the busy replies the
+  model gave. From this directory:
+
+    cc -O2 -Wall -I../../../include -o fifo-sim fifo-sim.c
+    ./fifo-sim [ticks]
+
+  The exit status is non-zero on any mismatch.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Just enough of the kernel for the struct b4xxp and fifo.c */
+#define __KERNEL__
+#define __iomem
+#define HZ		250
+#define likely(x)	(x)
+#define unlikely(x)	(x)
+#define mb()		__asm__ __volatile__("" : : : "memory")
+#define time_after(a, b)	((long)((b) - (a)) < 0)
+#define printk_ratelimit()	1
+#define DAHDI_CHUNKSIZE		8
+#define DAHDI_FLAG_RUNNING	(1 << 4)
+
+typedef struct { int held; } spinlock_t;
+typedef struct { int counter; } atomic_t;
+struct pci_dev { int dev; };
+struct tasklet_struct { int unused; };
+struct dahdi_echocan_state { int unused; };
+struct dahdi_span { int flags; };
+struct dahdi_chan {
+	unsigned char *readchunk;
+	unsigned char *writechunk;
+	unsigned char sreadchunk[DAHDI_CHUNKSIZE];
+	unsigned char swritechunk[DAHDI_CHUNKSIZE];
+};
+
+#define spin_lock_irqsave(l, f)	do { (f) = 0; (l)->held++; } while (0)
+#define spin_unlock_irqrestore(l, f)	do { (void)(f); (l)->held--; } while (0)
+
+static int warnings;
+#define dev_warn(dev, fmt, ...) \
+	do { warnings++; fprintf(stderr, "warning: " fmt, ##__VA_ARGS__); } \
+	while (0)
+
+#include "wcb4xxp.h"
+
+static unsigned long jiffies;
+
+/* The model */
+#define ZSIZE		(HFC_ZMAX - HFC_ZMIN + 1)
+#define NSPANS		4
+
+struct sim_fifo {
+	int z1, z2;		/* as the host reads them */
+	int pending;		/* host side bytes not committed yet */
+	int moved;		/* host side bytes this tick */
+	unsigned char data[ZSIZE];
+};
+
+static struct {
+	struct b4xxp *b4;
+	struct sim_fifo fifo[HFC_NR_FIFOS][2];	/* [n][V_FIFO_DIR] */
+	int sel, dir;
+	int busy_left;
+	int max_busy;
+	int stuck;		/* expect accesses while busy */
+	int errors;
+	/* statistics */
+	unsigned long accesses;
+	unsigned long status_reads;
+	unsigned long busy_replies;
+} hfc;
+
+static void sim_error(const char *what, unsigned int reg)
+{
+	if (hfc.errors++ < 10)
+		printf("error: %s (reg 0x%02x, fifo %d/%d)\n", what, reg,
+		       hfc.sel, hfc.dir);
+}
+
+static void sim_access(unsigned int reg)
+{
+	hfc.accesses++;
+	if (!hfc.b4->fifolock.held)
+		sim_error("access without the fifolock", reg);
+	if (reg != R_STATUS && hfc.busy_left && !hfc.stuck)
+		sim_error("access while the HFC is busy", reg);
+}
+
+static int zlen(const struct sim_fifo *f)
+{
+	int len = f->z1 - f->z2;
+
+	return (len < 0) ? len + ZSIZE : len;
+}
+
+static int znext(int z, int n)
+{
+	z += n;
+	if (z > HFC_ZMAX)
+		z -= ZSIZE;
+	return z;
+}
+
+/* the HFC side of a FIFO, RX: it fills, TX: it drains */
+static void hfc_push(struct sim_fifo *f, unsigned char c)
+{
+	f->data[f->z1 - HFC_ZMIN] = c;
+	f->z1 = znext(f->z1, 1);
+}
+
+static unsigned char hfc_pop(struct sim_fifo *f)
+{
+	unsigned char c = f->data[f->z2 - HFC_ZMIN];
+
+	f->z2 = znext(f->z2, 1);
+	return c;
+}
+
+static void commit_selected(void)
+{
+	struct sim_fifo *f = &hfc.fifo[hfc.sel][hfc.dir];
+
+	if (hfc.dir)
+		f->z2 = znext(f->z2, f->pending);
+	else
+		f->z1 = znext(f->z1, f->pending);
+	f->pending = 0;
+}
+
+static inline unsigned char b4xxp_getreg8(struct b4xxp *b4,
+					  const unsigned int reg)
+{
+	sim_access(reg);
+	if (reg != R_STATUS) {
+		sim_error("unexpected 8-bit read", reg);
+		return 0;
+	}
+	hfc.status_reads++;
+	if (!(hfc.status_reads % 64))
+		jiffies++;
+	if (hfc.busy_left) {
+		hfc.busy_left--;
+		hfc.busy_replies++;
+		return V_BUSY;
+	}
+	return 0;
+}
+
+static inline void b4xxp_setreg8(struct b4xxp *b4, unsigned int reg,
+				 unsigned char val)
+{
+	sim_access(reg);
+	if (reg != R_FIFO) {
+		sim_error("unexpected 8-bit write", reg);
+		return;
+	}
+	commit_selected();
+	hfc.sel = (val >> V_FIFO_NUM_SHIFT) & (HFC_NR_FIFOS - 1);
+	hfc.dir = val & V_FIFO_DIR;
+	hfc.busy_left = (hfc.max_busy) ? rand() % (hfc.max_busy + 1) : 0;
+}
+
+static inline unsigned short b4xxp_getreg16(struct b4xxp *b4,
+					    const unsigned int reg)
+{
+	const struct sim_fifo *f = &hfc.fifo[hfc.sel][hfc.dir];
+
+	sim_access(reg);
+	if (reg == A_Z1)
+		return f->z1;
+	if (reg == A_Z2)
+		return f->z2;
+	sim_error("unexpected 16-bit read", reg);
+	return 0;
+}
+
+static inline unsigned int b4xxp_getreg32(struct b4xxp *b4,
+					  const unsigned int reg)
+{
+	struct sim_fifo *f = &hfc.fifo[hfc.sel][hfc.dir];
+	unsigned int val = 0;
+	int i, z;
+
+	sim_access(reg);
+	if (reg != A_FIFO_DATA2 || !hfc.dir) {
+		sim_error("unexpected 32-bit read", reg);
+		return 0;
+	}
+	if (zlen(f) - f->pending < 4)
+		sim_error("read past the end of an RX FIFO", reg);
+	z = znext(f->z2, f->pending);
+	for (i = 0; i < 4; i++) {
+		val |= f->data[z - HFC_ZMIN] << (8 * i);
+		z = znext(z, 1);
+	}
+	f->pending += 4;
+	f->moved += 4;
+	return val;
+}
+
+static inline void b4xxp_setreg32(struct b4xxp *b4, unsigned int reg,
+				  unsigned int val)
+{
+	struct sim_fifo *f = &hfc.fifo[hfc.sel][hfc.dir];
+	int i, z;
+
+	sim_access(reg);
+	if (reg != A_FIFO_DATA2 || hfc.dir) {
+		sim_error("unexpected 32-bit write", reg);
+		return;
+	}
+	if (ZSIZE - 1 - zlen(f) - f->pending < 4)
+		sim_error("write past the end of a TX FIFO", reg);
+	z = znext(f->z1, f->pending);
+	for (i = 0; i < 4; i++) {
+		f->data[z - HFC_ZMIN] = val >> (8 * i);
+		z = znext(z, 1);
+	}
+	f->pending += 4;
+	f->moved += 4;
+}
+
+#include "fifo.c"
+
+static struct b4xxp card;
+static struct pci_dev pdev;
+
+/* per B channel byte sequences: what the HFC sends, what the host sends */
+static unsigned char rx_seq[NSPANS][2], rx_expect[NSPANS][2];
+static unsigned char tx_seq[NSPANS][2], tx_expect[NSPANS][2];
+
+static void setup(void)
+{
+	unsigned long irq_flags;
+	int s, c, i;
+
+	memset(&hfc, 0, sizeof(hfc));
+	memset(&card, 0, sizeof(card));
+	hfc.b4 = &card;
+	card.pdev = &pdev;
+	card.numspans = NSPANS;
+	for (i = 0; i < HFC_NR_FIFOS; i++) {
+		hfc.fifo[i][0].z1 = hfc.fifo[i][0].z2 = HFC_ZMIN;
+		hfc.fifo[i][1].z1 = hfc.fifo[i][1].z2 = HFC_ZMIN;
+	}
+	for (s = 0; s < NSPANS; s++) {
+		struct b4xxp_span *bspan = &card.spans[s];
+
+		bspan->parent = &card;
+		/* span 2 is not running, its FIFOs must be left alone */
+		bspan->span.flags = (s == 2) ? 0 : DAHDI_FLAG_RUNNING;
+		for (c = 0; c < WCB4XXP_CHANNELS_PER_SPAN; c++) {
+			struct dahdi_chan *chan = &bspan->_chans[c];
+
+			bspan->fifos[c] = s * 4 + c;
+			chan->readchunk = chan->sreadchunk;
+			chan->writechunk = chan->swritechunk;
+			bspan->chans[c] = chan;
+		}
+		for (c = 0; c < 2; c++) {
+			rx_seq[s][c] = rx_expect[s][c] = s * 64 + c * 32;
+			tx_seq[s][c] = tx_expect[s][c] = s * 64 + c * 32 + 16;
+		}
+	}
+	/* like b4xxp_init_stage1(): select every FIFO once */
+	spin_lock_irqsave(&card.fifolock, irq_flags);
+	for (i = 0; i < HFC_NR_FIFOS; i++) {
+		hfc_setreg_waitbusy(&card, R_FIFO, (i << V_FIFO_NUM_SHIFT));
+		hfc_setreg_waitbusy(&card, R_FIFO,
+				    (i << V_FIFO_NUM_SHIFT) | V_FIFO_DIR);
+	}
+	spin_unlock_irqrestore(&card.fifolock, irq_flags);
+}
+
+/* one tick: the HFC moves data, then the driver polls */
+static void tick(int stale_busy)
+{
+	int rx_ready[NSPANS][2];
+	int s, c, i;
+
+	for (s = 0; s < NSPANS; s++) {
+		for (c = 0; c < 2; c++) {
+			struct b4xxp_span *bspan = &card.spans[s];
+			struct dahdi_chan *chan = bspan->chans[c];
+			struct sim_fifo *rx = &hfc.fifo[bspan->fifos[c]][1];
+			struct sim_fifo *tx = &hfc.fifo[bspan->fifos[c]][0];
+			/* a late frame now and then, then two at once */
+			int n = DAHDI_CHUNKSIZE * ((rand() % 50) ? 1 : 2);
+
+			rx->moved = tx->moved = 0;
+			if (bspan->span.flags & DAHDI_FLAG_RUNNING) {
+				for (i = 0; i < n && zlen(rx) < ZSIZE - 1; i++)
+					hfc_push(rx, rx_seq[s][c]++);
+				for (i = 0; i < DAHDI_CHUNKSIZE && zlen(tx);
+				     i++) {
+					if (hfc_pop(tx) != tx_expect[s][c]++)
+						sim_error("TX data out of "
+							  "sequence",
+							  A_FIFO_DATA2);
+				}
+			}
+			rx_ready[s][c] = (zlen(rx) >= DAHDI_CHUNKSIZE);
+			for (i = 0; i < DAHDI_CHUNKSIZE; i++)
+				chan->writechunk[i] = tx_seq[s][c] + i;
+		}
+	}
+
+	/* something else (the D channel) left the HFC busy */
+	if (stale_busy)
+		hfc.busy_left = stale_busy;
+
+	hfc_poll_fifos(&card);
+	if (card.fifolock.held)
+		sim_error("fifolock still held after the poll", R_FIFO);
+
+	for (s = 0; s < NSPANS; s++) {
+		for (c = 0; c < 2; c++) {
+			struct b4xxp_span *bspan = &card.spans[s];
+			struct dahdi_chan *chan = bspan->chans[c];
+			struct sim_fifo *rx = &hfc.fifo[bspan->fifos[c]][1];
+			struct sim_fifo *tx = &hfc.fifo[bspan->fifos[c]][0];
+
+			if (rx->pending || tx->pending)
+				sim_error("FIFO pointers not updated",
+					  R_FIFO);
+			if (!(bspan->span.flags & DAHDI_FLAG_RUNNING)) {
+				if (rx->moved || tx->moved)
+					sim_error("stopped span FIFO touched",
+						  A_FIFO_DATA2);
+				continue;
+			}
+			if (rx->moved != (rx_ready[s][c] ? DAHDI_CHUNKSIZE : 0))
+				sim_error("wrong RX transfer", A_FIFO_DATA2);
+			if (tx->moved != rx->moved)
+				sim_error("TX not in step with RX",
+					  A_FIFO_DATA2);
+			if (!rx->moved)
+				continue;
+			for (i = 0; i < DAHDI_CHUNKSIZE; i++) {
+				if (chan->readchunk[i] != rx_expect[s][c]++)
+					sim_error("RX data out of sequence",
+						  A_FIFO_DATA2);
+			}
+			tx_seq[s][c] += DAHDI_CHUNKSIZE;
+		}
+	}
+}
+
+static int run(const char *name, unsigned long ticks, int max_busy,
+	       int stale_busy, int stuck)
+{
+	unsigned long n;
+	unsigned long polls_before;
+
+	setup();
+	hfc.max_busy = max_busy;
+	hfc.stuck = stuck;
+	polls_before = hfc.busy_replies;
+	card.busywait_count = card.busywait_polls = card.busywait_max = 0;
+	hfc.accesses = hfc.status_reads = 0;
+	warnings = 0;
+	for (n = 0; n < ticks; n++)
+		tick(stale_busy);
+	if (!hfc.stuck &&
+	    card.busywait_polls != hfc.busy_replies - polls_before)
+		sim_error("busywait_polls does not match the model",
+			  R_STATUS);
+	printf("%-22s %6.1f accesses %5.1f R_STATUS reads per tick, "
+	       "busywait %lu %lu %u, %d warnings\n", name,
+	       (double)hfc.accesses / ticks,
+	       (double)hfc.status_reads / ticks, card.busywait_count,
+	       card.busywait_polls, card.busywait_max, warnings);
+	return hfc.errors;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long ticks = 100000;
+	int res = 0;
+
+	if (argc > 1)
+		ticks = strtoul(argv[1], NULL, 0);
+	if (!ticks)
+		ticks = 1;
+
+	srand(1);
+	res |= run("never busy", ticks, 0, 0, 0);
+	res |= run("busy after select", ticks, 3, 0, 0);
+	res |= run("left busy by others", ticks, 3, 5, 0);
+	/* hfc_wait_notbusy() must time out and warn, not hang */
+	run("stuck busy", 2, 0, HZ * 64, 1);
+	if (!warnings) {
+		printf("error: no warning for a stuck HFC\n");
+		res = 1;
+	}
+	printf("%s\n", res ? "FAILED" : "OK");
+	return res ? 1 : 0;
+}
@@ -0,0 +1,241 @@
+/*
+ * WCB410P  Quad-BRI PCI Driver
+ * HFC FIFO selection and B-channel FIFO polling, split out of base.c
+ * Written by Andrew Kohlsmith <akohlsmith@mixdown.ca>
+ *
+ * Copyright (C) 2009-2012 Digium, Inc.
+ * All rights reserved.
+ *
+ */
+
+/*
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ */
+
+/*
+ * This file is not built on its own. base.c includes it after the
+ * register accessors, and fifo-sim.c includes it to run the same code
+ * against a register-level model of the HFC.
+ */
+
+/*
+ * Spins until the HFC "busy" bit clears. Returns the number of extra
+ * R_STATUS polls it took, or -1 on timeout.
+ * Must be called with the fifolock held: it also serializes the busywait
+ * counters against b4_fifo_busywait_store().
+ */
+static int hfc_wait_notbusy(struct b4xxp *b4)
+{
+	int polls = 0;
+	unsigned long start;
+	const int TIMEOUT = HZ/4; /* 250ms */
+
+	start = jiffies;
+	while (unlikely((b4xxp_getreg8(b4, R_STATUS) & V_BUSY))) {
+		if (time_after(jiffies, start + TIMEOUT))
+			return -1;
+		polls++;
+	};
+
+	if (polls) {
+		b4->busywait_count++;
+		b4->busywait_polls += polls;
+		if (polls > b4->busywait_max)
+			b4->busywait_max = polls;
+	}
+	return polls;
+}
+
+/*
+ * performs a register write and then waits for the HFC "busy" bit to clear.
+ * If the caller knows the HFC is not busy (its last access was one of
+ * these, under the same lock) it may skip the wait before the write.
+ */
+static void __hfc_setreg_waitbusy(struct b4xxp *b4, const unsigned int reg,
+				  const unsigned int val, int prewait)
+{
+	int timeout = 0;
+
+	if (prewait && hfc_wait_notbusy(b4) < 0)
+		timeout = 1;
+
+	mb();
+	b4xxp_setreg8(b4, reg, val);
+	mb();
+
+	if (hfc_wait_notbusy(b4) < 0)
+		timeout = 1;
+
+	if (timeout && printk_ratelimit()) {
+		dev_warn(&b4->pdev->dev,
+			 "hfc_setreg_waitbusy(write 0x%02x to 0x%02x) timed "
+			 "out waiting for busy flag to clear!\n", val, reg);
+	}
+}
+
+static void hfc_setreg_waitbusy(struct b4xxp *b4, const unsigned int reg, const unsigned int val)
+{
+	__hfc_setreg_waitbusy(b4, reg, val, 1);
+}
+
+/*
+ * reads an 8-bit register over over and over until the same value is read twice, then returns that value.
+ */
+static inline unsigned char hfc_readcounter8(struct b4xxp *b4, const unsigned int reg)
+{
+	unsigned char r1, r2;
+	unsigned long maxwait = 1048576;
+
+	do {
+		r1 = b4xxp_getreg8(b4, reg);
+		r2 = b4xxp_getreg8(b4, reg);
+	} while ((r1 != r2) && maxwait--);
+
+	if (!maxwait && printk_ratelimit()) {
+		dev_warn(&b4->pdev->dev,
+			 "hfc_readcounter8(reg 0x%02x) timed out waiting "
+			 "for data to settle!\n", reg);
+	}
+
+	return r1;
+}
+
+/*
+ * reads a 16-bit register over over and over until the same value is read twice, then returns that value.
+ */
+static inline unsigned short hfc_readcounter16(struct b4xxp *b4, const unsigned int reg)
+{
+	unsigned short r1, r2;
+	unsigned long maxwait = 1048576;
+
+	do {
+		r1 = b4xxp_getreg16(b4, reg);
+		r2 = b4xxp_getreg16(b4, reg);
+	} while ((r1 != r2) && maxwait--);
+
+	if (!maxwait && printk_ratelimit()) {
+		dev_warn(&b4->pdev->dev,
+			 "hfc_readcounter16(reg 0x%02x) timed out waiting "
+			 "for data to settle!\n", reg);
+	}
+
+	return r1;
+}
+
+static inline unsigned int hfc_readcounter32(struct b4xxp *b4, const unsigned int reg)
+{
+	unsigned int r1, r2;
+	unsigned long maxwait = 1048576;
+
+	do {
+		r1 = b4xxp_getreg32(b4, reg);
+		r2 = b4xxp_getreg32(b4, reg);
+	} while ((r1 != r2) && maxwait--);
+
+	if (!maxwait && printk_ratelimit()) {
+		dev_warn(&b4->pdev->dev,
+			 "hfc_readcounter32(reg 0x%02x) timed out waiting "
+			 "for data to settle!\n", reg);
+	}
+
+	return r1;
+}
+
+/*
+ * Look at one B-channel FIFO and determine if we should exchange data with it.
+ * It is assumed that the S/T port is active.
+ * Called with the fifolock held, after a hfc_wait_notbusy(), so the HFC is
+ * known not to be busy and the FIFO selects skip the wait before the write.
+ * returns 1 if data was exchanged, 0 otherwise.
+ */
+static int hfc_poll_one_bchan_fifo(struct b4xxp_span *span, int c)
+{
+	int fifo, zlen, z1, z2, ret;
+	struct b4xxp *b4;
+	struct dahdi_chan *chan;
+
+	ret = 0;
+	b4 = span->parent;
+	fifo = span->fifos[c];
+	chan = span->chans[c];
+
+/* select RX FIFO */
+	__hfc_setreg_waitbusy(b4, R_FIFO, (fifo << V_FIFO_NUM_SHIFT) | V_FIFO_DIR | V_REV, 0);
+
+	get_Z(z1, z2, zlen);
+
+/* TODO: error checking, full FIFO mostly */
+
+	if (zlen >= DAHDI_CHUNKSIZE) {
+		*(unsigned int *)&chan->readchunk[0] = b4xxp_getreg32(b4, A_FIFO_DATA2);
+		*(unsigned int *)&chan->readchunk[4] = b4xxp_getreg32(b4, A_FIFO_DATA2);
+/*
+ * now TX FIFO
+ *
+ * Note that we won't write to the TX FIFO if there wasn't room in the RX FIFO.
+ * The TX and RX sides should be kept pretty much lock-step.
+ *
+ * Write the last byte _NOINC so that if we don't get more data in time, we aren't leaking unknown data
+ * (See HFC datasheet)
+ */
+
+		__hfc_setreg_waitbusy(b4, R_FIFO, (fifo << V_FIFO_NUM_SHIFT) | V_REV, 0);
+
+		b4xxp_setreg32(b4, A_FIFO_DATA2, *(unsigned int *) &chan->writechunk[0]);
+		b4xxp_setreg32(b4, A_FIFO_DATA2, *(unsigned int *) &chan->writechunk[4]);
+		ret = 1;
+	}
+
+	return ret;
+}
+
+/*
+ * Run through all of the host-facing B-channel RX FIFOs, looking for at least 8 bytes available.
+ * If a B channel RX fifo has enough data, perform the data transfer in both directions.
+ * D channel is done in an interrupt handler.
+ * The S/T port state must be active or we ignore the fifo.
+ * All the FIFOs are done in one pass under the fifolock.
+ * Returns nonzero if there was at least DAHDI_CHUNKSIZE bytes in the FIFO
+ */
+static int hfc_poll_fifos(struct b4xxp *b4)
+{
+	int ret=0, span;
+	unsigned long irq_flags;
+
+	spin_lock_irqsave(&b4->fifolock, irq_flags);
+
+/* make sure nothing else left the HFC busy before the first FIFO select */
+	if (hfc_wait_notbusy(b4) < 0 && printk_ratelimit())
+		dev_warn(&b4->pdev->dev, "HFC still busy before FIFO poll\n");
+
+	for (span=0; span < b4->numspans; span++) {
+
+/* Make sure DAHDI's got this span up */
+		if (!(b4->spans[span].span.flags & DAHDI_FLAG_RUNNING))
+			continue;
+
+/* TODO: Make sure S/T port is in active state */
+#if 0
+		if (span_not_active(s))
+			continue;
+#endif
+		ret = hfc_poll_one_bchan_fifo(&b4->spans[span], 0);
+		ret |= hfc_poll_one_bchan_fifo(&b4->spans[span], 1);
+	}
+
+/* change the active FIFO one last time to make sure the last-changed FIFO updates its pointers (as per the datasheet) */
+	__hfc_setreg_waitbusy(b4, R_FIFO, (31 << V_FIFO_NUM_SHIFT), 0);
+	spin_unlock_irqrestore(&b4->fifolock, irq_flags);
+
+	return ret;
+}
+
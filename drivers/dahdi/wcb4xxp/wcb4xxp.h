@@ -443,6 +443,11 @@ struct b4xxp {
 	spinlock_t seqlock;			/* lock for "sequence" accesses that must be ordered */
 	spinlock_t fifolock;			/* lock for all FIFO accesses (reglock must be available) */
 
+	/* HFC busy-wait statistics (fifolock), see the fifo_busywait attribute */
+	unsigned long busywait_count;		/* waits that found the HFC busy */
+	unsigned long busywait_polls;		/* total R_STATUS polls while busy */
+	unsigned int busywait_max;		/* most polls in one wait */
+
 	volatile unsigned long ticks;
 
 	unsigned long fifo_en_rxint;		/* each bit is the RX int enable for that FIFO */
@@ -38,6 +38,7 @@
 #include <asm/io.h>
 #include <linux/version.h>
 #include <linux/delay.h>
+#include <linux/completion.h>
 #include <linux/moduleparam.h>
 #include <linux/crc32.h>
 
@@ -67,6 +68,19 @@
 /* Define to support Digium Voice Processing Module expansion card */
 #define VPM_SUPPORT
 
+#if defined(VPM_SUPPORT) && \
+	(LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 30))
+/* The async_vpm_init module parameter brings up the VPM450M on each board in
+ * parallel. Loading the firmware and opening the chip take seconds per board,
+ * so with several cards installed this is most of the module load time, but
+ * it also makes it impossible to abort module loads with ctrl-c, so it is
+ * off by default. */
+#define USE_ASYNC_INIT
+#include <linux/async.h>
+#else
+#undef USE_ASYNC_INIT
+#endif
+
 #define DEBUG_MAIN 		(1 << 0)
 #define DEBUG_DTMF 		(1 << 1)
 #define DEBUG_REGS 		(1 << 2)
@@ -212,6 +226,9 @@ static int latency = 1;
 
 static int ms_per_irq = 1;
 static int ignore_rotary;
+#ifdef USE_ASYNC_INIT
+static int async_vpm_init;
+#endif
 
 #ifdef FANCY_ALARM
 static int altab[] = {
@@ -381,6 +398,7 @@ struct t4 {
 	
 #ifdef VPM_SUPPORT
 	struct vpm450m *vpm;
+	struct completion vpm_done;	/* t4_vpm_init has finished */
 #endif	
 	struct spi_state st;
 };
@@ -421,6 +439,22 @@ static inline unsigned int ports_on_framer(const struct t4 *wc)
 	return (is_octal(wc)) ? 8 : 4;
 }
 
+/**
+ * t4_trace_phase - Report how long a step of bringing up the board took.
+ * @wc:		Board being initialized.
+ * @phase:	Name of the step.
+ * @start:	Value of jiffies when the step started.
+ *
+ */
+static inline void
+t4_trace_phase(const struct t4 *wc, const char *phase, unsigned long start)
+{
+	if (debug & DEBUG_MAIN) {
+		dev_info(&wc->dev->dev, "%s took %u ms\n", phase,
+			 jiffies_to_msecs(jiffies - start));
+	}
+}
+
 #ifdef VPM_SUPPORT
 static void t4_vpm_init(struct t4 *wc);
 
@@ -1094,6 +1128,54 @@ unsigned int oct_get_reg(void *data, unsigned int reg)
 	return ret;
 }
 
+/*
+ * The upper address registers only need loading once for every 8 words
+ * (one 16 byte line), so runs of consecutive words are written a line at a
+ * time, each under a single hold of the reglock.
+ */
+static void t4_oct_out_line(struct t4 *wc, unsigned int addr,
+			    const u16 *values, size_t count, bool smear)
+{
+	unsigned long flags;
+	size_t i;
+
+	spin_lock_irqsave(&wc->reglock, flags);
+	__t4_raw_oct_out(wc, 0x0008, (addr >> 20));
+	__t4_raw_oct_out(wc, 0x000a, (addr >> 4) & ((1 << 16) - 1));
+	for (i = 0; i < count; ++i, addr += 2) {
+		__t4_raw_oct_out(wc, 0x0004, (smear) ? values[0] : values[i]);
+		__t4_raw_oct_out(wc, 0x0000, (((addr >> 1) & 0x7) << 9) |
+				 (1 << 8) | (3 << 12) | 1);
+	}
+	spin_unlock_irqrestore(&wc->reglock, flags);
+}
+
+static void t4_oct_out_burst(struct t4 *wc, unsigned int addr,
+			     const u16 *values, size_t count, bool smear)
+{
+	size_t len;
+
+	while (count) {
+		len = min_t(size_t, count, 8 - ((addr >> 1) & 0x7));
+		t4_oct_out_line(wc, addr, values, len, smear);
+		if (!smear)
+			values += len;
+		addr += len << 1;
+		count -= len;
+	}
+}
+
+void oct_set_reg_burst(void *data, unsigned int reg, const u16 *values,
+		       size_t count)
+{
+	t4_oct_out_burst(data, reg, values, count, false);
+}
+
+void oct_set_reg_smear(void *data, unsigned int reg, u16 value, size_t count)
+{
+	t4_oct_out_burst(data, reg, &value, count, true);
+}
+
 static const char *__t4_echocan_name(struct t4 *wc)
 {
 	if (wc->vpm) {
@@ -1183,6 +1265,40 @@ static void echocan_free(struct dahdi_chan *chan, struct dahdi_echocan_state *ec
 	}
 	vpm450m_setec(wc->vpm, channel, 0);
 }
+
+/*
+ * Called from the vpm450m worker once an echo canceller requested through
+ * t4_echocan_create() is actually running on the chip. The event is only
+ * queued for channels that asked for it with DAHDI_EC_READY_EVENTS.
+ */
+void t4_vpm_ec_ready(struct t4 *wc, int channel)
+{
+	struct dahdi_chan *chan;
+	int span, chanpos;
+
+	if (is_octal(wc)) {
+		span = channel & 0x7;
+		chanpos = channel >> 3;
+	} else {
+		span = channel & 0x3;
+		chanpos = channel >> 2;
+	}
+	if (!has_e1_span(wc))
+		chanpos -= 4;
+
+	if (span >= wc->numspans || chanpos < 1 ||
+	    chanpos > wc->tspans[span]->span.channels)
+		return;
+
+	chan = wc->tspans[span]->span.chans[chanpos - 1];
+	if (debug & DEBUG_ECHOCAN) {
+		dev_notice(&wc->dev->dev,
+			   "echocan: Channel %d of span %d is ready\n",
+			   chanpos, span + 1);
+	}
+	if (test_bit(DAHDI_FLAGBIT_ECREADY_EVENTS, &chan->flags))
+		dahdi_qevent_lock(chan, DAHDI_EVENT_EC_READY);
+}
 #endif
 
 static int t4_ioctl(struct dahdi_chan *chan, unsigned int cmd, unsigned long data)
@@ -4322,6 +4438,7 @@ static void t4_vpm_init(struct t4 *wc)
 	int laws[8] = { 0, };
 	int x;
 	unsigned int vpm_capacity;
+	unsigned long start;
 	struct firmware embedded_firmware;
 	const struct firmware *firmware = &embedded_firmware;
 #if !defined(HOTPLUG_FIRMWARE)
@@ -4363,7 +4480,9 @@ static void t4_vpm_init(struct t4 *wc)
 			laws[x] = 1;
 	}
 
+	start = jiffies;
 	vpm_capacity = get_vpm450m_capacity(&wc->dev->dev);
+	t4_trace_phase(wc, "VPM450: capacity check", start);
 	if (vpm_capacity != wc->numspans * 32) {
 		dev_info(&wc->dev->dev, "Disabling VPMOCT%03d. TE%dXXP"\
 				" requires a VPMOCT%03d", vpm_capacity,
@@ -4371,6 +4490,7 @@ static void t4_vpm_init(struct t4 *wc)
 		return;
 	}
 
+	start = jiffies;
 	switch (vpm_capacity) {
 	case 64:
 #if defined(HOTPLUG_FIRMWARE)
@@ -4435,7 +4555,11 @@ static void t4_vpm_init(struct t4 *wc)
 		return;
 	}
 
+	t4_trace_phase(wc, "VPM450: firmware load", start);
+
+	start = jiffies;
 	wc->vpm = init_vpm450m(&wc->dev->dev, laws, wc->numspans, firmware);
+	t4_trace_phase(wc, "VPM450: chip open", start);
 	if (!wc->vpm) {
 		dev_notice(&wc->dev->dev, "VPM450: Failed to initialize\n");
 		if (firmware != &embedded_firmware)
@@ -4455,6 +4579,27 @@ static void t4_vpm_init(struct t4 *wc)
 			"span(s)\n", wc->numspans);
 		
 }
+
+/**
+ * t4_vpm_start - Bring up the VPM450M during probe.
+ * @wc:		Board being probed.
+ *
+ * Completes wc->vpm_done when finished, which t4_launch waits on before the
+ * spans are handed to DAHDI.
+ *
+ */
+static void t4_vpm_start(struct t4 *wc)
+{
+	const unsigned long start = jiffies;
+
+	t4_vpm_init(wc);
+	wc->dmactrl |= (wc->vpm) ? T4_VPM_PRESENT : 0;
+	t4_pci_out(wc, WC_DMACTRL, wc->dmactrl);
+	if (wc->vpm)
+		set_span_devicetype(wc);
+	t4_trace_phase(wc, "VPM450: initialization", start);
+	complete_all(&wc->vpm_done);
+}
 #endif /* VPM_SUPPORT */
 
 static void t4_tsi_reset(struct t4 *wc) 
@@ -5123,6 +5268,16 @@ static int __devinit t4_launch(struct t4 *wc)
 	if (test_bit(DAHDI_FLAGBIT_REGISTERED, &wc->tspans[0]->span.flags))
 		return 0;
 
+#ifdef VPM_SUPPORT
+	/* The echo canceller has to be settled before the spans can be
+	 * assigned. */
+	if (!try_wait_for_completion(&wc->vpm_done)) {
+		const unsigned long start = jiffies;
+		wait_for_completion(&wc->vpm_done);
+		t4_trace_phase(wc, "Waiting for VPM450", start);
+	}
+#endif
+
 	if (debug) {
 		dev_info(&wc->dev->dev,
 			 "TE%dXXP: Launching card: %d\n", wc->numspans,
@@ -5188,6 +5343,23 @@ static void wct4xxp_sort_cards(void)
 	}
 }
 
+#ifdef USE_ASYNC_INIT
+static void t4_release(struct t4 *wc);
+
+static __devinit void t4_init_one_async(void *data, async_cookie_t cookie)
+{
+	struct t4 *wc = data;
+
+	t4_vpm_start(wc);
+	if (ignore_rotary && t4_launch(wc)) {
+		dev_err(&wc->dev->dev, "Failed to launch card.\n");
+		/* The probe has already returned success, so nothing else
+		 * will release the board until the module is unloaded. */
+		t4_release(wc);
+	}
+}
+#endif
+
 static int __devinit
 t4_init_one(struct pci_dev *pdev, const struct pci_device_id *ent)
 {
@@ -5211,6 +5383,9 @@ t4_init_one(struct pci_dev *pdev, const struct pci_device_id *ent)
 	}
 
 	spin_lock_init(&wc->reglock);
+#ifdef VPM_SUPPORT
+	init_completion(&wc->vpm_done);
+#endif
 	wc->devtype = (const struct devtype *)(ent->driver_data);
 
 #ifdef CONFIG_WCT4XXP_DISABLE_ASPM
@@ -5372,18 +5547,20 @@ t4_init_one(struct pci_dev *pdev, const struct pci_device_id *ent)
 			 "Found a Wildcard: %s\n", wc->devtype->desc);
 	}
 
-#ifdef VPM_SUPPORT
-	if (!wc->vpm) {
-		t4_vpm_init(wc);
-		wc->dmactrl |= (wc->vpm) ? T4_VPM_PRESENT : 0;
-		t4_pci_out(wc, WC_DMACTRL, wc->dmactrl);
-		if (wc->vpm)
-			set_span_devicetype(wc);
+	create_sysfs_files(wc);
+
+#ifdef USE_ASYNC_INIT
+	if (async_vpm_init) {
+		/* The rest of the probe runs alongside the other boards. When
+		 * the rotary switches are honored, t4_init launches the cards
+		 * in order once they are all probed. */
+		async_schedule(t4_init_one_async, wc);
+		return 0;
 	}
 #endif
-
-	create_sysfs_files(wc);
-	
+#ifdef VPM_SUPPORT
+	t4_vpm_start(wc);
+#endif
 	res = 0;
 	if (ignore_rotary)
 		res = t4_launch(wc);
@@ -5438,15 +5615,11 @@ t4_init_one_retry(struct pci_dev *pdev, const struct pci_device_id *ent)
 	return res;
 }
 
-static void _t4_remove_one(struct t4 *wc)
+/* Everything but the DAHDI device, which may not have been registered. */
+static void t4_release(struct t4 *wc)
 {
 	int basesize;
 
-	if (!wc)
-		return;
-
-	dahdi_unregister_device(wc->ddev);
-
 	remove_sysfs_files(wc);
 
 	/* Stop hardware */
@@ -5489,9 +5662,26 @@ static void _t4_remove_one(struct t4 *wc)
 	free_wc(wc);
 }
 
+static void _t4_remove_one(struct t4 *wc)
+{
+	if (!wc)
+		return;
+
+	dahdi_unregister_device(wc->ddev);
+	t4_release(wc);
+}
+
 static void __devexit t4_remove_one(struct pci_dev *pdev)
 {
-	struct t4 *wc = pci_get_drvdata(pdev);
+	struct t4 *wc;
+
+#ifdef USE_ASYNC_INIT
+	/* Don't pull the board out from under its own async probe, which
+	 * may also have released it already. */
+	if (async_vpm_init)
+		async_synchronize_full();
+#endif
+	wc = pci_get_drvdata(pdev);
 	if (!wc)
 		return;
 
@@ -5562,6 +5752,13 @@ static int __init t4_init(void)
 	if (res)
 		return -ENODEV;
 
+#ifdef USE_ASYNC_INIT
+	/* With ignore_rotary the boards launch themselves from their async
+	 * probe, and they should all be up by the time the module is. */
+	if (async_vpm_init && ignore_rotary)
+		async_synchronize_full();
+#endif
+
 	/* If we're ignoring the rotary switch settings, then we've already
 	 * registered in the context of .probe */
 	if (!ignore_rotary) {
@@ -5624,6 +5821,11 @@ module_param(ms_per_irq, int, 0600);
 module_param(ignore_rotary, int, 0400);
 MODULE_PARM_DESC(ignore_rotary, "Set to > 0 to ignore the rotary switch when " \
 		 "registering with DAHDI.");
+#ifdef USE_ASYNC_INIT
+module_param(async_vpm_init, int, 0400);
+MODULE_PARM_DESC(async_vpm_init, "Set to 1 to bring up the VPM450M on all "
+		 "boards in parallel. Module loads can then not be aborted.");
+#endif
 
 #ifdef VPM_SUPPORT
 module_param(vpmsupport, int, 0600);
@@ -26,6 +26,8 @@
 #include <linux/string.h>
 #include <linux/time.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
 
 #include <dahdi/kernel.h>
 #include <stdbool.h>
@@ -53,9 +55,7 @@ static int wct4xxp_oct612x_write_smear(struct oct612x_context *context,
 				       u32 address, u16 value, size_t count)
 {
 	struct t4 *wc = dev_get_drvdata(context->dev);
-	int i;
-	for (i = 0; i < count; ++i)
-		oct_set_reg(wc, address + (i << 1), value);
+	oct_set_reg_smear(wc, address, value, count);
 	return 0;
 }
 
@@ -64,9 +64,7 @@ static int wct4xxp_oct612x_write_burst(struct oct612x_context *context,
 				       size_t count)
 {
 	struct t4 *wc = dev_get_drvdata(context->dev);
-	int i;
-	for (i = 0; i < count; ++i)
-		oct_set_reg(wc, address + (i << 1), buffer[i]);
+	oct_set_reg_burst(wc, address, buffer, count);
 	return 0;
 }
 
@@ -141,6 +139,19 @@ struct vpm450m {
 	int chanflags[256];
 	int ecmode[256];
 	int numchans;
+
+	/*
+	 * Channel configuration requested by the driver but not yet applied
+	 * to the chip. want[] holds the FLAG_* state each channel should end
+	 * up in and pending[] which parts of it still need a ChannelModify.
+	 * Later requests overwrite earlier ones, so a burst of enables and
+	 * disables on one channel costs only the final change.
+	 */
+	spinlock_t pending_lock;
+	unsigned char pending[256];
+	unsigned char want[256];
+	struct work_struct work;
+	struct mutex apply_lock;
 };
 
 #define FLAG_DTMF	 (1 << 0)
@@ -148,6 +159,11 @@ struct vpm450m {
 #define FLAG_ECHO	 (1 << 2)
 #define FLAG_ALAW	 (1 << 3)
 
+#define PENDING_LAW	 (1 << 0)
+#define PENDING_DTMF	 (1 << 1)
+#define PENDING_ECHO	 (1 << 2)
+#define PENDING_NOTIFY	 (1 << 3)
+
 static unsigned int tones[] = {
 	SOUT_DTMF_1,
 	SOUT_DTMF_2,
@@ -186,23 +202,19 @@ static unsigned int tones[] = {
 	ROUT_G168_1100GB_ON,
 };
 
-void vpm450m_set_alaw_companding(struct vpm450m *vpm450m, int channel,
-					bool alaw)
+static void __vpm450m_set_alaw_companding(struct vpm450m *vpm450m,
+					  int channel, bool alaw)
 {
 	tOCT6100_CHANNEL_MODIFY *modify;
 	UINT32 ulResult;
 	UINT32		law_to_use = (alaw) ? cOCT6100_PCM_A_LAW :
 					      cOCT6100_PCM_U_LAW;
 
-	if (channel >= ARRAY_SIZE(vpm450m->chanflags)) {
-		pr_err("Channel out of bounds in %s\n", __func__);
-		return;
-	}
 	/* If we're already in this companding mode, no need to do anything. */
 	if (alaw == ((vpm450m->chanflags[channel] & FLAG_ALAW) > 0))
 		return;
 
-	modify = kzalloc(sizeof(tOCT6100_CHANNEL_MODIFY), GFP_ATOMIC);
+	modify = kzalloc(sizeof(tOCT6100_CHANNEL_MODIFY), GFP_KERNEL);
 	if (!modify) {
 		pr_notice("Unable to allocate memory for setec!\n");
 		return;
@@ -239,7 +251,7 @@ static void vpm450m_setecmode(struct vpm450m *vpm450m, int channel, int mode)
 
 	if (vpm450m->ecmode[channel] == mode)
 		return;
-	modify = kmalloc(sizeof(tOCT6100_CHANNEL_MODIFY), GFP_ATOMIC);
+	modify = kmalloc(sizeof(tOCT6100_CHANNEL_MODIFY), GFP_KERNEL);
 	if (!modify) {
 		printk(KERN_NOTICE "wct4xxp: Unable to allocate memory for setec!\n");
 		return;
@@ -259,16 +271,12 @@ static void vpm450m_setecmode(struct vpm450m *vpm450m, int channel, int mode)
 	kfree(modify);
 }
 
-void vpm450m_setdtmf(struct vpm450m *vpm450m, int channel, int detect, int mute)
+static void __vpm450m_setdtmf(struct vpm450m *vpm450m, int channel,
+			      int detect, int mute)
 {
 	tOCT6100_CHANNEL_MODIFY *modify;
 	UINT32 ulResult;
 
-	if (channel >= ARRAY_SIZE(vpm450m->chanflags)) {
-		pr_err("Channel out of bounds in %s\n", __func__);
-		return;
-	}
-
 	modify = kmalloc(sizeof(tOCT6100_CHANNEL_MODIFY), GFP_KERNEL);
 	if (!modify) {
 		printk(KERN_NOTICE "wct4xxp: Unable to allocate memory for setdtmf!\n");
@@ -305,13 +313,8 @@ void vpm450m_setdtmf(struct vpm450m *vpm450m, int channel, int detect, int mute)
 	kfree(modify);
 }
 
-void vpm450m_setec(struct vpm450m *vpm450m, int channel, int eclen)
+static void __vpm450m_setec(struct vpm450m *vpm450m, int channel, int eclen)
 {
-	if (channel >= ARRAY_SIZE(vpm450m->chanflags)) {
-		pr_err("Channel out of bounds in %s\n", __func__);
-		return;
-	}
-
 	if (eclen) {
 		vpm450m->chanflags[channel] |= FLAG_ECHO;
 		vpm450m_setecmode(vpm450m, channel, cOCT6100_ECHO_OP_MODE_HT_RESET);
@@ -327,6 +330,136 @@ void vpm450m_setec(struct vpm450m *vpm450m, int channel, int eclen)
 /*	printk(KERN_DEBUG "VPM450m: Setting EC on channel %d to %d\n", channel, eclen); */
 }
 
+/*
+ * Each ChannelModify is a long run of register accesses over the indirect
+ * bus, and call setup can ask for dozens of them back to back from the
+ * channel ioctls. Queue the requests here and let a worker apply them.
+ */
+static void vpm450m_apply_pending(struct vpm450m *vpm450m)
+{
+	unsigned long flags;
+	unsigned char pending, want;
+	bool again;
+	int x;
+
+	mutex_lock(&vpm450m->apply_lock);
+	oct612x_begin_batch(&vpm450m->context);
+	do {
+		again = false;
+		for (x = 0; x < ARRAY_SIZE(vpm450m->pending); x++) {
+			spin_lock_irqsave(&vpm450m->pending_lock, flags);
+			pending = vpm450m->pending[x];
+			want = vpm450m->want[x];
+			vpm450m->pending[x] = 0;
+			spin_unlock_irqrestore(&vpm450m->pending_lock, flags);
+
+			if (!pending)
+				continue;
+			again = true;
+
+			if (pending & PENDING_LAW) {
+				__vpm450m_set_alaw_companding(vpm450m, x,
+							      want & FLAG_ALAW);
+			}
+			if (pending & PENDING_ECHO) {
+				__vpm450m_setec(vpm450m, x,
+						want & FLAG_ECHO);
+			}
+			if (pending & PENDING_DTMF) {
+				__vpm450m_setdtmf(vpm450m, x, want & FLAG_DTMF,
+						  want & FLAG_MUTE);
+			}
+			if (pending & PENDING_NOTIFY) {
+				t4_vpm_ec_ready(dev_get_drvdata(
+						vpm450m->context.dev), x);
+			}
+		}
+	} while (again);
+	oct612x_end_batch(&vpm450m->context);
+	mutex_unlock(&vpm450m->apply_lock);
+}
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 20)
+static void vpm450m_work_fn(void *data)
+{
+	struct vpm450m *vpm450m = data;
+#else
+static void vpm450m_work_fn(struct work_struct *work)
+{
+	struct vpm450m *vpm450m = container_of(work, struct vpm450m, work);
+#endif
+	vpm450m_apply_pending(vpm450m);
+}
+
+static void vpm450m_queue(struct vpm450m *vpm450m, int channel,
+			  unsigned char set, unsigned char clear,
+			  unsigned char pending)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&vpm450m->pending_lock, flags);
+	vpm450m->want[channel] = (vpm450m->want[channel] & ~clear) | set;
+	vpm450m->pending[channel] |= pending;
+	/* Nobody is waiting for an echo canceller that is going away. */
+	if ((pending & PENDING_ECHO) && !(set & FLAG_ECHO))
+		vpm450m->pending[channel] &= ~PENDING_NOTIFY;
+	spin_unlock_irqrestore(&vpm450m->pending_lock, flags);
+
+	schedule_work(&vpm450m->work);
+}
+
+/**
+ * vpm450m_set_alaw_companding - Queue a companding change for a channel.
+ *
+ * Returns without waiting for the chip.
+ */
+void vpm450m_set_alaw_companding(struct vpm450m *vpm450m, int channel,
+				 bool alaw)
+{
+	if (channel >= ARRAY_SIZE(vpm450m->chanflags)) {
+		pr_err("Channel out of bounds in %s\n", __func__);
+		return;
+	}
+	vpm450m_queue(vpm450m, channel, (alaw) ? FLAG_ALAW : 0, FLAG_ALAW,
+		      PENDING_LAW);
+}
+
+/**
+ * vpm450m_setdtmf - Queue a tone detection / muting change for a channel.
+ *
+ * Returns without waiting for the chip.
+ */
+void vpm450m_setdtmf(struct vpm450m *vpm450m, int channel, int detect, int mute)
+{
+	if (channel >= ARRAY_SIZE(vpm450m->chanflags)) {
+		pr_err("Channel out of bounds in %s\n", __func__);
+		return;
+	}
+	vpm450m_queue(vpm450m, channel,
+		      ((detect) ? FLAG_DTMF : 0) | ((mute) ? FLAG_MUTE : 0),
+		      FLAG_DTMF | FLAG_MUTE, PENDING_DTMF);
+}
+
+/**
+ * vpm450m_setec - Queue enabling or disabling echo cancellation on a channel.
+ *
+ * Returns without waiting for the chip. Once an enable has been applied the
+ * driver is told through t4_vpm_ec_ready().
+ */
+void vpm450m_setec(struct vpm450m *vpm450m, int channel, int eclen)
+{
+	if (channel >= ARRAY_SIZE(vpm450m->chanflags)) {
+		pr_err("Channel out of bounds in %s\n", __func__);
+		return;
+	}
+	if (eclen) {
+		vpm450m_queue(vpm450m, channel, FLAG_ECHO, FLAG_ECHO,
+			      PENDING_ECHO | PENDING_NOTIFY);
+	} else {
+		vpm450m_queue(vpm450m, channel, 0, FLAG_ECHO, PENDING_ECHO);
+	}
+}
+
 int vpm450m_checkirq(struct vpm450m *vpm450m)
 {
 	tOCT6100_INTERRUPT_FLAGS InterruptFlags;
@@ -424,6 +557,7 @@ unsigned int get_vpm450m_capacity(struct device *device)
 
 	tOCT6100_API_GET_CAPACITY_PINS CapacityPins;
 
+	memset(&context, 0, sizeof(context));
 	context.dev = device;
 	context.ops = &wct4xxp_oct612x_ops;
 
@@ -460,6 +594,13 @@ struct vpm450m *init_vpm450m(struct device *device, int *isalaw,
 	memset(vpm450m, 0, sizeof(struct vpm450m));
 	vpm450m->context.dev = device;
 	vpm450m->context.ops = &wct4xxp_oct612x_ops;
+	spin_lock_init(&vpm450m->pending_lock);
+	mutex_init(&vpm450m->apply_lock);
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 20)
+	INIT_WORK(&vpm450m->work, vpm450m_work_fn, vpm450m);
+#else
+	INIT_WORK(&vpm450m->work, vpm450m_work_fn);
+#endif
 
 	if (!(ChipOpen = kmalloc(sizeof(tOCT6100_CHIP_OPEN), GFP_KERNEL))) {
 		kfree(vpm450m);
@@ -536,7 +677,9 @@ struct vpm450m *init_vpm450m(struct device *device, int *isalaw,
 		return NULL;
 	}
 
+	oct612x_begin_batch(&vpm450m->context);
 	ulResult = Oct6100ChipOpen(vpm450m->pApiInstance, ChipOpen);
+	oct612x_end_batch(&vpm450m->context);
 	if (ulResult != cOCT6100_ERR_OK) {
 		printk(KERN_NOTICE "Failed to open chip, code %08x!\n", ulResult);
 		vfree(vpm450m->pApiInstance);
@@ -593,6 +736,7 @@ struct vpm450m *init_vpm450m(struct device *device, int *isalaw,
 				printk(KERN_NOTICE "Failed to open channel %d %x!\n", x, ulResult);
 				continue;
 			}
+			vpm450m->want[x] = vpm450m->chanflags[x];
 			for (y = 0; y < ARRAY_SIZE(tones); y++) {
 				tOCT6100_TONE_DETECTION_ENABLE enable;
 				Oct6100ToneDetectionEnableDef(&enable);
@@ -614,6 +758,8 @@ void release_vpm450m(struct vpm450m *vpm450m)
 	UINT32 ulResult;
 	tOCT6100_CHIP_CLOSE ChipClose;
 
+	cancel_work_sync(&vpm450m->work);
+
 	Oct6100ChipCloseDef(&ChipClose);
 	ulResult = Oct6100ChipClose(vpm450m->pApiInstance, &ChipClose);
 	if (ulResult != cOCT6100_ERR_OK) {
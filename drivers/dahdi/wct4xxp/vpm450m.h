@@ -31,6 +31,10 @@ struct vpm450m;
 /* From driver */
 unsigned int oct_get_reg(void *data, unsigned int reg);
 void oct_set_reg(void *data, unsigned int reg, unsigned int val);
+void oct_set_reg_burst(void *data, unsigned int reg, const u16 *values,
+		       size_t count);
+void oct_set_reg_smear(void *data, unsigned int reg, u16 value, size_t count);
+void t4_vpm_ec_ready(struct t4 *wc, int channel);
 
 /* From vpm450m */
 struct vpm450m *init_vpm450m(struct device *device, int *isalaw,
@@ -322,6 +322,11 @@ struct wcdte {
 	spinlock_t cmd_list_lock;
 	struct list_head cmd_list;
 	struct list_head waiting_for_response_list;
+	/* RTP packets written during a DAHDI_TC_SUBMIT_BATCH request. They
+	 * are put on the transmit ring together when the last batch ends. Also
+	 * protected by cmd_list_lock. */
+	struct list_head batch_list;
+	unsigned int batch_depth;
 
 	spinlock_t rx_list_lock;
 	struct list_head rx_list;
@@ -883,12 +888,12 @@ wctc4xxp_initialize_descriptor_ring(struct pci_dev *pdev,
 
 static const unsigned int BUFFER1_SIZE_MASK = 0x7ff;
 
+/* Must be called with dr->lock held. */
 static int
-wctc4xxp_submit(struct wctc4xxp_descriptor_ring *dr, struct tcb *c)
+__wctc4xxp_submit(struct wctc4xxp_descriptor_ring *dr, struct tcb *c)
 {
 	volatile struct wctc4xxp_descriptor *d;
 	unsigned int len;
-	unsigned long flags;
 
 	WARN_ON(!c);
 	len = (c->data_len < MIN_PACKET_LEN) ? MIN_PACKET_LEN : c->data_len;
@@ -897,11 +902,9 @@ wctc4xxp_submit(struct wctc4xxp_descriptor_ring *dr, struct tcb *c)
 		c->data_len = MAX_FRAME_SIZE;
 	}
 
-	spin_lock_irqsave(&dr->lock, flags);
 	d = wctc4xxp_descriptor(dr, dr->tail);
 	WARN_ON(!d);
 	if (d->buffer1) {
-		spin_unlock_irqrestore(&dr->lock, flags);
 		/* Do not overwrite a buffer that is still in progress. */
 		return -EBUSY;
 	}
@@ -914,10 +917,21 @@ wctc4xxp_submit(struct wctc4xxp_descriptor_ring *dr, struct tcb *c)
 	dr->pending[dr->tail] = c;
 	dr->tail = (dr->tail + 1) & DRING_MASK;
 	++dr->count;
-	spin_unlock_irqrestore(&dr->lock, flags);
 	return 0;
 }
 
+static int
+wctc4xxp_submit(struct wctc4xxp_descriptor_ring *dr, struct tcb *c)
+{
+	unsigned long flags;
+	int res;
+
+	spin_lock_irqsave(&dr->lock, flags);
+	res = __wctc4xxp_submit(dr, c);
+	spin_unlock_irqrestore(&dr->lock, flags);
+	return res;
+}
+
 static inline struct tcb*
 wctc4xxp_retrieve(struct wctc4xxp_descriptor_ring *dr)
 {
@@ -1643,6 +1657,57 @@ wctc4xxp_transmit_cmd(struct wcdte *wc, struct tcb *cmd)
 	}
 }
 
+/* Transmit a list of RTP packets, none of which wait for an ack or response,
+ * filling the transmit ring under a single acquisition of its lock.  Whatever
+ * does not fit goes on the command list for the interrupt handler. */
+static void
+wctc4xxp_transmit_cmd_list(struct wcdte *wc, struct list_head *cmds)
+{
+	struct wctc4xxp_descriptor_ring *dr = wc->txd;
+	struct tcb *cmd, *temp;
+	unsigned long flags;
+	int submitted = 0;
+
+	if (unlikely(test_bit(DTE_SHUTDOWN, &wc->flags))) {
+		list_for_each_entry_safe(cmd, temp, cmds, node) {
+			list_del(&cmd->node);
+			free_cmd(cmd);
+		}
+		return;
+	}
+
+	list_for_each_entry(cmd, cmds, node) {
+		WARN_ON(cmd->flags & (__WAIT_FOR_ACK | __WAIT_FOR_RESPONSE));
+		if (cmd->data_len < MIN_PACKET_LEN) {
+			memset((u8 *)(cmd->data) + cmd->data_len, 0,
+			       MIN_PACKET_LEN-cmd->data_len);
+			cmd->data_len = MIN_PACKET_LEN;
+		}
+		cmd->timeout = jiffies + HZ/4;
+		if (!(cmd->flags & DO_NOT_CAPTURE))
+			wctc4xxp_net_capture_cmd(wc, cmd);
+	}
+
+	spin_lock_irqsave(&dr->lock, flags);
+	list_for_each_entry_safe(cmd, temp, cmds, node) {
+		if (__wctc4xxp_submit(dr, cmd))
+			break;
+		list_del_init(&cmd->node);
+		++submitted;
+	}
+	spin_unlock_irqrestore(&dr->lock, flags);
+
+	if (!list_empty(cmds)) {
+		spin_lock_irqsave(&wc->cmd_list_lock, flags);
+		list_for_each_entry_safe(cmd, temp, cmds, node)
+			list_move_tail(&cmd->node, &wc->cmd_list);
+		spin_unlock_irqrestore(&wc->cmd_list_lock, flags);
+	}
+
+	if (submitted)
+		wctc4xxp_transmit_demand_poll(wc);
+}
+
 static int
 wctc4xxp_transmit_cmd_and_wait(struct wcdte *wc, struct tcb *cmd)
 {
@@ -2113,6 +2178,36 @@ wctc4xxp_read(struct file *file, char __user *frame, size_t count, loff_t *ppos)
 	return returned_bytes;
 }
 
+static void wctc4xxp_poll_after_write(struct wcdte *wc)
+{
+	if (test_bit(DTE_POLLING, &wc->flags)) {
+#if HZ == 100
+		__wctc4xxp_polling(wc);
+#else
+		if (jiffies != wc->jiffies_at_last_poll) {
+			wc->jiffies_at_last_poll = jiffies;
+			__wctc4xxp_polling(wc);
+		}
+#endif
+	}
+}
+
+/* Holds on to cmd if a DAHDI_TC_SUBMIT_BATCH request is in progress on this
+ * card.  Returns 1 if cmd was queued, 0 if it should be transmitted now. */
+static int wctc4xxp_batch_cmd(struct wcdte *wc, struct tcb *cmd)
+{
+	unsigned long flags;
+	int queued = 0;
+
+	spin_lock_irqsave(&wc->cmd_list_lock, flags);
+	if (wc->batch_depth) {
+		list_add_tail(&cmd->node, &wc->batch_list);
+		queued = 1;
+	}
+	spin_unlock_irqrestore(&wc->cmd_list_lock, flags);
+	return queued;
+}
+
 /* Called with a frame in the srcfmt to be transcoded into the dstfmt. */
 static ssize_t
 wctc4xxp_write(struct file *file, const char __user *frame,
@@ -2182,23 +2277,47 @@ wctc4xxp_write(struct file *file, const char __user *frame,
 	    "Sending packet of %Zu byte on channel (%p).\n", count, dtc);
 
 	atomic_inc(&cpvt->stats.packets_sent);
-	wctc4xxp_transmit_cmd(wc, cmd);
 
-	if (test_bit(DTE_POLLING, &wc->flags)) {
-#if HZ == 100
-		__wctc4xxp_polling(wc);
-#else
-		if (jiffies != wc->jiffies_at_last_poll) {
-			wc->jiffies_at_last_poll = jiffies;
-			__wctc4xxp_polling(wc);
-		}
-#endif
-	}
+	if (wctc4xxp_batch_cmd(wc, cmd))
+		return count;
 
+	wctc4xxp_transmit_cmd(wc, cmd);
+	wctc4xxp_poll_after_write(wc);
 
 	return count;
 }
 
+static void wctc4xxp_batch_begin(struct dahdi_transcoder *tc)
+{
+	struct channel_pvt *cpvt = tc->channels[0].pvt;
+	struct wcdte *wc = cpvt->wc;
+	unsigned long flags;
+
+	spin_lock_irqsave(&wc->cmd_list_lock, flags);
+	++wc->batch_depth;
+	spin_unlock_irqrestore(&wc->cmd_list_lock, flags);
+}
+
+static void wctc4xxp_batch_end(struct dahdi_transcoder *tc)
+{
+	struct channel_pvt *cpvt = tc->channels[0].pvt;
+	struct wcdte *wc = cpvt->wc;
+	unsigned long flags;
+	LIST_HEAD(local_list);
+
+	spin_lock_irqsave(&wc->cmd_list_lock, flags);
+	WARN_ON(!wc->batch_depth);
+	if (wc->batch_depth && !--wc->batch_depth)
+		list_splice_init(&wc->batch_list, &local_list);
+	spin_unlock_irqrestore(&wc->cmd_list_lock, flags);
+
+	if (list_empty(&local_list))
+		return;
+
+	wctc4xxp_transmit_cmd_list(wc, &local_list);
+	wctc4xxp_poll_after_write(wc);
+}
+
 static void
 wctc4xxp_send_ack(struct wcdte *wc, u8 seqno, __be16 channel)
 {
@@ -3231,6 +3350,8 @@ initialize_transcoder(struct wcdte *wc, unsigned int srcfmts,
 	(*zt)->dstfmts = dstfmts;
 	(*zt)->allocate = wctc4xxp_operation_allocate;
 	(*zt)->release = wctc4xxp_operation_release;
+	(*zt)->batch_begin = wctc4xxp_batch_begin;
+	(*zt)->batch_end = wctc4xxp_batch_end;
 	wctc4xxp_setup_file_operations(&((*zt)->fops));
 	for (chan = 0; chan < wc->numchannels; ++chan)
 		(*zt)->channels[chan].pvt = &pvts[chan];
@@ -3449,6 +3570,7 @@ wctc4xxp_init_one(struct pci_dev *pdev, const struct pci_device_id *ent)
 	spin_lock_init(&wc->rx_list_lock);
 	spin_lock_init(&wc->rx_lock);
 	INIT_LIST_HEAD(&wc->cmd_list);
+	INIT_LIST_HEAD(&wc->batch_list);
 	INIT_LIST_HEAD(&wc->waiting_for_response_list);
 	INIT_LIST_HEAD(&wc->rx_list);
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 20)
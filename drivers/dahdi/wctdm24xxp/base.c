@@ -1135,48 +1135,11 @@ static void cmd_checkisr(struct wctdm *wc, struct wctdm_module *const mod)
 static void insert_tdm_data(const struct wctdm *wc, u8 *sframe)
 {
 	int i;
-	register u8 *chanchunk;
-
-	for (i = 0; i < wc->avchannels; i += 4) {
-		chanchunk = &wc->chans[0 + i]->chan.writechunk[0];
-		sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*0] = chanchunk[0];
-		sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*1] = chanchunk[1];
-		sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*2] = chanchunk[2];
-		sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*3] = chanchunk[3];
-		sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*4] = chanchunk[4];
-		sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*5] = chanchunk[5];
-		sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*6] = chanchunk[6];
-		sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*7] = chanchunk[7];
-
-		chanchunk = &wc->chans[1 + i]->chan.writechunk[0];
-		sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*0] = chanchunk[0];
-		sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*1] = chanchunk[1];
-		sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*2] = chanchunk[2];
-		sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*3] = chanchunk[3];
-		sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*4] = chanchunk[4];
-		sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*5] = chanchunk[5];
-		sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*6] = chanchunk[6];
-		sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*7] = chanchunk[7];
-
-		chanchunk = &wc->chans[2 + i]->chan.writechunk[0];
-		sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*0] = chanchunk[0];
-		sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*1] = chanchunk[1];
-		sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*2] = chanchunk[2];
-		sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*3] = chanchunk[3];
-		sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*4] = chanchunk[4];
-		sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*5] = chanchunk[5];
-		sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*6] = chanchunk[6];
-		sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*7] = chanchunk[7];
-
-		chanchunk = &wc->chans[3 + i]->chan.writechunk[0];
-		sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*0] = chanchunk[0];
-		sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*1] = chanchunk[1];
-		sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*2] = chanchunk[2];
-		sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*3] = chanchunk[3];
-		sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*4] = chanchunk[4];
-		sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*5] = chanchunk[5];
-		sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*6] = chanchunk[6];
-		sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*7] = chanchunk[7];
+
+	for (i = 0; i < wc->avchannels; ++i) {
+		dahdi_tdm_scatter_chunk(&sframe[i],
+					wc->chans[i]->chan.writechunk,
+					EFRAME_SIZE + EFRAME_GAP);
 	}
 }
 
@@ -1375,48 +1338,10 @@ static void cmd_retransmit(struct wctdm *wc)
 static void extract_tdm_data(struct wctdm *wc, const u8 *sframe)
 {
 	int i;
-	register u8 *chanchunk;
-
-	for (i = 0; i < wc->avchannels; i += 4) {
-		chanchunk = &wc->chans[0 + i]->chan.readchunk[0];
-		chanchunk[0] = sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*0];
-		chanchunk[1] = sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*1];
-		chanchunk[2] = sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*2];
-		chanchunk[3] = sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*3];
-		chanchunk[4] = sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*4];
-		chanchunk[5] = sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*5];
-		chanchunk[6] = sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*6];
-		chanchunk[7] = sframe[0 + i + (EFRAME_SIZE + EFRAME_GAP)*7];
-
-		chanchunk = &wc->chans[1 + i]->chan.readchunk[0];
-		chanchunk[0] = sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*0];
-		chanchunk[1] = sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*1];
-		chanchunk[2] = sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*2];
-		chanchunk[3] = sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*3];
-		chanchunk[4] = sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*4];
-		chanchunk[5] = sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*5];
-		chanchunk[6] = sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*6];
-		chanchunk[7] = sframe[1 + i + (EFRAME_SIZE + EFRAME_GAP)*7];
-
-		chanchunk = &wc->chans[2 + i]->chan.readchunk[0];
-		chanchunk[0] = sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*0];
-		chanchunk[1] = sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*1];
-		chanchunk[2] = sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*2];
-		chanchunk[3] = sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*3];
-		chanchunk[4] = sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*4];
-		chanchunk[5] = sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*5];
-		chanchunk[6] = sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*6];
-		chanchunk[7] = sframe[2 + i + (EFRAME_SIZE + EFRAME_GAP)*7];
-
-		chanchunk = &wc->chans[3 + i]->chan.readchunk[0];
-		chanchunk[0] = sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*0];
-		chanchunk[1] = sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*1];
-		chanchunk[2] = sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*2];
-		chanchunk[3] = sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*3];
-		chanchunk[4] = sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*4];
-		chanchunk[5] = sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*5];
-		chanchunk[6] = sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*6];
-		chanchunk[7] = sframe[3 + i + (EFRAME_SIZE + EFRAME_GAP)*7];
+
+	for (i = 0; i < wc->avchannels; ++i) {
+		dahdi_tdm_gather_chunk(wc->chans[i]->chan.readchunk, &sframe[i],
+				       EFRAME_SIZE + EFRAME_GAP);
 	}
 
 	/* Pre-echo with the vpmoct overwrites the 24th timeslot with the
@@ -1424,15 +1349,8 @@ static void extract_tdm_data(struct wctdm *wc, const u8 *sframe)
 	 * on all but the 24xx card, so we store it in a temporary buffer.
 	 */
 	if (wc->vpmoct && wc->vpmoct->preecho_enabled) {
-		chanchunk = &wc->vpmoct->preecho_buf[0];
-		chanchunk[0] = sframe[23 + (EFRAME_SIZE + EFRAME_GAP)*0];
-		chanchunk[1] = sframe[23 + (EFRAME_SIZE + EFRAME_GAP)*1];
-		chanchunk[2] = sframe[23 + (EFRAME_SIZE + EFRAME_GAP)*2];
-		chanchunk[3] = sframe[23 + (EFRAME_SIZE + EFRAME_GAP)*3];
-		chanchunk[4] = sframe[23 + (EFRAME_SIZE + EFRAME_GAP)*4];
-		chanchunk[5] = sframe[23 + (EFRAME_SIZE + EFRAME_GAP)*5];
-		chanchunk[6] = sframe[23 + (EFRAME_SIZE + EFRAME_GAP)*6];
-		chanchunk[7] = sframe[23 + (EFRAME_SIZE + EFRAME_GAP)*7];
+		dahdi_tdm_gather_chunk(&wc->vpmoct->preecho_buf[0], &sframe[23],
+				       EFRAME_SIZE + EFRAME_GAP);
 	}
 }
 
@@ -5446,6 +5364,28 @@ voicebus_current_latency_show(struct device *dev,
 static DEVICE_ATTR(voicebus_current_latency, 0400,
 		   voicebus_current_latency_show, NULL);
 
+static ssize_t
+voicebus_peak_latency_show(struct device *dev,
+			   struct device_attribute *attr, char *buf)
+{
+	struct wctdm *wc = dev_get_drvdata(dev);
+	return sprintf(buf, "%d\n", voicebus_peak_latency(&wc->vb));
+}
+
+static DEVICE_ATTR(voicebus_peak_latency, 0400,
+		   voicebus_peak_latency_show, NULL);
+
+static ssize_t
+voicebus_underruns_show(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct wctdm *wc = dev_get_drvdata(dev);
+	return sprintf(buf, "%u\n", voicebus_underrun_count(&wc->vb));
+}
+
+static DEVICE_ATTR(voicebus_underruns, 0400,
+		   voicebus_underruns_show, NULL);
+
 static ssize_t vpm_firmware_version_show(struct device *dev,
 				struct device_attribute *attr,
 				char *buf)
@@ -5517,6 +5457,20 @@ static void create_sysfs_files(struct wctdm *wc)
 			"Failed to create device attributes.\n");
 	}
 
+	ret = device_create_file(&wc->vb.pdev->dev,
+				 &dev_attr_voicebus_peak_latency);
+	if (ret) {
+		dev_info(&wc->vb.pdev->dev,
+			"Failed to create device attributes.\n");
+	}
+
+	ret = device_create_file(&wc->vb.pdev->dev,
+				 &dev_attr_voicebus_underruns);
+	if (ret) {
+		dev_info(&wc->vb.pdev->dev,
+			"Failed to create device attributes.\n");
+	}
+
 	ret = device_create_file(&wc->vb.pdev->dev,
 				 &dev_attr_vpm_firmware_version);
 	if (ret) {
@@ -5540,6 +5494,12 @@ static void remove_sysfs_files(struct wctdm *wc)
 	device_remove_file(&wc->vb.pdev->dev,
 			   &dev_attr_vpm_firmware_version);
 
+	device_remove_file(&wc->vb.pdev->dev,
+			   &dev_attr_voicebus_underruns);
+
+	device_remove_file(&wc->vb.pdev->dev,
+			   &dev_attr_voicebus_peak_latency);
+
 	device_remove_file(&wc->vb.pdev->dev,
 			   &dev_attr_voicebus_current_latency);
 }
@@ -2108,7 +2108,7 @@ static int t1xxp_set_linemode(struct dahdi_span *span, enum spantypes linemode)
 	/* Stop the processing of the channels since we're going to change
 	 * them. */
 	clear_bit(INITIALIZED, &wc->bit_flags);
-	synchronize_irq(wc->vb.pdev->irq);
+	voicebus_synchronize(&wc->vb);
 	smp_mb__after_clear_bit();
 	del_timer_sync(&wc->timer);
 	flush_workqueue(wc->wq);
@@ -2821,6 +2821,28 @@ static ssize_t voicebus_current_latency_show(struct device *dev,
 static DEVICE_ATTR(voicebus_current_latency, 0400,
 		   voicebus_current_latency_show, NULL);
 
+static ssize_t
+voicebus_peak_latency_show(struct device *dev,
+			   struct device_attribute *attr, char *buf)
+{
+	struct t1 *wc = dev_get_drvdata(dev);
+	return sprintf(buf, "%d\n", voicebus_peak_latency(&wc->vb));
+}
+
+static DEVICE_ATTR(voicebus_peak_latency, 0400,
+		   voicebus_peak_latency_show, NULL);
+
+static ssize_t
+voicebus_underruns_show(struct device *dev,
+			struct device_attribute *attr, char *buf)
+{
+	struct t1 *wc = dev_get_drvdata(dev);
+	return sprintf(buf, "%u\n", voicebus_underrun_count(&wc->vb));
+}
+
+static DEVICE_ATTR(voicebus_underruns, 0400,
+		   voicebus_underruns_show, NULL);
+
 
 static ssize_t vpm_firmware_version_show(struct device *dev,
 				struct device_attribute *attr,
@@ -2854,6 +2876,20 @@ static void create_sysfs_files(struct t1 *wc)
 			"Failed to create device attributes.\n");
 	}
 
+	ret = device_create_file(&wc->vb.pdev->dev,
+				 &dev_attr_voicebus_peak_latency);
+	if (ret) {
+		dev_info(&wc->vb.pdev->dev,
+			"Failed to create device attributes.\n");
+	}
+
+	ret = device_create_file(&wc->vb.pdev->dev,
+				 &dev_attr_voicebus_underruns);
+	if (ret) {
+		dev_info(&wc->vb.pdev->dev,
+			"Failed to create device attributes.\n");
+	}
+
 	ret = device_create_file(&wc->vb.pdev->dev,
 				 &dev_attr_vpm_firmware_version);
 	if (ret) {
@@ -2867,6 +2903,12 @@ static void remove_sysfs_files(struct t1 *wc)
 	device_remove_file(&wc->vb.pdev->dev,
 			   &dev_attr_vpm_firmware_version);
 
+	device_remove_file(&wc->vb.pdev->dev,
+			   &dev_attr_voicebus_underruns);
+
+	device_remove_file(&wc->vb.pdev->dev,
+			   &dev_attr_voicebus_peak_latency);
+
 	device_remove_file(&wc->vb.pdev->dev,
 			   &dev_attr_voicebus_current_latency);
 }
@@ -178,6 +178,7 @@ static int yelalarmdebounce = 500; /* RAI(yellow) def to 0.5s AT&T devguide */
 static char *default_linemode = "t1"; /* 'e1', 't1', or 'j1' */
 static int force_firmware;
 static int latency = WCXB_DEFAULT_LATENCY;
+static int polled;
 
 struct t13x_firm_header {
 	u8	header[6];
@@ -635,7 +636,9 @@ static struct vpm450m *init_vpm450m(struct t13x *wc, int isalaw,
 
 	/* Perform the actual configuration of the chip. */
 	oct_enable_dram(wc);
+	oct612x_begin_batch(&vpm450m->context);
 	ulResult = Oct6100ChipOpen(vpm450m->pApiInstance, ChipOpen);
+	oct612x_end_batch(&vpm450m->context);
 	if (ulResult != cOCT6100_ERR_OK) {
 		dev_info(&wc->dev->dev, "Unable to Oct6100ChipOpen: %x\n",
 				ulResult);
@@ -1817,7 +1820,7 @@ static int t13x_set_linemode(struct dahdi_span *span, enum spantypes linemode)
 	/* Stop the processing of the channels since we're going to change
 	 * them. */
 	clear_bit(INITIALIZED, &wc->bit_flags);
-	disable_irq(wc->xb.pdev->irq);
+	wcxb_disable_isr(&wc->xb);
 
 	synchronize_irq(wc->dev->irq);
 	smp_mb__after_clear_bit();
@@ -1860,7 +1863,7 @@ static int t13x_set_linemode(struct dahdi_span *span, enum spantypes linemode)
 		mod_timer(&wc->timer, jiffies + HZ/5);
 	}
 	wcxb_lock_latency(&wc->xb);
-	enable_irq(wc->xb.pdev->irq);
+	wcxb_enable_isr(&wc->xb);
 	mutex_unlock(&wc->lock);
 	msleep(10);
 	wcxb_unlock_latency(&wc->xb);
@@ -2200,16 +2203,12 @@ static void handle_leds(struct t13x *wc)
 
 static void te13x_handle_receive(struct wcxb *xb, void *vfp)
 {
-	int i, j;
+	int i;
 	u_char *frame = (u_char *) vfp;
 	struct t13x *wc = container_of(xb, struct t13x, xb);
 
-	for (j = 0; j < DAHDI_CHUNKSIZE; j++) {
-		for (i = 0; i < wc->span.channels; i++) {
-			wc->chans[i]->readchunk[j] =
-					frame[j*DMA_CHAN_SIZE+(1+i*4)];
-		}
-	}
+	dahdi_tdm_deinterleave(wc->chans, wc->span.channels, &frame[1],
+			       4, DMA_CHAN_SIZE);
 
 	if (0 == vpmsupport) {
 		for (i = 0; i < wc->span.channels; i++) {
@@ -2224,18 +2223,13 @@ static void te13x_handle_receive(struct wcxb *xb, void *vfp)
 
 static void te13x_handle_transmit(struct wcxb *xb, void *vfp)
 {
-	int i, j;
 	u_char *frame = (u_char *) vfp;
 	struct t13x *wc = container_of(xb, struct t13x, xb);
 
 	_dahdi_transmit(&wc->span);
 
-	for (j = 0; j < DAHDI_CHUNKSIZE; j++) {
-		for (i = 0; i < wc->span.channels; i++) {
-			frame[j*DMA_CHAN_SIZE+(1+i*4)] =
-				wc->chans[i]->writechunk[j];
-		}
-	}
+	dahdi_tdm_interleave(&frame[1], wc->chans, wc->span.channels,
+			     4, DMA_CHAN_SIZE);
 }
 
 #define SPAN_DEBOUNCE \
@@ -2532,7 +2526,8 @@ static int __devinit te13xp_init_one(struct pci_dev *pdev,
 	wc->xb.pdev = pdev;
 	wc->xb.ops = &xb_ops;
 	wc->xb.debug = &debug;
-	res = wcxb_init(&wc->xb, wc->name, 1);
+	res = wcxb_init(&wc->xb, wc->name,
+			(polled) ? WCXB_INT_MODE_POLLED : WCXB_INT_MODE_LEGACY);
 	if (res)
 		goto fail_exit;
 
@@ -2731,6 +2726,8 @@ module_param(vpmsupport, int, 0600);
 module_param(force_firmware, int, S_IRUGO);
 module_param(latency, int, S_IRUGO);
 MODULE_PARM_DESC(latency, "How many milliseconds of audio to buffer between card and host (3ms default). This number will increase during runtime, dynamically, if dahdi detects that it is too small. This is commonly refered to as a \"latency bump\"");
+module_param(polled, int, S_IRUGO);
+MODULE_PARM_DESC(polled, "Set to 1 to service all cards from a shared 1 ms timer instead of per-card interrupts.");
 
 MODULE_DESCRIPTION("Wildcard Digital Card Driver");
 MODULE_AUTHOR("Digium Incorporated <support@digium.com>");
@@ -206,6 +206,7 @@ static int yelalarmdebounce	= 500;  /* RAI(yellow) def to 0.5s AT&T guide */
 static char *default_linemode	= "t1"; /* 'e1', 't1', or 'j1' */
 static int latency		= WCXB_DEFAULT_LATENCY;
 static int max_latency		= WCXB_DEFAULT_MAXLATENCY;
+static int polled;
 
 struct t43x_firm_header {
 	u8	header[6];
@@ -585,7 +586,9 @@ static struct vpm450m *init_vpm450m(struct t43x *wc, int *laws, int numspans,
 
 	/* Perform the actual configuration of the chip. */
 	wcxb_enable_echocan_dram(&wc->xb);
+	oct612x_begin_batch(&vpm450m->context);
 	ulResult = Oct6100ChipOpen(vpm450m->pApiInstance, ChipOpen);
+	oct612x_end_batch(&vpm450m->context);
 	if (ulResult != cOCT6100_ERR_OK) {
 		dev_info(&wc->xb.pdev->dev, "Unable to Oct6100ChipOpen: %x\n",
 				ulResult);
@@ -2422,7 +2425,7 @@ t43x_init_one_span(struct t43x *wc, struct t43x_span *ts, enum linemode type)
 	}
 
 	/* Stop the interrupt handler so that we may swap the channel array. */
-	disable_irq(wc->xb.pdev->irq);
+	wcxb_disable_isr(&wc->xb);
 
 	spin_lock_irqsave(&wc->reglock, flags);
 	for (x = 0; x < ARRAY_SIZE(ts->chans); x++) {
@@ -2477,11 +2480,11 @@ t43x_init_one_span(struct t43x *wc, struct t43x_span *ts, enum linemode type)
 	/* Span is in red alarm by default ? */
 	ts->span.alarms = DAHDI_ALARM_NONE;
 
-	enable_irq(wc->xb.pdev->irq);
+	wcxb_enable_isr(&wc->xb);
 	return 0;
 
 error_exit:
-	enable_irq(wc->xb.pdev->irq);
+	wcxb_enable_isr(&wc->xb);
 
 	for (x = 0; x < ARRAY_SIZE(chans); ++x) {
 		kfree(chans[x]);
@@ -2953,7 +2956,7 @@ static void handle_leds(struct t43x *wc)
 
 static void t43x_handle_receive(struct wcxb *xb, void *vfp)
 {
-	int i, j, s;
+	int i, s;
 	u_char *frame = (u_char *) vfp;
 	struct t43x *wc = container_of(xb, struct t43x, xb);
 	struct t43x_span *ts;
@@ -2963,12 +2966,8 @@ static void t43x_handle_receive(struct wcxb *xb, void *vfp)
 		if (!test_bit(DAHDI_FLAGBIT_REGISTERED, &ts->span.flags))
 			continue;
 
-		for (j = 0; j < DAHDI_CHUNKSIZE; j++) {
-			for (i = 0; i < ts->span.channels; i++) {
-				ts->chans[i]->readchunk[j] =
-					frame[j*WCXB_DMA_CHAN_SIZE+(s+1+i*4)];
-			}
-		}
+		dahdi_tdm_deinterleave(ts->chans, ts->span.channels,
+				       &frame[s + 1], 4, WCXB_DMA_CHAN_SIZE);
 
 		if (0 == vpmsupport) {
 			for (i = 0; i < ts->span.channels; i++) {
@@ -2984,7 +2983,7 @@ static void t43x_handle_receive(struct wcxb *xb, void *vfp)
 
 static void t43x_handle_transmit(struct wcxb *xb, void *vfp)
 {
-	int i, j, s;
+	int s;
 	u_char *frame = (u_char *) vfp;
 	struct t43x *wc = container_of(xb, struct t43x, xb);
 	struct t43x_span *ts;
@@ -2998,10 +2997,8 @@ static void t43x_handle_transmit(struct wcxb *xb, void *vfp)
 
 		_dahdi_transmit(&ts->span);
 
-		for (j = 0; j < DAHDI_CHUNKSIZE; j++)
-			for (i = 0; i < ts->span.channels; i++)
-				frame[j*WCXB_DMA_CHAN_SIZE+(s+1+i*4)] =
-					ts->chans[i]->writechunk[j];
+		dahdi_tdm_interleave(&frame[s + 1], ts->chans,
+				     ts->span.channels, 4, WCXB_DMA_CHAN_SIZE);
 	}
 }
 
@@ -3327,7 +3324,8 @@ static int __devinit t43x_init_one(struct pci_dev *pdev,
 	wc->xb.ops = &xb_ops;
 	wc->xb.debug = &debug;
 
-	res = wcxb_init(&wc->xb, KBUILD_MODNAME, 1);
+	res = wcxb_init(&wc->xb, KBUILD_MODNAME,
+			(polled) ? WCXB_INT_MODE_POLLED : WCXB_INT_MODE_LEGACY);
 	if (res)
 		goto fail_exit;
 
@@ -3582,6 +3580,8 @@ module_param(latency, int, S_IRUGO);
 MODULE_PARM_DESC(latency, "How many milliseconds of audio to buffer between card and host (3ms default). This number will increase during runtime, dynamically, if dahdi detects that it is too small. This is commonly refered to as a \"latency bump\"");
 module_param(max_latency, int, 0600);
 MODULE_PARM_DESC(max_latency, "The maximum amount of latency that the driver will permit.");
+module_param(polled, int, S_IRUGO);
+MODULE_PARM_DESC(polled, "Set to 1 to service all cards from a shared 1 ms timer instead of per-card interrupts.");
 
 MODULE_DESCRIPTION("Wildcard Digital Card Driver");
 MODULE_AUTHOR("Digium Incorporated <support@digium.com>");
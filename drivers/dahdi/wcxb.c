@@ -29,6 +29,7 @@
 #include <linux/crc32.h>
 #include <linux/delay.h>
 #include <linux/version.h>
+#include <linux/hrtimer.h>
 
 #if LINUX_VERSION_CODE > KERNEL_VERSION(2, 6, 26)
 #define HAVE_RATELIMIT
@@ -108,6 +109,26 @@
 
 #define FLASH_SPI_BASE 0x200
 
+#define WCXB_POLL_NS		(NSEC_PER_SEC / 1000)
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 25)
+static inline u64 hrtimer_forward_now(struct hrtimer *timer, ktime_t interval)
+{
+	return hrtimer_forward(timer, timer->base->get_time(), interval);
+}
+#endif
+
+/*
+ * Boards initialized with WCXB_INT_MODE_POLLED are serviced back-to-back from
+ * one timer instead of each raising an interrupt every millisecond.
+ * wcxb_poll_lock protects wcxb_poll_list and is held for the whole tick, so
+ * taking it is enough to wait for a tick in progress to complete.
+ */
+static DEFINE_SPINLOCK(wcxb_poll_lock);
+static LIST_HEAD(wcxb_poll_list);
+static struct hrtimer wcxb_poll_timer;
+static bool wcxb_poll_timer_initialized;
+
 struct wcxb_hw_desc {
 	volatile __be32 status;
 	__be32 tx_buf;
@@ -448,6 +469,105 @@ DAHDI_IRQ_HANDLER(wcxb_isr)
 	return ret;
 }
 
+static enum hrtimer_restart wcxb_poll_tick(struct hrtimer *timer)
+{
+	struct wcxb *xb;
+	unsigned long flags;
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+
+	spin_lock_irqsave(&wcxb_poll_lock, flags);
+	list_for_each_entry(xb, &wcxb_poll_list, poll_node) {
+		if (atomic_read(&xb->isr_disabled))
+			continue;
+		_wcxb_isr(xb->pdev->irq, xb);
+	}
+
+	if (!list_empty(&wcxb_poll_list)) {
+		hrtimer_forward_now(timer, ktime_set(0, WCXB_POLL_NS));
+		ret = HRTIMER_RESTART;
+	}
+	spin_unlock_irqrestore(&wcxb_poll_lock, flags);
+	return ret;
+}
+
+static void wcxb_poll_add(struct wcxb *xb)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&wcxb_poll_lock, flags);
+	if (!wcxb_poll_timer_initialized) {
+		hrtimer_init(&wcxb_poll_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		wcxb_poll_timer.function = wcxb_poll_tick;
+		wcxb_poll_timer_initialized = true;
+	}
+	if (list_empty(&wcxb_poll_list)) {
+		hrtimer_start(&wcxb_poll_timer, ktime_set(0, WCXB_POLL_NS),
+			      HRTIMER_MODE_REL);
+	}
+	list_add_tail(&xb->poll_node, &wcxb_poll_list);
+	spin_unlock_irqrestore(&wcxb_poll_lock, flags);
+}
+
+/*
+ * Since this library is linked into each board driver, the timer must not be
+ * left pending once the last board of a driver is released.
+ */
+static void wcxb_poll_del(struct wcxb *xb)
+{
+	unsigned long flags;
+	bool empty;
+
+	spin_lock_irqsave(&wcxb_poll_lock, flags);
+	list_del_init(&xb->poll_node);
+	empty = list_empty(&wcxb_poll_list);
+	spin_unlock_irqrestore(&wcxb_poll_lock, flags);
+
+	if (!empty)
+		return;
+
+	hrtimer_cancel(&wcxb_poll_timer);
+
+	/* Another board may have been added while the timer was cancelled. */
+	spin_lock_irqsave(&wcxb_poll_lock, flags);
+	if (!list_empty(&wcxb_poll_list)) {
+		hrtimer_start(&wcxb_poll_timer, ktime_set(0, WCXB_POLL_NS),
+			      HRTIMER_MODE_REL);
+	}
+	spin_unlock_irqrestore(&wcxb_poll_lock, flags);
+}
+
+static void wcxb_poll_sync(void)
+{
+	unsigned long flags;
+	spin_lock_irqsave(&wcxb_poll_lock, flags);
+	spin_unlock_irqrestore(&wcxb_poll_lock, flags);
+}
+
+/**
+ * wcxb_disable_isr - Keep the interrupt handler from running.
+ *
+ * Use in place of disable_irq() so that boards serviced from the poll timer
+ * are covered as well. Calls nest.
+ */
+void wcxb_disable_isr(struct wcxb *xb)
+{
+	if (xb->flags.polled) {
+		atomic_inc(&xb->isr_disabled);
+		wcxb_poll_sync();
+	} else {
+		disable_irq(xb->pdev->irq);
+	}
+}
+
+void wcxb_enable_isr(struct wcxb *xb)
+{
+	if (xb->flags.polled)
+		atomic_dec(&xb->isr_disabled);
+	else
+		enable_irq(xb->pdev->irq);
+}
+
 static int wcxb_alloc_dring(struct wcxb *xb, const char *board_name)
 {
 	xb->meta_dring =
@@ -603,6 +723,8 @@ int wcxb_init(struct wcxb *xb, const char *board_name, u32 int_mode)
 
 	xb->latency = WCXB_DEFAULT_LATENCY;
 	spin_lock_init(&xb->lock);
+	INIT_LIST_HEAD(&xb->poll_node);
+	atomic_set(&xb->isr_disabled, 0);
 
 	xb->membase = pci_iomap(pdev, 0, 0);
 	if (pci_request_regions(pdev, board_name))
@@ -620,9 +742,14 @@ int wcxb_init(struct wcxb *xb, const char *board_name, u32 int_mode)
 	/* Enable writes to fpga status register */
 	iowrite32be(0, xb->membase + 0x04);
 
+	xb->flags.polled = (WCXB_INT_MODE_POLLED == int_mode);
 	xb->flags.have_msi = (int_mode) ? 0 : (0 == pci_enable_msi(pdev));
 
-	if (request_irq(pdev->irq, wcxb_isr,
+	if (xb->flags.polled) {
+		dev_info(&xb->pdev->dev,
+			 "Polling instead of using interrupts.\n");
+		wcxb_poll_add(xb);
+	} else if (request_irq(pdev->irq, wcxb_isr,
 			(xb->flags.have_msi) ? 0 : DAHDI_IRQ_SHARED,
 			board_name, xb)) {
 		dev_notice(&xb->pdev->dev, "Unable to request IRQ %d\n",
@@ -691,7 +818,10 @@ void wcxb_stop(struct wcxb *xb)
 	/* Flush quiesce commands before exit */
 	ioread32be(xb->membase);
 	spin_unlock_irqrestore(&xb->lock, flags);
-	synchronize_irq(xb->pdev->irq);
+	if (xb->flags.polled)
+		wcxb_poll_sync();
+	else
+		synchronize_irq(xb->pdev->irq);
 }
 
 bool wcxb_is_stopped(struct wcxb *xb)
@@ -730,8 +860,12 @@ static void wcxb_free_dring(struct wcxb *xb)
 void wcxb_release(struct wcxb *xb)
 {
 	wcxb_stop(xb);
-	synchronize_irq(xb->pdev->irq);
-	free_irq(xb->pdev->irq, xb);
+	if (xb->flags.polled) {
+		wcxb_poll_del(xb);
+	} else {
+		synchronize_irq(xb->pdev->irq);
+		free_irq(xb->pdev->irq, xb);
+	}
 	if (xb->flags.have_msi)
 		pci_disable_msi(xb->pdev);
 	if (xb->membase)
@@ -753,7 +887,10 @@ int wcxb_start(struct wcxb *xb)
 	iowrite32be(-1, xb->membase + IAR);
 	iowrite32be(DESC_UNDERRUN|DESC_COMPLETE, xb->membase + IER);
 	/* iowrite32be(0x3f7, xb->membase + IER); */
-	iowrite32be(MER_ME|MER_HIE, xb->membase + MER);
+	/* When polled, the ISR still latches the pending sources but the
+	 * interrupt line is never asserted. */
+	if (!xb->flags.polled)
+		iowrite32be(MER_ME|MER_HIE, xb->membase + MER);
 
 	/* Start the DMA engine processing. */
 	reg = ioread32be(xb->membase + TDM_CONTROL);
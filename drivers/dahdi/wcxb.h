@@ -27,6 +27,11 @@
 #define WCXB_DEFAULT_MAXLATENCY 20U
 #define WCXB_DMA_CHAN_SIZE	128
 
+/* Values for the int_mode argument to wcxb_init(). */
+#define WCXB_INT_MODE_MSI	0	/* Use MSI if available. */
+#define WCXB_INT_MODE_LEGACY	1	/* Legacy interrupts only. */
+#define WCXB_INT_MODE_POLLED	2	/* Shared 1 ms poll timer. */
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2, 6, 24)
 /* The is_pcie member was backported but I'm not sure in which version. */
 #  ifndef RHEL_RELEASE_VERSION
@@ -58,6 +63,7 @@ struct wcxb {
 		u32	have_msi:1;
 		u32	latency_locked:1;
 		u32	drive_timing_cable:1;
+		u32	polled:1;
 #ifdef WCXB_PCI_DEV_DOES_NOT_HAVE_IS_PCIE
 		u32	is_pcie:1;
 #endif
@@ -70,6 +76,8 @@ struct wcxb {
 	dma_addr_t			hw_dring_phys;
 	struct dma_pool			*pool;
 	unsigned long			framecount;
+	struct list_head		poll_node;
+	atomic_t			isr_disabled;
 };
 
 extern int wcxb_init(struct wcxb *xb, const char *board_name, u32 int_mode);
@@ -78,6 +86,8 @@ extern int wcxb_start(struct wcxb *xb);
 extern void wcxb_stop(struct wcxb *xb);
 extern int wcxb_wait_for_stop(struct wcxb *xb, unsigned long timeout_ms);
 extern bool wcxb_is_stopped(struct wcxb *xb);
+extern void wcxb_disable_isr(struct wcxb *xb);
+extern void wcxb_enable_isr(struct wcxb *xb);
 
 enum wcxb_clock_sources {
 	WCXB_CLOCK_SELF,	/* Use the internal oscillator for timing. */
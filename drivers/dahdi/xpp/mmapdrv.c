@@ -340,8 +340,8 @@ static int fill_proc_queue(char *p, struct xframe_queue *q)
 	len = sprintf(p,
 		"%-15s: counts %3d, %3d, %3d worst %3d, overflows %3d "
 		"worst_lag %02ld.%ld ms\n",
-		q->name, q->steady_state_count, q->count, q->max_count,
-		q->worst_count, q->overflows, q->worst_lag_usec / 1000,
+		q->name, q->steady_state_count, xframe_queue_count(q),
+		q->max_count, q->worst_count, q->overflows, q->worst_lag_usec / 1000,
 		q->worst_lag_usec % 1000);
 	xframe_queue_clearstats(q);
 	return len;
@@ -577,7 +577,9 @@ static int __init xpp_mmap_init(void)
 	strncpy(global_xbus->connector, "mmap", XBUS_DESCLEN);
 	strncpy(global_xbus->label, "mmap:0", LABEL_SIZE);
 
-	xframe_queue_init(&txpool, 10, 200, "mmap_txpool", global_xbus);
+	ret = xframe_queue_init(&txpool, 10, 200, "mmap_txpool", global_xbus);
+	if (ret)
+		goto fail_txpool;
 	if (!
 	    (proc_entry =
 	     create_proc_entry("xpp_mmap", 0, global_xbus->proc_xbus_dir))) {
@@ -594,6 +596,8 @@ static int __init xpp_mmap_init(void)
 	return 0;
 
 fail_proc:
+	xframe_queue_destroy(&txpool);
+fail_txpool:
 	xbus_disconnect(global_xbus);
 fail_xbus:
 	kmem_cache_destroy(xframe_cache);
@@ -622,6 +626,7 @@ static void __exit xpp_mmap_exit(void)
 	xbus = xbus_num(global_xbus->num);
 	remove_proc_entry("xpp_mmap", xbus->proc_xbus_dir);
 	xframe_queue_clear(&txpool);
+	xframe_queue_destroy(&txpool);
 	xbus_disconnect(xbus);
 	kmem_cache_destroy(xframe_cache);
 
@@ -468,7 +468,8 @@ static void xbus_command_queue_clean(xbus_t *xbus)
 {
 	xframe_t *frm;
 
-	XBUS_DBG(DEVICES, xbus, "count=%d\n", xbus->command_queue.count);
+	XBUS_DBG(DEVICES, xbus, "count=%d\n",
+		 xframe_queue_count(&xbus->command_queue));
 	xframe_queue_disable(&xbus->command_queue, 1);
 	while ((frm = xframe_dequeue(&xbus->command_queue)) != NULL)
 		FREE_SEND_XFRAME(xbus, frm);
@@ -649,6 +650,8 @@ int xbus_xpd_unbind(xbus_t *xbus, xpd_t *xpd)
 	spin_lock_irqsave(&xbus->lock, flags);
 	xpd->xbus = NULL;
 	xbus->xpds[xpd_num] = NULL;
+	/* Forget the PCM layouts validated against it (see xbus-pcm.h) */
+	atomic_inc(&xbus->pcm_layout_gen);
 	if (atomic_dec_and_test(&xbus->num_xpds))
 		xbus_setstate(xbus, XBUS_STATE_IDLE);
 	spin_unlock_irqrestore(&xbus->lock, flags);
@@ -1356,6 +1359,8 @@ int xbus_activate(xbus_t *xbus)
 	xbus_set_command_timer(xbus, 1);
 	xframe_queue_disable(&xbus->command_queue, 0);
 	/* must be done after transport is valid */
+	xframe_queue_fill(&xbus->send_pool);
+	xframe_queue_fill(&xbus->receive_pool);
 	xbus_setstate(xbus, XBUS_STATE_IDLE);
 	CALL_PROTO(GLOBAL, AB_REQUEST, xbus, NULL);
 	/*
@@ -1498,6 +1503,11 @@ void xbus_free(xbus_t *xbus)
 	XBUS_DBG(DEVICES, xbus, "Going to free...\n");
 	init_xbus(num, NULL);
 	spin_unlock_irqrestore(&xbuses_lock, flags);
+	xframe_queue_destroy(&xbus->command_queue);
+	xframe_queue_destroy(&xbus->receive_queue);
+	xframe_queue_destroy(&xbus->send_pool);
+	xframe_queue_destroy(&xbus->receive_pool);
+	xframe_queue_destroy(&xbus->pcm_tospan);
 	KZFREE(xbus);
 }
 EXPORT_SYMBOL(xbus_free);
@@ -1571,12 +1581,17 @@ xbus_t *xbus_new(struct xbus_ops *ops, ushort max_send_size,
 	}
 #endif
 #endif
-	xframe_queue_init(&xbus->command_queue, 10, command_queue_length,
-			  "command_queue", xbus);
-	xframe_queue_init(&xbus->receive_queue, 10, 50, "receive_queue", xbus);
-	xframe_queue_init(&xbus->send_pool, 10, 100, "send_pool", xbus);
-	xframe_queue_init(&xbus->receive_pool, 10, 50, "receive_pool", xbus);
-	xframe_queue_init(&xbus->pcm_tospan, 5, 10, "pcm_tospan", xbus);
+	if (xframe_queue_init(&xbus->command_queue, 10, command_queue_length,
+			  "command_queue", xbus) ||
+	    xframe_queue_init(&xbus->receive_queue, 10, 50, "receive_queue",
+			  xbus) ||
+	    xframe_queue_init(&xbus->send_pool, 10, 100, "send_pool", xbus) ||
+	    xframe_queue_init(&xbus->receive_pool, 10, 50, "receive_pool",
+			  xbus) ||
+	    xframe_queue_init(&xbus->pcm_tospan, 5, 10, "pcm_tospan", xbus)) {
+		ERR("Failed to allocate xframe queues\n");
+		goto nobus;
+	}
 	tasklet_init(&xbus->receive_tasklet, receive_tasklet_func,
 		     (unsigned long)xbus);
 	/*
@@ -1680,8 +1695,8 @@ static void xbus_fill_proc_queue(struct seq_file *sfile, struct xframe_queue *q)
 	seq_printf(sfile,
 		"%-15s: counts %3d, %3d, %3d worst %3d, overflows %3d "
 		"worst_lag %02ld.%ld ms\n",
-		q->name, q->steady_state_count, q->count, q->max_count,
-		q->worst_count, q->overflows, q->worst_lag_usec / 1000,
+		q->name, q->steady_state_count, xframe_queue_count(q),
+		q->max_count, q->worst_count, q->overflows, q->worst_lag_usec / 1000,
 		q->worst_lag_usec % 1000);
 	xframe_queue_clearstats(q);
 }
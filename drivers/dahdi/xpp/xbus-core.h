@@ -25,6 +25,7 @@
 #include <linux/wait.h>
 #include <linux/interrupt.h>	/* for tasklets */
 #include <linux/kref.h>
+#include <linux/ktime.h>
 #include "xpd.h"
 #include "xframe_queue.h"
 #include "xbus-pcm.h"
@@ -221,6 +222,9 @@ struct xbus {
 
 	struct xpp_ticker ticker;	/* for tick rate */
 	struct xpp_drift drift;	/* for tick offset */
+	struct xpp_pcm_layout pcm_layouts[XPP_PCM_LAYOUTS];
+	unsigned int pcm_layout_next;	/* next slot to replace */
+	atomic_t pcm_layout_gen;	/* bumped when an XPD is unbound */
 
 	atomic_t pcm_rx_counter;
 	unsigned int global_counter;
@@ -278,9 +282,10 @@ struct xframe {
 	unsigned long xframe_magic;
 	struct list_head frame_list;
 	atomic_t frame_len;
+	bool tx_more;		/* another PCM frame of this tick follows */
 	xbus_t *xbus;
 	struct timeval tv_created;
-	struct timeval tv_queued;
+	ktime_t kt_queued;
 	struct timeval tv_submitted;
 	struct timeval tv_received;
 	/* filled by transport layer */
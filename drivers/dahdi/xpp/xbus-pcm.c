@@ -23,6 +23,7 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include "xbus-pcm.h"
+#include "xbus-sync.h"
 #include "xbus-core.h"
 #include "xpp_dahdi.h"
 #include "dahdi_debug.h"
@@ -46,6 +47,12 @@ EXPORT_SYMBOL(pcmtx_chan);
 #endif
 static DEF_PARM_BOOL(disable_pll_sync, 0, 0644,
 		     "Disable automatic adjustment of AB clocks");
+static DEF_PARM_BOOL(sync_pi, 0, 0644,
+		     "Adjust AB clocks with a PI controller (experimental)");
+static DEF_PARM(uint, sync_pi_kp, 40, 0644,
+		"PI proportional gain (1/1000 drift units per usec)");
+static DEF_PARM(uint, sync_pi_ki, 8, 0644,
+		"PI integral gain (1/1000 drift units per usec per cycle)");
 
 static xbus_t *syncer;		/* current syncer */
 static atomic_t xpp_tick_counter = ATOMIC_INIT(0);
@@ -63,19 +70,7 @@ static xbus_t *global_ticker;
 static struct xpp_ticker global_ticks_series;
 
 #define	PROC_SYNC		"sync"
-/* Sampling cycle in usec */
-#define SYNC_CYCLE		500
-/* Samples from end of SYNC_CYCLE */
-#define SYNC_CYCLE_SAMPLE	100
-/* Number of SYNC_CYCLE's to converge speed */
-#define SYNC_CONVERGE		10
-/* Offset from ref_ticker to other AB's */
-#define SYNC_CENTER		500
-/* If within +/-SYNC_DELTA, try to stay there */
-#define SYNC_DELTA		40
 #define	BIG_TICK_INTERVAL	1000
-/* maximal firmware drift unit (hardware limit 63) */
-#define	SYNC_ADJ_MAX		20
 
 /*
  * The USB bulk endpoints have a large jitter in the timing of frames
@@ -151,6 +146,21 @@ static inline void xbus_drift_clear(xbus_t *xbus)
 	ticker_set_cycle(&xbus->ticker, SYNC_ADJ_QUICK);
 	di->max_speed = -SYNC_ADJ_MAX;
 	di->min_speed = SYNC_ADJ_MAX;
+	/*
+	 * Start the PI controller from the current drift, so a change
+	 * of the reference does not kick the AB clock back to nominal.
+	 */
+	di->pi_integral = xpp_sync_pi_seed(xbus->sync_adjustment, sync_pi_ki);
+	di->usec_delta_prev = LONG_MAX;
+}
+
+static inline void sync_hist_add(unsigned int *hist, long bucket)
+{
+	if (bucket < 0)
+		bucket = 0;
+	if (bucket >= SYNC_HIST_BUCKETS)
+		bucket = SYNC_HIST_BUCKETS - 1;
+	hist[bucket]++;
 }
 
 void xpp_drift_init(xbus_t *xbus)
@@ -218,6 +228,8 @@ static void xpp_drift_step(xbus_t *xbus, const struct timeval *tv)
 			 */
 			di->lost_ticks++;
 			di->lost_tick_count += abs(lost_ticks);
+			sync_hist_add(di->slip_hist, abs(lost_ticks) - 1);
+			di->usec_delta_prev = LONG_MAX;
 			if ((rate_limit++ % 1003) == 0) {
 				/* FIXME: This should be a NOTICE.
 				 * However we have several false ones at
@@ -237,6 +249,11 @@ static void xpp_drift_step(xbus_t *xbus, const struct timeval *tv)
 			    (long)usec_diff(&ticker->last_sample.tv,
 					    &ref_ticker->last_sample.tv);
 			sample_tick(xbus, usec_delta);
+			if (di->usec_delta_prev != LONG_MAX)
+				sync_hist_add(di->jitter_hist,
+					abs(usec_delta - di->usec_delta_prev) /
+					SYNC_HIST_JITTER);
+			di->usec_delta_prev = usec_delta;
 			if ((ticker->count % SYNC_CYCLE) >
 			    (SYNC_CYCLE - SYNC_CYCLE_SAMPLE))
 				di->delta_sum += usec_delta;
@@ -250,24 +267,19 @@ static void xpp_drift_step(xbus_t *xbus, const struct timeval *tv)
 				    SYNC_CENTER;
 				int offset_prev = di->offset_prev;
 				int speed = xbus->sync_adjustment;
-				int fix = 0;
 				int best_speed =
 				    (di->max_speed + di->min_speed) >> 1;
 
-				if (offset > 0 && offset < SYNC_DELTA) {
-					speed = best_speed - 1;
-				} else if (offset < 0 && offset > -SYNC_DELTA) {
-					speed = best_speed + 1;
-				} else {
-					if (offset > 0) {
-						if (offset > offset_prev)
-							fix--;
-					} else {
-						if (offset < offset_prev)
-							fix++;
-					}
-					speed += fix;
-				}
+				sync_hist_add(di->offset_hist,
+					(offset + SYNC_HIST_OFFSET *
+					 SYNC_HIST_BUCKETS / 2) /
+					SYNC_HIST_OFFSET);
+				if (sync_pi)
+					speed = xpp_sync_pi_step(&di->pi_integral,
+						offset, sync_pi_kp, sync_pi_ki);
+				else
+					speed = xpp_sync_legacy_step(offset,
+						offset_prev, speed, best_speed);
 				if (speed < -SYNC_ADJ_MAX)
 					speed = -SYNC_ADJ_MAX;
 				if (speed > SYNC_ADJ_MAX)
@@ -287,8 +299,8 @@ static void xpp_drift_step(xbus_t *xbus, const struct timeval *tv)
 					offset_prev, di->min_speed,
 					di->max_speed, usec_delta);
 				XBUS_DBG(SYNC, xbus,
-					"ADJ: speed=%d (best_speed=%d) fix=%d\n",
-					speed, best_speed, fix);
+					"ADJ: speed=%d (best_speed=%d)\n",
+					speed, best_speed);
 				xbus->sync_adjustment_offset = speed;
 				if (xbus != syncer
 				    && xbus->sync_adjustment != speed)
@@ -1016,17 +1028,103 @@ int generic_echocancel_setmask(xpd_t *xpd, xpp_line_t ec_mask)
 }
 EXPORT_SYMBOL(generic_echocancel_setmask);
 
+static struct xpp_pcm_layout *pcm_layout_match(xbus_t *xbus,
+						xframe_t *xframe)
+{
+	struct xpp_pcm_layout *layout;
+	xpacket_t *pack;
+	__u8 *p;
+	int i;
+	int j;
+
+	for (i = 0; i < XPP_PCM_LAYOUTS; i++) {
+		layout = &xbus->pcm_layouts[i];
+		if (layout->frame_len != XFRAME_LEN(xframe))
+			continue;
+		p = xframe->packets;
+		for (j = 0; j < layout->npacks; j++) {
+			pack = (xpacket_t *)p;
+			if (XPACKET_OP(pack) != XPROTO_NAME(GLOBAL, PCM_READ)
+			    || XPACKET_LEN(pack) != layout->packs[j].len
+			    || XPD_IDX(XPACKET_ADDR_UNIT(pack),
+				       XPACKET_ADDR_SUBUNIT(pack)) !=
+			    layout->packs[j].xpd_idx
+			    || RPACKET_FIELD(pack, GLOBAL, PCM_READ, lines) !=
+			    layout->packs[j].lines)
+				break;
+			p += layout->packs[j].len;
+		}
+		if (j == layout->npacks)
+			return layout;
+	}
+	return NULL;
+}
+
+/*
+ * Fast path: the frame has the same packets (addresses, lengths and
+ * line masks) as one that was fully validated before.
+ */
+static bool copy_pcm_tospan_cached(xbus_t *xbus, xframe_t *xframe)
+{
+	struct xpp_pcm_layout *layout;
+	xpd_t *xpd;
+	__u8 *p;
+	int i;
+
+	layout = pcm_layout_match(xbus, xframe);
+	if (!layout)
+		return 0;
+	if (unlikely(layout->gen != atomic_read(&xbus->pcm_layout_gen))) {
+		/* Learned before an XPD was unbound */
+		layout->frame_len = 0;
+		return 0;
+	}
+	for (i = 0; i < layout->npacks; i++) {
+		if (unlikely(xbus->xpds[layout->packs[i].xpd_idx] !=
+			     layout->packs[i].xpd)) {
+			/* XPD went away or was replaced. Let the full
+			 * parser validate it. */
+			layout->frame_len = 0;
+			return 0;
+		}
+	}
+	p = xframe->packets;
+	for (i = 0; i < layout->npacks; i++) {
+		xpd = layout->packs[i].xpd;
+		if (SPAN_REGISTERED(xpd)) {
+			XBUS_COUNTER(xbus, RX_PACK_PCM)++;
+			CALL_PHONE_METHOD(card_pcm_tospan, xpd,
+					  (xpacket_t *)p);
+		}
+		p += layout->packs[i].len;
+	}
+	return 1;
+}
+
 static int copy_pcm_tospan(xbus_t *xbus, xframe_t *xframe)
 {
 	__u8 *xframe_end;
 	xpacket_t *pack;
 	__u8 *p;
+	struct xpp_pcm_layout *layout;
+	unsigned int npacks = 0;
 	int ret = -EPROTO;	/* Assume error */
 
 	if (debug & DBG_PCM)
 		dump_xframe("RX_XFRAME_PCM", xbus, xframe, debug);
 	/* handle content */
-
+	if (likely(copy_pcm_tospan_cached(xbus, xframe))) {
+		ret = 0;
+		XBUS_COUNTER(xbus, RX_XFRAME_PCM)++;
+		goto out;
+	}
+	/*
+	 * Parse and validate every packet. If all is well, remember
+	 * the layout, replacing the oldest one.
+	 */
+	layout = &xbus->pcm_layouts[xbus->pcm_layout_next];
+	layout->frame_len = 0;
+	layout->gen = atomic_read(&xbus->pcm_layout_gen);
 	p = xframe->packets;
 	xframe_end = p + XFRAME_LEN(xframe);
 	do {
@@ -1078,6 +1176,16 @@ static int copy_pcm_tospan(xbus_t *xbus, xframe_t *xframe)
 		}
 		if (!pcm_valid(xpd, pack))
 			goto out;
+		if (npacks < XPP_PCM_LAYOUT_PACKS) {
+			layout->packs[npacks].lines =
+			    RPACKET_FIELD(pack, GLOBAL, PCM_READ, lines);
+			layout->packs[npacks].len = len;
+			layout->packs[npacks].xpd_idx =
+			    XPD_IDX(XPACKET_ADDR_UNIT(pack),
+				    XPACKET_ADDR_SUBUNIT(pack));
+			layout->packs[npacks].xpd = xpd;
+		}
+		npacks++;
 		if (SPAN_REGISTERED(xpd)) {
 			XBUS_COUNTER(xbus, RX_PACK_PCM)++;
 			CALL_PHONE_METHOD(card_pcm_tospan, xpd, pack);
@@ -1085,6 +1193,12 @@ static int copy_pcm_tospan(xbus_t *xbus, xframe_t *xframe)
 	} while (p < xframe_end);
 	ret = 0;		/* all good */
 	XBUS_COUNTER(xbus, RX_XFRAME_PCM)++;
+	if (npacks <= XPP_PCM_LAYOUT_PACKS) {
+		layout->npacks = npacks;
+		layout->frame_len = XFRAME_LEN(xframe);
+		xbus->pcm_layout_next =
+		    (xbus->pcm_layout_next + 1) % XPP_PCM_LAYOUTS;
+	}
 out:
 	FREE_RECV_XFRAME(xbus, xframe);
 	return ret;
@@ -1147,6 +1261,7 @@ static void xbus_tick(xbus_t *xbus)
 					pack = NULL;
 #endif
 					if (xframe && !pack) {	/* FULL frame */
+						xframe->tx_more = 1;
 						pcm_frame_out(xbus, xframe);
 						xframe = NULL;
 						XBUS_COUNTER(xbus,
@@ -66,6 +66,10 @@ struct xpp_ticker {		/* for rate calculation */
 	spinlock_t lock;
 };
 
+#define	SYNC_HIST_BUCKETS	16
+#define	SYNC_HIST_OFFSET	64	/* usec per bucket, centered on 0 */
+#define	SYNC_HIST_JITTER	32	/* usec per bucket */
+
 /*
  * xpp_drift represent the measurements of the offset between an
  * xbus ticker to a reference ticker.
@@ -83,11 +87,41 @@ struct xpp_drift {
 	int offset_max;
 	int min_speed;
 	int max_speed;
+	long pi_integral;	/* sum of offsets (PI controller) */
+	long usec_delta_prev;	/* for jitter */
+	/* Histograms, shown in /sys/bus/astribanks/devices/xbus-??/sync_hist */
+	unsigned int offset_hist[SYNC_HIST_BUCKETS];
+	unsigned int jitter_hist[SYNC_HIST_BUCKETS];
+	unsigned int slip_hist[SYNC_HIST_BUCKETS];
 	spinlock_t lock;
 };
 
 void xpp_drift_init(xbus_t *xbus);
 
+/*
+ * Layout of a PCM xframe received from the Astribank, learned from a frame
+ * that passed the full checks in copy_pcm_tospan(). While the configuration
+ * is stable, every PCM frame matches one of a few layouts, and the
+ * per-packet validation can be reduced to comparing against it.
+ * Only touched from the xbus tick. A layout is only good for the XPDs it
+ * was validated against: xbus_xpd_unbind() bumps xbus->pcm_layout_gen to
+ * retire every learned layout, and each pack remembers its xpd.
+ */
+#define	XPP_PCM_LAYOUTS		4
+#define	XPP_PCM_LAYOUT_PACKS	32	/* XFRAME_DATASIZE / smallest packet */
+
+struct xpp_pcm_layout {
+	unsigned int frame_len;		/* 0 - unused */
+	unsigned int npacks;
+	int gen;			/* xbus->pcm_layout_gen when learned */
+	struct {
+		xpd_t *xpd;
+		xpp_line_t lines;
+		__u16 len;
+		__u8 xpd_idx;
+	} packs[XPP_PCM_LAYOUT_PACKS];
+};
+
 static inline long usec_diff(const struct timeval *tv1,
 			     const struct timeval *tv2)
 {
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2026, DAHDI Linux contributors
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+ * The arithmetic of the AB clock adjustment loop in xbus-pcm.c.
+ * It uses nothing from the kernel, so xpp_sync_sim.c can run the
+ * very same code over recorded SAMPLE_TICKS dumps.
+ */
+#ifndef	XBUS_SYNC_H
+#define	XBUS_SYNC_H
+
+/* Sampling cycle in usec */
+#define SYNC_CYCLE		500
+/* Samples from end of SYNC_CYCLE */
+#define SYNC_CYCLE_SAMPLE	100
+/* Number of SYNC_CYCLE's to converge speed */
+#define SYNC_CONVERGE		10
+/* Offset from ref_ticker to other AB's */
+#define SYNC_CENTER		500
+/* If within +/-SYNC_DELTA, try to stay there */
+#define SYNC_DELTA		40
+/* maximal firmware drift unit (hardware limit 63) */
+#define	SYNC_ADJ_MAX		20
+
+/*
+ * The original heuristic: hold around the best speed seen so far while
+ * within +/-SYNC_DELTA, otherwise nudge by one unit if the offset grows.
+ */
+static inline int xpp_sync_legacy_step(int offset, int offset_prev,
+				       int speed, int best_speed)
+{
+	int fix = 0;
+
+	if (offset > 0 && offset < SYNC_DELTA)
+		return best_speed - 1;
+	if (offset < 0 && offset > -SYNC_DELTA)
+		return best_speed + 1;
+	if (offset > 0) {
+		if (offset > offset_prev)
+			fix--;
+	} else {
+		if (offset < offset_prev)
+			fix++;
+	}
+	return speed + fix;
+}
+
+/*
+ * Drift for the next cycle, from the offset (usec) of this cycle.
+ * Gains are in 1/1000 drift units. The integral is clamped so its share
+ * alone cannot exceed SYNC_ADJ_MAX, which keeps it from winding up while
+ * the output is saturated.
+ */
+static inline int xpp_sync_pi_step(long *integral, int offset,
+				   unsigned int kp, unsigned int ki)
+{
+	long limit;
+	long out;
+
+	*integral += offset;
+	if (ki) {
+		limit = (long)SYNC_ADJ_MAX * 1000 / (long)ki;
+		if (*integral > limit)
+			*integral = limit;
+		if (*integral < -limit)
+			*integral = -limit;
+	}
+	out = (long)kp * offset + (long)ki * *integral;
+	/* Positive offset: we are late, slow down */
+	if (out >= 0)
+		return -(int)((out + 500) / 1000);
+	return (int)((-out + 500) / 1000);
+}
+
+/* Integral that makes xpp_sync_pi_step() continue at speed */
+static inline long xpp_sync_pi_seed(int speed, unsigned int ki)
+{
+	return (ki) ? -(long)speed * 1000 / (long)ki : 0;
+}
+
+#endif	/* XBUS_SYNC_H */
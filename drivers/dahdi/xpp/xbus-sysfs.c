@@ -194,6 +194,9 @@ static DEVICE_ATTR_WRITER(cls_store, dev, buf, count)
 	driftinfo = &xbus->drift;
 	driftinfo->lost_ticks = 0;
 	driftinfo->lost_tick_count = 0;
+	memset(driftinfo->offset_hist, 0, sizeof(driftinfo->offset_hist));
+	memset(driftinfo->jitter_hist, 0, sizeof(driftinfo->jitter_hist));
+	memset(driftinfo->slip_hist, 0, sizeof(driftinfo->slip_hist));
 	xbus->min_tx_sync = INT_MAX;
 	xbus->max_tx_sync = 0;
 	xbus->min_rx_sync = INT_MAX;
@@ -291,6 +294,39 @@ static DEVICE_ATTR_READER(driftinfo_show, dev, buf)
 	return len;
 }
 
+/*
+ * Sync histograms (cleared by writing to cls):
+ *   - offset: from the reference ticker, per sampling cycle.
+ *   - jitter: change of that offset between consecutive ticks.
+ *   - slip:   lost ticks, per occurance (1, 2, ... ticks).
+ * The last bucket of each also counts everything above it.
+ */
+static DEVICE_ATTR_READER(sync_hist_show, dev, buf)
+{
+	xbus_t *xbus;
+	struct xpp_drift *di;
+	int len = 0;
+	int i;
+
+	xbus = dev_to_xbus(dev);
+	di = &xbus->drift;
+#define	SHOW_HIST(hist, title, first, step) \
+	do { \
+		len += snprintf(buf + len, PAGE_SIZE - len, \
+			"%-6s (%d%+d):", title, first, step); \
+		for (i = 0; i < SYNC_HIST_BUCKETS; i++) \
+			len += snprintf(buf + len, PAGE_SIZE - len, \
+				" %u", (hist)[i]); \
+		len += snprintf(buf + len, PAGE_SIZE - len, "\n"); \
+	} while (0)
+	SHOW_HIST(di->offset_hist, "offset",
+		  -SYNC_HIST_OFFSET * SYNC_HIST_BUCKETS / 2, SYNC_HIST_OFFSET);
+	SHOW_HIST(di->jitter_hist, "jitter", 0, SYNC_HIST_JITTER);
+	SHOW_HIST(di->slip_hist, "slip", 1, 1);
+#undef	SHOW_HIST
+	return len;
+}
+
 #define xbus_attr(field, format_string)                                    \
 static ssize_t                                                             \
 field##_show(struct device *dev, struct device_attribute *attr, char *buf) \
@@ -311,6 +347,7 @@ static struct device_attribute xbus_dev_attrs[] = {
 	__ATTR_RO(refcount_xbus),
 	__ATTR_RO(waitfor_xpds),
 	__ATTR_RO(driftinfo),
+	__ATTR_RO(sync_hist),
 	__ATTR(cls, S_IWUSR, NULL, cls_store),
 	__ATTR(xbus_state, S_IRUGO | S_IWUSR, xbus_state_show,
 	       xbus_state_store),
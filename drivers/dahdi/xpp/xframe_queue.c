@@ -7,20 +7,54 @@ extern int debug;
 static xframe_t *transport_alloc_xframe(xbus_t *xbus, gfp_t gfp_flags);
 static void transport_free_xframe(xbus_t *xbus, xframe_t *xframe);
 
-void xframe_queue_init(struct xframe_queue *q,
+/*
+ * The ring is the bounded multi-producer/multi-consumer queue described by
+ * Dmitry Vyukov. Each slot carries a sequence number:
+ *  - seq == pos:     the slot is free for the producer that claims pos.
+ *  - seq == pos + 1: the slot holds the frame enqueued at pos.
+ * Producers and consumers claim a position with a cmpxchg on enqueue_pos /
+ * dequeue_pos and then hand the slot over by advancing its seq.
+ *
+ * q->count is reserved before touching the ring, so there are never more
+ * than max_count frames in it, and the ring (a power of two at least that
+ * large) only appears full if a consumer has claimed a slot but not yet
+ * released it.
+ */
+int xframe_queue_init(struct xframe_queue *q,
 	unsigned int steady_state_count, unsigned int max_count,
 	const char *name, void *priv)
 {
+	unsigned int size;
+	unsigned int i;
+
 	memset(q, 0, sizeof(*q));
-	spin_lock_init(&q->lock);
-	INIT_LIST_HEAD(&q->head);
 	q->max_count = XFRAME_QUEUE_MARGIN + max_count;
 	q->steady_state_count = XFRAME_QUEUE_MARGIN + steady_state_count;
 	q->name = name;
 	q->priv = priv;
+	for (size = 1; size < q->max_count; size <<= 1)
+		;
+	q->ring = KZALLOC(size * sizeof(q->ring[0]), GFP_KERNEL);
+	if (!q->ring)
+		return -ENOMEM;
+	q->ring_mask = size - 1;
+	for (i = 0; i < size; i++)
+		atomic_set(&q->ring[i].seq, i);
+	return 0;
 }
 EXPORT_SYMBOL(xframe_queue_init);
 
+/* The queue must have been cleared (xframe_queue_clear) already. */
+void xframe_queue_destroy(struct xframe_queue *q)
+{
+	if (!q->ring)
+		return;
+	WARN_ON(atomic_read(&q->count));
+	kfree(q->ring);
+	q->ring = NULL;
+}
+EXPORT_SYMBOL(xframe_queue_destroy);
+
 void xframe_queue_clearstats(struct xframe_queue *q)
 {
 	q->worst_count = 0;
@@ -29,102 +63,132 @@ void xframe_queue_clearstats(struct xframe_queue *q)
 }
 EXPORT_SYMBOL(xframe_queue_clearstats);
 
-static void __xframe_dump_queue(struct xframe_queue *q)
+static bool __xframe_ring_put(struct xframe_queue *q, xframe_t *xframe)
+{
+	struct xframe_queue_slot *slot;
+	int pos = atomic_read(&q->enqueue_pos);
+	int dif;
+
+	for (;;) {
+		slot = &q->ring[pos & q->ring_mask];
+		dif = atomic_read(&slot->seq) - pos;
+		if (dif == 0) {
+			/* cmpxchg implies a full barrier when it succeeds */
+			if (atomic_cmpxchg(&q->enqueue_pos, pos, pos + 1) == pos)
+				break;
+			pos = atomic_read(&q->enqueue_pos);
+		} else if (dif < 0) {
+			return 0;	/* Full */
+		} else {
+			pos = atomic_read(&q->enqueue_pos);
+		}
+	}
+	slot->xframe = xframe;
+	smp_wmb();
+	atomic_set(&slot->seq, pos + 1);
+	return 1;
+}
+
+static xframe_t *__xframe_ring_get(struct xframe_queue *q)
 {
+	struct xframe_queue_slot *slot;
 	xframe_t *xframe;
-	int i = 0;
-	char prefix[30];
-	struct timeval now;
-
-	do_gettimeofday(&now);
-	printk(KERN_DEBUG "%s: dump queue '%s' (first packet in each frame)\n",
-	       THIS_MODULE->name, q->name);
-	list_for_each_entry_reverse(xframe, &q->head, frame_list) {
-		xpacket_t *pack = (xpacket_t *)&xframe->packets[0];
-		long usec = usec_diff(&now, &xframe->tv_queued);
-		snprintf(prefix, ARRAY_SIZE(prefix), "  %3d> %5ld.%03ld msec",
-			 i++, usec / 1000, usec % 1000);
-		dump_packet(prefix, pack, 1);
+	int pos = atomic_read(&q->dequeue_pos);
+	int dif;
+
+	for (;;) {
+		slot = &q->ring[pos & q->ring_mask];
+		dif = atomic_read(&slot->seq) - (pos + 1);
+		if (dif == 0) {
+			if (atomic_cmpxchg(&q->dequeue_pos, pos, pos + 1) == pos)
+				break;
+			pos = atomic_read(&q->dequeue_pos);
+		} else if (dif < 0) {
+			return NULL;	/* Empty */
+		} else {
+			pos = atomic_read(&q->dequeue_pos);
+		}
 	}
+	xframe = slot->xframe;
+	smp_mb();
+	atomic_set(&slot->seq, pos + q->ring_mask + 1);
+	return xframe;
 }
 
-static bool __xframe_enqueue(struct xframe_queue *q, xframe_t *xframe)
+static void xframe_queue_overflow(struct xframe_queue *q)
 {
-	int ret = 1;
 	static int overflow_cnt;
 
-	if (unlikely(q->disabled)) {
-		ret = 0;
-		goto out;
+	q->overflows++;
+	if ((overflow_cnt++ % 1000) < 5) {
+		NOTICE("Overflow of %-15s: counts %3d, %3d, %3d "
+			"worst %3d, overflows %3d "
+			"worst_lag %02ld.%ld ms\n",
+		     q->name, q->steady_state_count,
+		     atomic_read(&q->count), q->max_count, q->worst_count,
+		     q->overflows, q->worst_lag_usec / 1000,
+		     q->worst_lag_usec % 1000);
 	}
-	if (q->count >= q->max_count) {
-		q->overflows++;
-		if ((overflow_cnt++ % 1000) < 5) {
-			NOTICE("Overflow of %-15s: counts %3d, %3d, %3d "
-				"worst %3d, overflows %3d "
-				"worst_lag %02ld.%ld ms\n",
-			     q->name, q->steady_state_count, q->count,
-			     q->max_count, q->worst_count, q->overflows,
-			     q->worst_lag_usec / 1000,
-			     q->worst_lag_usec % 1000);
-			__xframe_dump_queue(q);
-		}
-		ret = 0;
-		goto out;
+}
+
+/*
+ * A producer announces itself in q->producers before looking at
+ * q->disabled, and xframe_queue_clear() sets q->disabled before looking at
+ * q->producers, with a full barrier on each side. So either the producer
+ * sees the queue disabled, or clear sees the producer and waits for its
+ * frame to land before draining the ring.
+ */
+static bool __xframe_enqueue(struct xframe_queue *q, xframe_t *xframe)
+{
+	unsigned int count;
+
+	if (unlikely(q->disabled))
+		return 0;
+	count = atomic_inc_return(&q->count);
+	if (unlikely(count > q->max_count)) {
+		atomic_dec(&q->count);
+		xframe_queue_overflow(q);
+		return 0;
 	}
-	if (++q->count > q->worst_count)
-		q->worst_count = q->count;
-	list_add_tail(&xframe->frame_list, &q->head);
-	do_gettimeofday(&xframe->tv_queued);
-out:
-	return ret;
+	if (count > q->worst_count)
+		q->worst_count = count;
+	xframe->kt_queued = ktime_get();
+	if (unlikely(!__xframe_ring_put(q, xframe))) {
+		atomic_dec(&q->count);
+		xframe_queue_overflow(q);
+		return 0;
+	}
+	return 1;
 }
 
 bool xframe_enqueue(struct xframe_queue *q, xframe_t *xframe)
 {
-	unsigned long flags;
-	int ret;
+	bool ret;
 
-	spin_lock_irqsave(&q->lock, flags);
+	/* Don't let xframe_queue_clear() on this CPU wait on us. */
+	preempt_disable();
+	atomic_inc(&q->producers);
+	smp_mb();
 	ret = __xframe_enqueue(q, xframe);
-	spin_unlock_irqrestore(&q->lock, flags);
+	smp_mb();
+	atomic_dec(&q->producers);
+	preempt_enable();
 	return ret;
 }
 EXPORT_SYMBOL(xframe_enqueue);
 
-static xframe_t *__xframe_dequeue(struct xframe_queue *q)
+xframe_t *xframe_dequeue(struct xframe_queue *q)
 {
-	xframe_t *frm = NULL;
-	struct list_head *h;
-	struct timeval now;
+	xframe_t *frm;
 	unsigned long usec_lag;
 
-	if (list_empty(&q->head))
-		goto out;
-	h = q->head.next;
-	list_del_init(h);
-	--q->count;
-	frm = list_entry(h, xframe_t, frame_list);
-	do_gettimeofday(&now);
-	usec_lag =
-	    (now.tv_sec - frm->tv_queued.tv_sec) * 1000 * 1000 + (now.tv_usec -
-								  frm->
-								  tv_queued.
-								  tv_usec);
+	frm = __xframe_ring_get(q);
+	if (!frm)
+		return NULL;
+	atomic_dec(&q->count);
+	usec_lag = ktime_to_us(ktime_sub(ktime_get(), frm->kt_queued));
 	if (q->worst_lag_usec < usec_lag)
 		q->worst_lag_usec = usec_lag;
-out:
-	return frm;
-}
-
-xframe_t *xframe_dequeue(struct xframe_queue *q)
-{
-	unsigned long flags;
-	xframe_t *frm;
-
-	spin_lock_irqsave(&q->lock, flags);
-	frm = __xframe_dequeue(q);
-	spin_unlock_irqrestore(&q->lock, flags);
 	return frm;
 }
 EXPORT_SYMBOL(xframe_dequeue);
@@ -142,6 +206,9 @@ void xframe_queue_clear(struct xframe_queue *q)
 	int i = 0;
 
 	xframe_queue_disable(q, 1);
+	smp_mb();
+	while (atomic_read(&q->producers))
+		cpu_relax();
 	while ((xframe = xframe_dequeue(q)) != NULL) {
 		transport_free_xframe(xbus, xframe);
 		i++;
@@ -153,17 +220,22 @@ EXPORT_SYMBOL(xframe_queue_clear);
 
 uint xframe_queue_count(struct xframe_queue *q)
 {
-	return q->count;
+	return atomic_read(&q->count);
 }
 EXPORT_SYMBOL(xframe_queue_count);
 
 /*------------------------- Frame Alloc/Dealloc --------------------*/
 
+/*
+ * The transport reference taken here keeps the transport around for the
+ * allocation, and the transports' allocators may be called concurrently.
+ * transport.lock is not held, so that callers in process context can
+ * allocate with GFP_KERNEL.
+ */
 static xframe_t *transport_alloc_xframe(xbus_t *xbus, gfp_t gfp_flags)
 {
 	struct xbus_ops *ops;
 	xframe_t *xframe;
-	unsigned long flags;
 
 	BUG_ON(!xbus);
 	ops = transportops_get(xbus);
@@ -171,7 +243,6 @@ static xframe_t *transport_alloc_xframe(xbus_t *xbus, gfp_t gfp_flags)
 		XBUS_ERR(xbus, "Missing transport\n");
 		return NULL;
 	}
-	spin_lock_irqsave(&xbus->transport.lock, flags);
 #if 0
 	XBUS_INFO(xbus, "%s (transport_refcount=%d)\n",
 		__func__, atomic_read(&xbus->transport.transport_refcount));
@@ -187,7 +258,6 @@ static xframe_t *transport_alloc_xframe(xbus_t *xbus, gfp_t gfp_flags)
 		transportops_put(xbus);
 		/* fall through */
 	}
-	spin_unlock_irqrestore(&xbus->transport.lock, flags);
 	return xframe;
 }
 
@@ -209,19 +279,21 @@ static void transport_free_xframe(xbus_t *xbus, xframe_t *xframe)
 	spin_unlock_irqrestore(&xbus->transport.lock, flags);
 }
 
+/*
+ * Keep a pool queue close to its steady state size. The transport
+ * allocation and free happen outside of any queue lock, so a pool that is
+ * being refilled does not hold up other users of the queue.
+ */
 static bool xframe_queue_adjust(struct xframe_queue *q)
 {
 	xbus_t *xbus;
 	xframe_t *xframe;
 	int delta;
-	unsigned long flags;
-	int ret = 0;
 
 	BUG_ON(!q);
 	xbus = q->priv;
 	BUG_ON(!xbus);
-	spin_lock_irqsave(&q->lock, flags);
-	delta = q->count - q->steady_state_count;
+	delta = (int)atomic_read(&q->count) - (int)q->steady_state_count;
 	if (delta < -XFRAME_QUEUE_MARGIN) {
 		/* Increase pool by one frame */
 		//XBUS_INFO(xbus, "%s(%d): Allocate one\n", q->name, delta);
@@ -232,36 +304,56 @@ static bool xframe_queue_adjust(struct xframe_queue *q)
 			if ((rate_limit++ % 3001) == 0)
 				XBUS_ERR(xbus, "%s: failed frame allocation\n",
 					 q->name);
-			goto out;
+			return 0;
 		}
-		if (!__xframe_enqueue(q, xframe)) {
+		if (!xframe_enqueue(q, xframe)) {
 			static int rate_limit;
 
 			if ((rate_limit++ % 3001) == 0)
 				XBUS_ERR(xbus, "%s: failed enqueueing frame\n",
 					 q->name);
 			transport_free_xframe(xbus, xframe);
-			goto out;
+			return 0;
 		}
 	} else if (delta > XFRAME_QUEUE_MARGIN) {
 		/* Decrease pool by one frame */
 		//XBUS_INFO(xbus, "%s(%d): Free one\n", q->name, delta);
-		xframe = __xframe_dequeue(q);
+		xframe = xframe_dequeue(q);
 		if (!xframe) {
 			static int rate_limit;
 
 			if ((rate_limit++ % 3001) == 0)
 				XBUS_ERR(xbus, "%s: failed dequeueing frame\n",
 					 q->name);
-			goto out;
+			return 0;
 		}
 		transport_free_xframe(xbus, xframe);
 	}
-	ret = 1;
-out:
-	spin_unlock_irqrestore(&q->lock, flags);
-	return ret;
+	return 1;
+}
+
+/*
+ * Preallocate a pool queue up to its steady state size, so the first
+ * get_xframe() calls on the PCM path find frames waiting instead of going
+ * to the transport one frame at a time. Called from process context.
+ */
+void xframe_queue_fill(struct xframe_queue *q)
+{
+	xbus_t *xbus = q->priv;
+	xframe_t *xframe;
+
+	might_sleep();
+	while (xframe_queue_count(q) < q->steady_state_count) {
+		xframe = transport_alloc_xframe(xbus, GFP_KERNEL);
+		if (!xframe)
+			break;
+		if (!xframe_enqueue(q, xframe)) {
+			transport_free_xframe(xbus, xframe);
+			break;
+		}
+	}
 }
+EXPORT_SYMBOL(xframe_queue_fill);
 
 xframe_t *get_xframe(struct xframe_queue *q)
 {
@@ -283,6 +375,7 @@ xframe_t *get_xframe(struct xframe_queue *q)
 	}
 	BUG_ON(xframe->xframe_magic != XFRAME_MAGIC);
 	atomic_set(&xframe->frame_len, 0);
+	xframe->tx_more = 0;
 	xframe->first_free = xframe->packets;
 	do_gettimeofday(&xframe->tv_created);
 	/*
@@ -7,13 +7,29 @@
 
 #define	XFRAME_QUEUE_MARGIN	10
 
+/*
+ * A bounded queue of xframes.
+ *
+ * Enqueue and dequeue do not take a lock: the frames are kept in a ring of
+ * slots, each carrying a sequence number that tells producers and consumers
+ * whether the slot is free or full (see xframe_queue.c). Any number of
+ * producers and consumers may use a queue concurrently, from any context.
+ */
+struct xframe_queue_slot {
+	atomic_t seq;
+	xframe_t *xframe;
+};
+
 struct xframe_queue {
-	struct list_head head;
+	struct xframe_queue_slot *ring;
+	unsigned int ring_mask;
+	atomic_t enqueue_pos;
+	atomic_t dequeue_pos;
+	atomic_t count;
+	atomic_t producers;	/* xframe_enqueue() calls in flight */
 	bool disabled;
-	unsigned int count;
 	unsigned int max_count;
 	unsigned int steady_state_count;
-	spinlock_t lock;
 	const char *name;
 	void *priv;
 	/* statistics */
@@ -22,13 +38,15 @@ struct xframe_queue {
 	unsigned long worst_lag_usec;	/* since xframe creation */
 };
 
-void xframe_queue_init(struct xframe_queue *q, unsigned int steady_state_count,
-		       unsigned int max_count, const char *name, void *priv);
+int xframe_queue_init(struct xframe_queue *q, unsigned int steady_state_count,
+		      unsigned int max_count, const char *name, void *priv);
+void xframe_queue_destroy(struct xframe_queue *q);
 __must_check bool xframe_enqueue(struct xframe_queue *q, xframe_t *xframe);
 __must_check xframe_t *xframe_dequeue(struct xframe_queue *q);
 void xframe_queue_clearstats(struct xframe_queue *q);
 void xframe_queue_disable(struct xframe_queue *q, bool disabled);
 void xframe_queue_clear(struct xframe_queue *q);
 uint xframe_queue_count(struct xframe_queue *q);
+void xframe_queue_fill(struct xframe_queue *q);
 
 #endif /* XFRAME_QUEUE_ */
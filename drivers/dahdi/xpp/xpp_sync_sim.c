@@ -0,0 +1,348 @@
+/*
+ * Replay recorded tick offsets through the AB clock adjustment loop
+ *
+ * Copyright (C) 2026, DAHDI Linux contributors
+ *
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+  NOTE: This is a userspace program, it is not part of any module.
+  It runs the controllers of xbus-sync.h (the legacy heuristic and the
+  sync_pi loop) against a model of one Astribank, driven by offsets
+  recorded with SAMPLE_TICKS. From this directory:
+
+    cc -O2 -Wall -o xpp_sync_sim xpp_sync_sim.c -lm
+    cat /sys/bus/astribanks/devices/xbus-00/samples > xbus-00.samples
+    ./xpp_sync_sim [options] xbus-00.samples
+
+  The dump is one usec_delta per line. Its linear trend is taken as the
+  natural rate of the AB against the reference at the drift it had while
+  recording (-s), and what is left over as the jitter, which is replayed
+  cyclically for as long as the simulation runs. Each tick the offset
+  moves by that rate plus -g usec per drift unit. The sampling, cycle
+  and tick slip handling follow xpp_drift_step().
+
+  -g is a property of the hardware. Measure it from two dumps taken at
+  different fixed drifts: the difference of the reported trends divided
+  by the difference of the drifts.
+
+  The exit status is non-zero if the controller under test (-p for the
+  PI loop, default the legacy one) slips a tick after the first -w
+  cycles, or leaves +/-SYNC_DELTA outside the first -w cycles after the
+  start and after a master change.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "xbus-sync.h"
+
+#define	TICK_USEC	1000	/* one DAHDI tick */
+
+struct master_change {
+	long tick;
+	double jump;		/* usec added to the offset */
+	double rate;		/* new natural rate, usec per tick */
+};
+
+struct sim_params {
+	double gain;		/* usec per tick per drift unit */
+	double rate;		/* natural rate, usec per tick */
+	double start;		/* offset at tick 0 */
+	long ticks;
+	int warmup;		/* cycles excluded from the verdict */
+	unsigned int kp;
+	unsigned int ki;
+	struct master_change change;
+};
+
+struct sim_result {
+	long slips;
+	long slips_after_warmup;
+	long cycles;
+	long last_unsettled;	/* last cycle with |offset| >= SYNC_DELTA */
+	long unsettled;		/* such cycles outside the warmups */
+	long change_settled;	/* cycles from master change to settled */
+	int max_offset;		/* after warmup */
+	double rms_offset;	/* after warmup */
+	int min_speed_seen;
+	int max_speed_seen;
+	int final_speed;
+};
+
+static double *jitter;
+static long njitter;
+
+static int read_samples(FILE *f, double *slope, double *intercept)
+{
+	long cap = 1024;
+	double sx = 0, sy = 0, sxx = 0, sxy = 0;
+	double v;
+	long i;
+
+	jitter = malloc(cap * sizeof(*jitter));
+	if (!jitter)
+		return -1;
+	while (fscanf(f, "%lf", &v) == 1) {
+		if (njitter == cap) {
+			cap *= 2;
+			jitter = realloc(jitter, cap * sizeof(*jitter));
+			if (!jitter)
+				return -1;
+		}
+		jitter[njitter++] = v;
+	}
+	if (njitter < 2)
+		return -1;
+	for (i = 0; i < njitter; i++) {
+		sx += i;
+		sy += jitter[i];
+		sxx += (double)i * i;
+		sxy += i * jitter[i];
+	}
+	*slope = (njitter * sxy - sx * sy) / (njitter * sxx - sx * sx);
+	*intercept = (sy - *slope * sx) / njitter;
+	for (i = 0; i < njitter; i++)
+		jitter[i] -= *intercept + *slope * i;
+	return 0;
+}
+
+static void simulate(const struct sim_params *p, int use_pi,
+		     struct sim_result *r)
+{
+	double offset = p->start;
+	double rate = p->rate;
+	long delta_sum = 0;
+	long pi_integral = xpp_sync_pi_seed(0, p->ki);
+	int offset_prev = 0;
+	int speed = 0;
+	int max_speed = -SYNC_ADJ_MAX;
+	int min_speed = SYNC_ADJ_MAX;
+	long change_cycle = -1;
+	double sumsq = 0;
+	long nsq = 0;
+	long count;
+
+	memset(r, 0, sizeof(*r));
+	r->last_unsettled = -1;
+	r->change_settled = -1;
+	r->min_speed_seen = SYNC_ADJ_MAX;
+	r->max_speed_seen = -SYNC_ADJ_MAX;
+	for (count = 1; count <= p->ticks; count++) {
+		long usec_delta;
+
+		if (p->change.tick && count == p->change.tick) {
+			/* update_sync_master() -> xbus_drift_clear() */
+			offset += p->change.jump;
+			rate = p->change.rate;
+			max_speed = -SYNC_ADJ_MAX;
+			min_speed = SYNC_ADJ_MAX;
+			pi_integral = xpp_sync_pi_seed(speed, p->ki);
+			change_cycle = count / SYNC_CYCLE;
+		}
+		offset += rate + p->gain * speed;
+		usec_delta = lround(offset + jitter[count % njitter]);
+		if (usec_delta < 0 || usec_delta >= TICK_USEC) {
+			/*
+			 * The AB tick crossed a reference tick: the kernel
+			 * sees a lost tick and skips this sample.
+			 */
+			offset += (usec_delta < 0) ? TICK_USEC : -TICK_USEC;
+			r->slips++;
+			if (count / SYNC_CYCLE >= p->warmup)
+				r->slips_after_warmup++;
+			continue;
+		}
+		if ((count % SYNC_CYCLE) > (SYNC_CYCLE - SYNC_CYCLE_SAMPLE))
+			delta_sum += usec_delta;
+		if ((count % SYNC_CYCLE) == 0) {
+			int cycle_offset =
+			    delta_sum / SYNC_CYCLE_SAMPLE - SYNC_CENTER;
+			int best_speed = (max_speed + min_speed) >> 1;
+			long cycle = count / SYNC_CYCLE;
+
+			if (use_pi)
+				speed = xpp_sync_pi_step(&pi_integral,
+					cycle_offset, p->kp, p->ki);
+			else
+				speed = xpp_sync_legacy_step(cycle_offset,
+					offset_prev, speed, best_speed);
+			if (speed < -SYNC_ADJ_MAX)
+				speed = -SYNC_ADJ_MAX;
+			if (speed > SYNC_ADJ_MAX)
+				speed = SYNC_ADJ_MAX;
+			if (speed < min_speed)
+				min_speed = speed;
+			if (speed > max_speed)
+				max_speed = speed;
+			if (count >= SYNC_CYCLE * SYNC_CONVERGE) {
+				if (max_speed > best_speed)
+					max_speed--;
+				if (min_speed < best_speed)
+					min_speed++;
+			}
+			offset_prev = cycle_offset;
+			delta_sum = 0;
+
+			r->cycles = cycle;
+			if (abs(cycle_offset) >= SYNC_DELTA) {
+				r->last_unsettled = cycle;
+				if (cycle >= p->warmup && (change_cycle < 0 ||
+				    cycle - change_cycle >= p->warmup))
+					r->unsettled++;
+				if (change_cycle >= 0)
+					r->change_settled = -1;
+			} else if (change_cycle >= 0 &&
+				   r->change_settled < 0) {
+				r->change_settled = cycle - change_cycle;
+			}
+			if (cycle >= p->warmup) {
+				if (abs(cycle_offset) > r->max_offset)
+					r->max_offset = abs(cycle_offset);
+				sumsq += (double)cycle_offset * cycle_offset;
+				nsq++;
+				if (speed < r->min_speed_seen)
+					r->min_speed_seen = speed;
+				if (speed > r->max_speed_seen)
+					r->max_speed_seen = speed;
+			}
+		}
+	}
+	r->rms_offset = (nsq) ? sqrt(sumsq / nsq) : 0;
+	r->final_speed = speed;
+}
+
+static void print_result(const char *name, const struct sim_result *r)
+{
+	printf("%-7s slips %ld (%ld after warmup)  settled at cycle %ld",
+	       name, r->slips, r->slips_after_warmup, r->last_unsettled + 1);
+	if (r->change_settled >= 0)
+		printf(" (%ld after master change)", r->change_settled);
+	printf("\n        %ld cycles off by SYNC_DELTA or more after warmup\n",
+	       r->unsettled);
+	printf("        offset max %d rms %.1f usec  speed %d..%d "
+	       "final %d\n", r->max_offset, r->rms_offset,
+	       r->min_speed_seen, r->max_speed_seen, r->final_speed);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options] [samples]\n"
+		"  -g GAIN   usec per tick per drift unit (default 0.01)\n"
+		"  -s DRIFT  drift of the AB while recording (default 0)\n"
+		"  -o USEC   start offset from SYNC_CENTER (default: "
+		"from the dump)\n"
+		"  -n TICKS  ticks to simulate (default 600000)\n"
+		"  -w CYCLES cycles excluded from the verdict (default 60)\n"
+		"  -k KP -i KI  sync_pi_kp and sync_pi_ki (default 40 8)\n"
+		"  -m TICK:JUMP:RATE  change master at TICK: add JUMP usec\n"
+		"            and run at RATE usec per tick from there on\n"
+		"  -p        the verdict is on the PI loop, not the legacy one\n",
+		prog);
+	exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+	struct sim_params p = {
+		.gain = 0.01,
+		.ticks = 600000,
+		.warmup = 60,
+		.kp = 40,
+		.ki = 8,
+	};
+	struct sim_result legacy, pi;
+	const struct sim_result *verdict;
+	double slope, intercept;
+	double start = NAN;
+	int drift = 0;
+	int check_pi = 0;
+	FILE *f = stdin;
+	int c;
+
+	while ((c = getopt(argc, argv, "g:s:o:n:w:k:i:m:p")) != -1) {
+		switch (c) {
+		case 'g':
+			p.gain = atof(optarg);
+			break;
+		case 's':
+			drift = atoi(optarg);
+			break;
+		case 'o':
+			start = atof(optarg);
+			break;
+		case 'n':
+			p.ticks = atol(optarg);
+			break;
+		case 'w':
+			p.warmup = atoi(optarg);
+			break;
+		case 'k':
+			p.kp = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			p.ki = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			if (sscanf(optarg, "%ld:%lf:%lf", &p.change.tick,
+				   &p.change.jump, &p.change.rate) != 3)
+				usage(argv[0]);
+			break;
+		case 'p':
+			check_pi = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind < argc) {
+		f = fopen(argv[optind], "r");
+		if (!f) {
+			perror(argv[optind]);
+			return 2;
+		}
+	}
+	if (read_samples(f, &slope, &intercept) < 0) {
+		fprintf(stderr, "Need at least two samples\n");
+		return 2;
+	}
+	/* The dump was taken while running at drift */
+	p.rate = slope - p.gain * drift;
+	p.start = (isnan(start)) ? intercept : SYNC_CENTER + start;
+	printf("%ld samples: trend %+.4f usec/tick at drift %d, "
+	       "natural rate %+.4f, start %.0f usec\n",
+	       njitter, slope, drift, p.rate, p.start);
+
+	simulate(&p, 0, &legacy);
+	simulate(&p, 1, &pi);
+	print_result("legacy", &legacy);
+	print_result("pi", &pi);
+
+	verdict = (check_pi) ? &pi : &legacy;
+	if (verdict->slips_after_warmup || verdict->unsettled ||
+	    (p.change.tick && verdict->change_settled < 0)) {
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
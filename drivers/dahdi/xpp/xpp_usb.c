@@ -82,6 +82,15 @@ static DEF_PARM(uint, drop_pcm_after, 6, 0644,
 	usb_buffer_free(dev, size, addr, dma)
 #endif
 
+/*
+ * In-flight URBs are tracked on usb_anchor lists, so disconnect can kill
+ * them instead of leaving them to the USB core. Older kernels lack anchors
+ * (or usb_unanchor_urb), and rely on the pending_* counters only.
+ */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 27)
+#define	XUSB_HAVE_ANCHORS
+#endif
+
 #ifdef	DEBUG_PCM_TIMING
 static cycles_t stamp_last_pcm_read;
 static cycles_t accumulate_diff;
@@ -186,6 +195,10 @@ struct xusb {
 	int present;		/* if the device is not disconnected */
 	atomic_t pending_writes;	/* submited but not out yet */
 	atomic_t pending_reads;	/* submited but not in yet */
+#ifdef	XUSB_HAVE_ANCHORS
+	struct usb_anchor tx_anchor;	/* submitted send URBs */
+	struct usb_anchor rx_anchor;	/* submitted receive URBs */
+#endif
 	struct semaphore sem;	/* locks this structure */
 	int counters[XUSB_COUNTER_MAX];
 
@@ -236,6 +249,14 @@ static const struct file_operations xusb_read_proc_ops;
 
 /*------------------------------------------------------------------*/
 
+#ifdef	XUSB_HAVE_ANCHORS
+#define	xusb_anchor_urb(urb, anchor)	usb_anchor_urb(urb, anchor)
+#define	xusb_unanchor_urb(urb)		usb_unanchor_urb(urb)
+#else
+#define	xusb_anchor_urb(urb, anchor)	do { } while (0)
+#define	xusb_unanchor_urb(urb)		do { } while (0)
+#endif
+
 /*
  * Updates the urb+xframe metadata from the uframe information.
  */
@@ -368,11 +389,20 @@ static int do_send_xframe(xbus_t *xbus, xframe_t *xframe)
 	BUG_ON(!urb);
 	/* update urb length */
 	urb->transfer_buffer_length = XFRAME_LEN(xframe);
+	/*
+	 * When the PCM of one tick spans several frames, only the last
+	 * one needs to interrupt us. The host controller completes the
+	 * others together with it.
+	 */
+	if (xframe->tx_more)
+		urb->transfer_flags |= URB_NO_INTERRUPT;
 	do_gettimeofday(&xframe->tv_submitted);
+	xusb_anchor_urb(urb, &xusb->tx_anchor);
 	ret = usb_submit_urb(urb, GFP_ATOMIC);
 	if (ret < 0) {
 		static int rate_limit;
 
+		xusb_unanchor_urb(urb);
 		if ((rate_limit++ % 1000) == 0)
 			XBUS_ERR(xbus, "%s: usb_submit_urb failed: %d\n",
 				 __func__, ret);
@@ -437,10 +467,12 @@ static bool xusb_listen(xusb_t *xusb)
 	}
 	uframe = xframe_to_uframe(xframe);
 	uframe_recompute(uframe, XUSB_RECV);
+	xusb_anchor_urb(&uframe->urb, &xusb->rx_anchor);
 	ret = usb_submit_urb(&uframe->urb, GFP_ATOMIC);
 	if (ret < 0) {
 		static int rate_limit;
 
+		xusb_unanchor_urb(&uframe->urb);
 		if ((rate_limit++ % 1000) == 0)
 			XBUS_ERR(xbus, "%s: usb_submit_urb failed: %d\n",
 				 __func__, ret);
@@ -673,6 +705,10 @@ static int xusb_probe(struct usb_interface *interface,
 	sema_init(&xusb->sem, 1);
 	atomic_set(&xusb->pending_writes, 0);
 	atomic_set(&xusb->pending_reads, 0);
+#ifdef	XUSB_HAVE_ANCHORS
+	init_usb_anchor(&xusb->tx_anchor);
+	init_usb_anchor(&xusb->rx_anchor);
+#endif
 	atomic_set(&xusb->pcm_tx_drops, 0);
 	atomic_set(&xusb->usb_sluggish_count, 0);
 	xusb->udev = udev;
@@ -831,6 +867,18 @@ static void xusb_disconnect(struct usb_interface *interface)
 			 "Remove proc_entry: " PROC_USBXPP_SUMMARY "\n");
 		remove_proc_entry(PROC_USBXPP_SUMMARY, xbus->proc_xbus_dir);
 	}
+#endif
+#ifdef	XUSB_HAVE_ANCHORS
+	/*
+	 * Return in-flight frames to their pools before the
+	 * xbus clears them: receive URBs are killed right away,
+	 * sends get a short grace period to drain.
+	 */
+	usb_kill_anchored_urbs(&xusb->rx_anchor);
+	if (!usb_wait_anchor_empty_timeout(&xusb->tx_anchor, 1000))
+		XUSB_NOTICE(xusb, "Killing %d stuck send URBs\n",
+			    atomic_read(&xusb->pending_writes));
+	usb_kill_anchored_urbs(&xusb->tx_anchor);
 #endif
 	xbus_disconnect(xbus);	// Blocking until fully deactivated!
 
@@ -0,0 +1,159 @@
+/*
+ * Moving audio between a board's DMA frames and the channels' chunks
+ *
+ * Copyright (C) 2026, DAHDI Linux contributors
+ *
+ * All rights reserved.
+ *
+ */
+
+/*
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2 as published by the
+ * Free Software Foundation. See the LICENSE file included with
+ * this program for more details.
+ */
+
+/*
+ * Included by dahdi/kernel.h once struct dahdi_chan, struct dahdi_span and
+ * DAHDI_CHUNKSIZE are defined. It needs nothing else, so the helpers can be
+ * built and checked in userspace; see drivers/dahdi/interleave-test.c.
+ */
+
+#ifndef _DAHDI_INTERLEAVE_H
+#define _DAHDI_INTERLEAVE_H
+
+/*
+ * Helpers for moving audio between a DMA frame and the channels' chunks.
+ *
+ * Most boards lay a chunk out as DAHDI_CHUNKSIZE frames of frame_stride
+ * bytes each, with a channel's sample at the same offset in every frame.
+ * Walking the channels in the outer loop means each channel pointer is
+ * loaded once per chunk, and each chunk is written or read contiguously.
+ */
+static inline void
+dahdi_tdm_gather_chunk(u8 *chunk, const u8 *frame, unsigned int frame_stride)
+{
+#if (DAHDI_CHUNKSIZE == 8)
+	chunk[0] = frame[frame_stride * 0];
+	chunk[1] = frame[frame_stride * 1];
+	chunk[2] = frame[frame_stride * 2];
+	chunk[3] = frame[frame_stride * 3];
+	chunk[4] = frame[frame_stride * 4];
+	chunk[5] = frame[frame_stride * 5];
+	chunk[6] = frame[frame_stride * 6];
+	chunk[7] = frame[frame_stride * 7];
+#else
+	int j;
+	for (j = 0; j < DAHDI_CHUNKSIZE; ++j)
+		chunk[j] = frame[frame_stride * j];
+#endif
+}
+
+static inline void
+dahdi_tdm_scatter_chunk(u8 *frame, const u8 *chunk, unsigned int frame_stride)
+{
+#if (DAHDI_CHUNKSIZE == 8)
+	frame[frame_stride * 0] = chunk[0];
+	frame[frame_stride * 1] = chunk[1];
+	frame[frame_stride * 2] = chunk[2];
+	frame[frame_stride * 3] = chunk[3];
+	frame[frame_stride * 4] = chunk[4];
+	frame[frame_stride * 5] = chunk[5];
+	frame[frame_stride * 6] = chunk[6];
+	frame[frame_stride * 7] = chunk[7];
+#else
+	int j;
+	for (j = 0; j < DAHDI_CHUNKSIZE; ++j)
+		frame[frame_stride * j] = chunk[j];
+#endif
+}
+
+/**
+ * dahdi_tdm_deinterleave() - Fill the readchunks of a run of channels.
+ * @chans:		The channels, in timeslot order.
+ * @nchans:		Number of channels in @chans.
+ * @frame:		The first channel's byte in the first frame.
+ * @chan_stride:	Bytes between adjacent channels in a frame.
+ * @frame_stride:	Bytes between successive frames.
+ */
+static inline void
+dahdi_tdm_deinterleave(struct dahdi_chan *const *chans, int nchans,
+		       const u8 *frame, unsigned int chan_stride,
+		       unsigned int frame_stride)
+{
+	int i;
+	for (i = 0; i < nchans; ++i, frame += chan_stride)
+		dahdi_tdm_gather_chunk(chans[i]->readchunk, frame, frame_stride);
+}
+
+/**
+ * dahdi_tdm_interleave() - Copy the writechunks of a run of channels out.
+ *
+ * The counterpart of dahdi_tdm_deinterleave().
+ */
+static inline void
+dahdi_tdm_interleave(u8 *frame, struct dahdi_chan *const *chans, int nchans,
+		     unsigned int chan_stride, unsigned int frame_stride)
+{
+	int i;
+	for (i = 0; i < nchans; ++i, frame += chan_stride)
+		dahdi_tdm_scatter_chunk(frame, chans[i]->writechunk, frame_stride);
+}
+
+/**
+ * dahdi_tdm_deinterleave_span() - Fill the readchunks of a whole span.
+ *
+ * Like dahdi_tdm_deinterleave() for span->chans, but writes straight into
+ * span->rxchunks when the span has them.
+ */
+static inline void
+dahdi_tdm_deinterleave_span(struct dahdi_span *span, const u8 *frame,
+			    unsigned int chan_stride, unsigned int frame_stride)
+{
+	u8 *chunk = span->rxchunks;
+	int i;
+
+	if (!chunk) {
+		dahdi_tdm_deinterleave(span->chans, span->channels, frame,
+				       chan_stride, frame_stride);
+		return;
+	}
+	for (i = 0; i < span->channels; ++i) {
+		dahdi_tdm_gather_chunk(chunk, frame, frame_stride);
+		chunk += DAHDI_CHUNKSIZE;
+		frame += chan_stride;
+	}
+}
+
+/**
+ * dahdi_tdm_interleave_span() - Copy the writechunks of a whole span out.
+ *
+ * The counterpart of dahdi_tdm_deinterleave_span().
+ */
+static inline void
+dahdi_tdm_interleave_span(u8 *frame, struct dahdi_span *span,
+			  unsigned int chan_stride, unsigned int frame_stride)
+{
+	const u8 *chunk = span->txchunks;
+	int i;
+
+	if (!chunk) {
+		dahdi_tdm_interleave(frame, span->chans, span->channels,
+				     chan_stride, frame_stride);
+		return;
+	}
+	for (i = 0; i < span->channels; ++i) {
+		dahdi_tdm_scatter_chunk(frame, chunk, frame_stride);
+		chunk += DAHDI_CHUNKSIZE;
+		frame += chan_stride;
+	}
+}
+
+#endif /* _DAHDI_INTERLEAVE_H */
@@ -43,6 +43,7 @@
 #include <linux/cdev.h>
 #include <linux/module.h>
 #include <linux/ioctl.h>
+#include <linux/cache.h>
 
 #ifdef CONFIG_DAHDI_NET	
 #include <linux/hdlc.h>
@@ -413,44 +414,22 @@ struct dahdi_chan {
 	/*! \note Must be first */
 	struct dahdi_hdlc *hdlcnetdev;
 #endif
-#ifdef CONFIG_DAHDI_PPP
-	struct ppp_channel *ppp;
-	struct tasklet_struct ppp_calls;
-	int do_ppp_wakeup;
-	int do_ppp_error;
-	struct sk_buff_head ppp_rq;
-#endif
-#ifdef BUFFER_DEBUG
-	int statcount;
-	int lastnumbufs;
-#endif
+	/*
+	 * The members up to the 'Cold' marker are the ones the tick
+	 * (receive, transmit, echo cancel and RBS timers) touches for every
+	 * channel. They are kept together so the tick's working set per
+	 * channel is a few cache lines rather than the whole structure.
+	 */
 	spinlock_t lock;
-	char name[40];
-	/* Specified by DAHDI */
-	/*! \brief DAHDI channel number */
-	int channo;
-	int chanpos;
 	unsigned long flags;
-	long rxp1;
-	long rxp2;
-	long rxp3;
-	int txtone;
-	int tx_v2;
-	int tx_v3;
-	int v1_1;
-	int v2_1;
-	int v3_1;
-	int toneflags;
-	struct sf_detect_state rd;
 
 	struct dahdi_chan *master;	/*!< Our Master channel (could be us) */
 	/*! \brief Next slave (if appropriate) */
 	struct dahdi_chan *nextslave;
+	struct dahdi_span	*span;			/*!< Span we're a member of */
 
 	u_char *writechunk;						/*!< Actual place to write to */
-	u_char swritechunk[DAHDI_MAX_CHUNKSIZE];	/*!< Buffer to be written */
 	u_char *readchunk;						/*!< Actual place to read from */
-	u_char sreadchunk[DAHDI_MAX_CHUNKSIZE];	/*!< Preallocated static area */
 	short *readchunkpreec;
 
 	/* Channel from which to read when DACSed. */
@@ -459,23 +438,32 @@ struct dahdi_chan {
 	/*! Pointer to tx and rx gain tables */
 	const u_char *rxgain;
 	const u_char *txgain;
-	
-	/* Specified by driver, readable by DAHDI */
-	void *pvt;			/*!< Private channel data */
-	struct file *file;	/*!< File structure */
-	
-	
-#ifdef CONFIG_DAHDI_MIRROR
-	struct dahdi_chan	*rxmirror;  /*!< channel we mirror reads to */
-	struct dahdi_chan	*txmirror;  /*!< channel we mirror writes to */
-	struct dahdi_chan	*srcmirror; /*!< channel we mirror from */
-#endif /* CONFIG_DAHDI_MIRROR */
-	struct dahdi_span	*span;			/*!< Span we're a member of */
+
+	/*! The state data of the echo canceler instance in use */
+	struct dahdi_echocan_state *ec_state;
+
+	short *xlaw;
+#ifdef CONFIG_CALC_XLAW
+	unsigned char (*lineartoxlaw)(short a);
+#else
+	unsigned char *lin2x;
+#endif
 	int		sig;			/*!< Signalling */
-	int		sigcap;			/*!< Capability for signalling */
-	__u32		chan_alarms;		/*!< alarms status */
+#ifdef	OPTIMIZE_CHANMUTE
+	int chanmute;		/*!< no need for PCM data */
+#endif
 
-	wait_queue_head_t waitq;
+	/* Conferencing stuff */
+	int		confna;	/*! conference number (alias) */
+	int		_confn;	/*! Actual conference number */
+	int		confmode;  /*! conference mode */
+	int		confmute; /*! conference mute mode */
+	struct dahdi_chan *conf_chan;
+	int		conf_energy;	/*! smoothed mean amplitude talked */
+	int		conf_hangover;	/*! chunks left before it counts as silent */
+	int		conf_silent;	/*! added nothing to the conference this chunk */
+
+	struct dahdi_chan_stats	stats;	/*! I/O error counters, see sysfs */
 
 	/* Used only by DAHDI -- NO DRIVER SERVICEABLE PARTS BELOW */
 	/* Buffer declarations */
@@ -489,10 +477,6 @@ struct dahdi_chan {
 	
 	int		blocksize;	/*!< Block size */
 
-	int		eventinidx;  /*!< out index in event buf (circular) */
-	int		eventoutidx;  /*!< in index in event buf (circular) */
-	unsigned int	eventbuf[DAHDI_MAX_EVENTSIZE];  /*!< event circ. buffer */
-	
 	int		readn[DAHDI_MAX_NUM_BUFS];  /*!< # of bytes ready in read buf */
 	int		readidx[DAHDI_MAX_NUM_BUFS];  /*!< current read pointer */
 	int		writen[DAHDI_MAX_NUM_BUFS];  /*!< # of bytes ready in write buf */
@@ -503,40 +487,61 @@ struct dahdi_chan {
 	int		txdisable;				/*!< Disable transmitter */
 	
 	/* Tone zone stuff */
-	struct dahdi_zone *curzone;		/*!< Zone for selecting tones */
 	struct dahdi_tone *curtone;		/*!< Current tone we're playing (if any) */
 	int		tonep;					/*!< Current position in tone */
 	struct dahdi_tone_state ts;		/*!< Tone state */
 
-	/* Pulse dial stuff */
-	int	pdialcount;			/*!< pulse dial count */
-
-	/*! Ring cadence */
-	int ringcadence[DAHDI_MAX_CADENCE];
-	int firstcadencepos;				/*!< Where to restart ring cadence */
-
 	/* Digit string dialing stuff */
 	int		digitmode;			/*!< What kind of tones are we sending? */
-	char	txdialbuf[DAHDI_MAX_DTMF_BUF];
 	int 	dialing;
 	int	afterdialingtimer;
 	int		cadencepos;				/*!< Where in the cadence we are */
 
-	/* I/O Mask */	
-	unsigned int iomask;  /*! I/O Mux signal mask */
+	/* Pulse dial stuff */
+	int	pdialcount;			/*!< pulse dial count */
+
+	/*! RING debounce timer */
+	int	ringdebtimer;
+	
+	/*! RING trailing detector to make sure a RING is really over */
+	int ringtrailer;
+
+	/* PULSE digit receiver stuff */
+	int	pulsecount;
+	int	pulsetimer;
+
+	/* RBS timers */
+	int 	itimerset;		/*!< what the itimer was set to last */
+	int 	itimer;
+	int 	otimer;
 	
+	/* RBS state */
+	int gotgs;
+	int txstate;
+	int rxsig;
+	int txsig;
+	int rxsigstate;
+
+	/* non-RBS rx state */
+	int rxhooksig;
+	int txhooksig;
+	int kewlonhook;
+
+	u_char swritechunk[DAHDI_MAX_CHUNKSIZE];	/*!< Buffer to be written */
+	u_char sreadchunk[DAHDI_MAX_CHUNKSIZE];	/*!< Preallocated static area */
+
+	wait_queue_head_t waitq;
+
+	/*
+	 * Per tick, but only in some modes: HDLC, conferencing, SF and
+	 * cross-board conference queues.
+	 */
+
 	/* HDLC state machines */
 	struct fasthdlc_state txhdlc;
 	struct fasthdlc_state rxhdlc;
 	int infcs;
 
-	/* Conferencing stuff */
-	int		confna;	/*! conference number (alias) */
-	int		_confn;	/*! Actual conference number */
-	int		confmode;  /*! conference mode */
-	int		confmute; /*! conference mute mode */
-	struct dahdi_chan *conf_chan;
-
 	/* Incoming and outgoing conference chunk queues for
 	   communicating between DAHDI master time and
 	   other boards */
@@ -551,6 +556,51 @@ struct dahdi_chan {
 	short	conflast1[DAHDI_MAX_CHUNKSIZE];		/*!< Last conference sample  -- pseudo part of channel */
 	short	conflast2[DAHDI_MAX_CHUNKSIZE];		/*!< Previous last conference sample -- pseudo part of channel */
 
+	long rxp1;
+	long rxp2;
+	long rxp3;
+	int txtone;
+	int tx_v2;
+	int tx_v3;
+	int v1_1;
+	int v2_1;
+	int v3_1;
+	int toneflags;
+	struct sf_detect_state rd;
+
+#ifdef CONFIG_DAHDI_MIRROR
+	struct dahdi_chan	*rxmirror;  /*!< channel we mirror reads to */
+	struct dahdi_chan	*txmirror;  /*!< channel we mirror writes to */
+	struct dahdi_chan	*srcmirror; /*!< channel we mirror from */
+#endif /* CONFIG_DAHDI_MIRROR */
+
+	/* Cold: configuration, names and rarely used state */
+	char name[40] ____cacheline_aligned;
+	/* Specified by DAHDI */
+	/*! \brief DAHDI channel number */
+	int channo;
+	int chanpos;
+
+	/* Specified by driver, readable by DAHDI */
+	void *pvt;			/*!< Private channel data */
+	struct file *file;	/*!< File structure */
+	int		sigcap;			/*!< Capability for signalling */
+	__u32		chan_alarms;		/*!< alarms status */
+
+	int		eventinidx;  /*!< out index in event buf (circular) */
+	int		eventoutidx;  /*!< in index in event buf (circular) */
+	unsigned int	eventbuf[DAHDI_MAX_EVENTSIZE];  /*!< event circ. buffer */
+
+	struct dahdi_zone *curzone;		/*!< Zone for selecting tones */
+
+	/*! Ring cadence */
+	int ringcadence[DAHDI_MAX_CADENCE];
+	int firstcadencepos;				/*!< Where to restart ring cadence */
+
+	char	txdialbuf[DAHDI_MAX_DTMF_BUF];
+
+	/* I/O Mask */	
+	unsigned int iomask;  /*! I/O Mux signal mask */
 
 	/*! The echo canceler module that should be used to create an
 	   instance when this channel needs one */
@@ -558,8 +608,6 @@ struct dahdi_chan {
 	/*! The echo canceler module that owns the instance currently
 	   on this channel, if one is present */
 	const struct dahdi_echocan_factory *ec_current;
-	/*! The state data of the echo canceler instance in use */
-	struct dahdi_echocan_state *ec_state;
 
 	/* RBS timings  */
 	int		prewinktime;  /*!< pre-wink time (ms) */
@@ -574,45 +622,21 @@ struct dahdi_chan {
 	int		pulsemaketime;  /*!< pulse line closed time (ms) */
 	int		pulseaftertime; /*!< pulse time between digits (ms) */
 
-	/*! RING debounce timer */
-	int	ringdebtimer;
-	
-	/*! RING trailing detector to make sure a RING is really over */
-	int ringtrailer;
-
-	/* PULSE digit receiver stuff */
-	int	pulsecount;
-	int	pulsetimer;
-
-	/* RBS timers */
-	int 	itimerset;		/*!< what the itimer was set to last */
-	int 	itimer;
-	int 	otimer;
-	
-	/* RBS state */
-	int gotgs;
-	int txstate;
-	int rxsig;
-	int txsig;
-	int rxsigstate;
-
-	/* non-RBS rx state */
-	int rxhooksig;
-	int txhooksig;
-	int kewlonhook;
-
 	/*! Idle signalling if CAS signalling */
 	int idlebits;
 
 	int deflaw;		/*! 1 = mulaw, 2=alaw, 0=undefined */
-	short *xlaw;
-#ifdef	OPTIMIZE_CHANMUTE
-	int chanmute;		/*!< no need for PCM data */
+
+#ifdef CONFIG_DAHDI_PPP
+	struct ppp_channel *ppp;
+	struct tasklet_struct ppp_calls;
+	int do_ppp_wakeup;
+	int do_ppp_error;
+	struct sk_buff_head ppp_rq;
 #endif
-#ifdef CONFIG_CALC_XLAW
-	unsigned char (*lineartoxlaw)(short a);
-#else
-	unsigned char *lin2x;
+#ifdef BUFFER_DEBUG
+	int statcount;
+	int lastnumbufs;
 #endif
 	struct device chan_device;	/*!< Kernel object for this chan */
 #define dev_to_chan(dev)    container_of(dev, struct dahdi_chan, chan_device)
@@ -732,6 +756,7 @@ enum {
 	DAHDI_FLAGBIT_TXUNDERRUN = 22,	/*!< Transmit underrun condition */
 	DAHDI_FLAGBIT_RXOVERRUN = 23,	/*!< Receive overrun condition */
 	DAHDI_FLAGBIT_DEVFILE	= 25,	/*!< Channel has a sysfs dev file */
+	DAHDI_FLAGBIT_ECREADY_EVENTS = 26, /*!< Report DAHDI_EVENT_EC_READY */
 };
 
 #ifdef CONFIG_DAHDI_NET
@@ -799,6 +824,7 @@ struct dahdi_count {
 #define DAHDI_FLAG_BUFEVENTS	DAHDI_FLAG(BUFEVENTS)
 #define DAHDI_FLAG_TXUNDERRUN	DAHDI_FLAG(TXUNDERRUN)
 #define DAHDI_FLAG_RXOVERRUN	DAHDI_FLAG(RXOVERRUN)
+#define DAHDI_FLAG_ECREADY_EVENTS	DAHDI_FLAG(ECREADY_EVENTS)
 
 enum spantypes {
 	SPANTYPE_INVALID	= 0,
@@ -967,6 +993,11 @@ struct dahdi_span {
 
 	struct dahdi_chan **chans;	/*!< Member channel structures */
 
+	/*! Optional [channels][DAHDI_CHUNKSIZE] areas the member channels'
+	 * readchunk / writechunk point into (dahdi_span_alloc_chunks()) */
+	u_char *rxchunks;
+	u_char *txchunks;
+
 	const struct dahdi_span_ops *ops;	/*!< span callbacks. */
 
 	/* Used by DAHDI only -- no user servicable parts inside */
@@ -1066,6 +1097,14 @@ struct dahdi_transcoder {
 	struct file_operations fops;
 	int (*allocate)(struct dahdi_transcoder_channel *channel);
 	int (*release)(struct dahdi_transcoder_channel *channel);
+	/* Optional. Bracket the writes of a DAHDI_TC_SUBMIT_BATCH request so
+	 * that the driver can hand the frames to the hardware together. Called
+	 * in process context, at most once each per transcoder per request. */
+	void (*batch_begin)(struct dahdi_transcoder *tc);
+	void (*batch_end)(struct dahdi_transcoder *tc);
+	/* One bit per channel, set while the channel is allocated. Protected
+	 * by the translock in dahdi_transcode. */
+	unsigned long *busy_map;
 	/* Transcoder channels */
 	struct dahdi_transcoder_channel channels[0];
 };
@@ -1199,6 +1238,8 @@ int dahdi_register_device(struct dahdi_device *ddev, struct device *parent);
 void dahdi_unregister_device(struct dahdi_device *ddev);
 void dahdi_free_device(struct dahdi_device *ddev);
 void dahdi_init_span(struct dahdi_span *span);
+int dahdi_span_alloc_chunks(struct dahdi_span *span);
+void dahdi_span_free_chunks(struct dahdi_span *span);
 
 /*! dynamicaly span (un)assign controls !*/
 int dahdi_assign_span(struct dahdi_span *span, unsigned int spanno,
@@ -1283,6 +1324,8 @@ static inline void dahdi_ec_span(struct dahdi_span *span)
 	local_irq_restore(flags);
 }
 
+#include <dahdi/interleave.h>
+
 extern struct file_operations *dahdi_transcode_fops;
 
 /* Don't use these directly -- they're not guaranteed to
@@ -453,6 +453,13 @@ enum {
 /* The channel's write buffer encountered an underrun condition */
 #define DAHDI_EVENT_WRITE_UNDERRUN	30
 
+/*
+ * A hardware echo canceller that was enabled has been configured on the chip.
+ * Only reported on channels that asked for it with DAHDI_EC_READY_EVENTS, as
+ * a pending event makes read() and write() fail with ELAST.
+ */
+#define DAHDI_EVENT_EC_READY		31
+
 #define DAHDI_EVENT_PULSEDIGIT		(1 << 16)	/* This is OR'd with the digit received */
 #define DAHDI_EVENT_DTMFDOWN		(1 << 17)	/* Ditto for DTMF key down event */
 #define DAHDI_EVENT_DTMFUP		(1 << 18)	/* Ditto for DTMF key up event */
@@ -471,6 +478,25 @@ struct dahdi_transcoder_info {
 	__u32 srcfmts;
 };
 
+/* One entry of a DAHDI_TC_SUBMIT_BATCH / DAHDI_TC_RETRIEVE_BATCH request.
+ * fd must refer to a transcoder file on which DAHDI_TC_ALLOCATE succeeded. */
+struct dahdi_transcoder_frame {
+	__s32	fd;
+	__u32	len;		/* in: bytes to write / size of the read buffer
+				 * out: bytes actually written / read */
+	__u64	buf;		/* userspace address of the payload */
+	__s32	result;		/* out: 0 or a negative errno */
+	__u32	reserved;
+};
+
+struct dahdi_transcoder_batch {
+	__u32	count;		/* number of entries in frames */
+	__u32	completed;	/* out: number of entries with result == 0 */
+	__u64	frames;		/* userspace address of the frame array */
+};
+
+#define DAHDI_TC_MAX_BATCH	256
+
 #define DAHDI_MAX_ECHOCANPARAMS 8
 
 /* ioctl definitions */
@@ -1056,6 +1082,12 @@ struct dahdi_hwgain {
 #define DAHDI_TC_CODE			'T'
 #define DAHDI_TC_ALLOCATE		_IOW(DAHDI_TC_CODE, 1, struct dahdi_transcoder_formats)
 #define DAHDI_TC_GETINFO		_IOWR(DAHDI_TC_CODE, 2, struct dahdi_transcoder_info)
+/* Write (SUBMIT) or read (RETRIEVE) up to DAHDI_TC_MAX_BATCH frames on any
+ * number of allocated transcoder channels with a single call.  Each entry
+ * carries its own result.  RETRIEVE never sleeps; entries for channels that
+ * have nothing waiting are completed with -EAGAIN. */
+#define DAHDI_TC_SUBMIT_BATCH		_IOWR(DAHDI_TC_CODE, 3, struct dahdi_transcoder_batch)
+#define DAHDI_TC_RETRIEVE_BATCH		_IOWR(DAHDI_TC_CODE, 4, struct dahdi_transcoder_batch)
 
 /*
  * VMWI Specification 
@@ -1102,6 +1134,116 @@ struct dahdi_vmwi_info {
  */
 #define DAHDI_BUFFER_EVENTS		_IOW(DAHDI_CODE, 105, int)
 
+/*
+ * Set up a batch of already opened /dev/dahdi/pseudo channels in one call
+ * instead of a DAHDI_SETLAW, DAHDI_SET_BLOCKSIZE and DAHDI_SETCONF for each.
+ * May be issued on any DAHDI file descriptor.
+ */
+#define DAHDI_PSEUDO_BULK_MAX	32
+
+struct dahdi_pseudo_bulk {
+	int count;		/* IN: fds used. OUT: how many were set up */
+	int law;		/* DAHDI_LAW_*, or -1 to leave alone */
+	int blocksize;		/* Block size, or 0 to leave alone */
+	int confno;		/* Conference to join, -1 for a new one. The
+				   conference used is returned here. */
+	int confmode;		/* DAHDI_CONF_*, or 0 to leave alone */
+	int fds[DAHDI_PSEUDO_BULK_MAX];		/* IN: pseudo channel fds */
+	int channos[DAHDI_PSEUDO_BULK_MAX];	/* OUT: their channel numbers */
+};
+
+#define DAHDI_PSEUDO_BULK		_IOWR(DAHDI_CODE, 106, struct dahdi_pseudo_bulk)
+
+/*
+ * Per-channel I/O error counters. They are cleared when the channel is
+ * opened and read through the "stats" binary attribute of the channel
+ * in /sys/bus/dahdi_channels/devices, one such structure per read.
+ */
+#define DAHDI_CHAN_STATS_VERSION	1
+
+struct dahdi_chan_stats {
+	__u32 version;		/* DAHDI_CHAN_STATS_VERSION */
+	__u32 rx_overruns;	/* Times the read buffers ran full */
+	__u32 tx_underruns;	/* Times the write buffers ran empty */
+	__u32 confin_drops;	/* Received conference chunks dropped (full) */
+	__u32 confout_drops;	/* Mixed conference chunks dropped (full) */
+	__u32 confout_underruns;	/* No mixed chunk ready to transmit */
+	__u32 hdlc_aborts;	/* HDLC frames aborted */
+	__u32 hdlc_badfcs;	/* HDLC frames with a bad FCS */
+	__u32 ec_events;	/* Echo canceller events raised */
+};
+
+/*
+ * Status of every span and every span channel in one call, for monitors
+ * that would otherwise issue a DAHDI_SPANSTAT per span and a
+ * DAHDI_GET_PARAMS per channel. May be issued on any DAHDI file
+ * descriptor. If the arrays are too small the snapshot is truncated;
+ * total_spans and total_chans tell how large they need to be. To fetch
+ * the rest instead, call again with first_span set to the number of the
+ * first span whose entry or channels did not fit. Spans are read one
+ * after another without holding off span changes, so entries of different
+ * spans may be from slightly different moments.
+ */
+#define DAHDI_SNAPSHOT_VERSION	1
+
+struct dahdi_snapshot_span {
+	__u32	spanno;
+	__u32	alarms;		/* DAHDI_ALARM_* */
+	__u32	basechan;	/* channel number of the first channel */
+	__u32	channels;	/* number of channels on the span */
+	__s32	syncsrc;	/* span # of current sync source, 0 free run */
+	__s32	rxlevel;
+	__s32	txlevel;
+	__u32	irqmisses;
+	__u32	bpvcount;
+	__u32	crc4count;
+	__u32	ebitcount;
+	__u32	fascount;
+	__u32	fecount;
+	__u32	cvcount;
+	__u32	becount;
+	__u32	prbs;
+	__u32	errsec;
+};
+
+#define DAHDI_SNAPSHOT_CHAN_OPEN	(1 << 0)	/* Opened by someone */
+#define DAHDI_SNAPSHOT_CHAN_OFFHOOK	(1 << 1)	/* rx not idle */
+#define DAHDI_SNAPSHOT_CHAN_EC		(1 << 2)	/* Echo canceller on */
+#define DAHDI_SNAPSHOT_CHAN_EC_FAX	(1 << 3)	/* ... in fax mode */
+
+struct dahdi_snapshot_chan {
+	__u32	channo;
+	__u32	spanno;
+	__u32	sigtype;	/* DAHDI_SIG_* */
+	__u32	chan_alarms;
+	__u32	flags;		/* DAHDI_SNAPSHOT_CHAN_* */
+	__s32	rxhooksig;	/* -1 if the channel has no hook signalling */
+	__s32	txhooksig;
+	__s32	rxbits;		/* -1 if the channel has no robbed bits */
+	__s32	txbits;
+	struct dahdi_chan_stats stats;
+};
+
+struct dahdi_snapshot {
+	__u32	version;	/* IN/OUT: DAHDI_SNAPSHOT_VERSION */
+	__u32	nspans;		/* IN: room in spans. OUT: entries filled */
+	__u32	nchans;		/* IN: room in chans. OUT: entries filled */
+	__u32	total_spans;	/* OUT: spans in the system */
+	__u32	total_chans;	/* OUT: span channels in the system */
+	__u32	first_span;	/* IN: skip spans numbered below this */
+	__u64	spans;		/* struct dahdi_snapshot_span * */
+	__u64	chans;		/* struct dahdi_snapshot_chan * */
+};
+
+#define DAHDI_SNAPSHOT		_IOWR(DAHDI_CODE, 107, struct dahdi_snapshot)
+
+/*
+  Set whether DAHDI_EVENT_EC_READY is reported on the channel. Disabled by
+  default, like buffer events, so that users which do not know the event
+  are not handed an unexpected ELAST. Cleared when the channel is closed.
+ */
+#define DAHDI_EC_READY_EVENTS		_IOW(DAHDI_CODE, 108, int)
+
 /* Get current status IOCTL */
 /* Defines for Radio Status (dahdi_radio_stat.radstat) bits */
 